@@ -2,7 +2,7 @@
 #include <string.h>
 #include <time.h>
 
-#include "../../utils/intcode.c"
+#include "../../utils/intcode_batch.c"
 
 #define OUTPUT 19690720
 
@@ -20,25 +20,44 @@ void problem1(char* inputFilePath) {
     intcodeRun(&program);
 
     clock_t end = clock();
-    printf("Problem 01: %lld [%.2fms]\n", program.memory[0], (double)(end - start) / CLOCKS_PER_SEC * 1000);
+    printf("Problem 01: %lld [%.2fms]\n", readMemory(&program, 0), (double)(end - start) / CLOCKS_PER_SEC * 1000);
+}
+
+long long readOutput(IntCodeProgram* program) {
+    // The output of the program is whatever's left at address 0.
+    return readMemory(program, 0);
 }
 
 int nounVerbOutput(IntCodeProgram* program) {
+    /*
+    Every noun/verb pair is an independent run of the program, so run them all at once as a batch, with the
+    noun and verb patched in for each job.
+    */
+    IntCodeBatch batch;
+    initIntCodeBatch(&batch, program, 0);
+    batch.collect = readOutput;
+
     for (int noun = 0; noun < 99; noun += 1) {
         for (int verb = 0; verb < 99; verb += 1) {
-            // Set the noun/verb.
-            program->program[1] = noun;
-            program->program[2] = verb;
+            size_t jobIdx = addIntCodeJob(&batch, NULL, 0);
+            patchIntCodeJob(&batch, jobIdx, 1, noun);
+            patchIntCodeJob(&batch, jobIdx, 2, verb);
+        }
+    }
 
-            // Run the program.
-            intcodeRun(program);
+    runIntCodeBatch(&batch);
 
-            // If we've got the right output, jump out of the nested for loop.
-            if (program->memory[0] == OUTPUT) return 100 * noun + verb;
+    // Jobs are in the same order they were added, so the first match is the same as running them in order.
+    int output = -1;
+    for (size_t jobIdx = 0; jobIdx < batch.numJobs; jobIdx += 1) {
+        if (batch.jobs[jobIdx].result == OUTPUT) {
+            output = 100 * (jobIdx / 99) + jobIdx % 99;
+            break;
         }
     }
 
-    return -1;
+    freeIntCodeBatch(&batch);
+    return output;
 }
 
 void problem2(char* inputFilePath) {
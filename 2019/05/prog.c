@@ -12,13 +12,17 @@ void problem1(char* inputFilePath) {
     initIntCodeProgramFromFile(&program, inputFilePath);
 
     // Add the input.
-    insertLLongArray(&program.input, 1);
+    pushInput(&program, 1);
 
     // Run the program.
     intcodeRun(&program);
 
+    // The answer is the last output.
+    long long output = 0;
+    while (popOutput(&program, &output));
+
     clock_t end = clock();
-    printf("Problem 01: %lld [%.2fms]\n", program.output.data[program.output.numItems - 1], (double)(end - start) / CLOCKS_PER_SEC * 1000);
+    printf("Problem 01: %lld [%.2fms]\n", output, (double)(end - start) / CLOCKS_PER_SEC * 1000);
 }
 
 void problem2(char* inputFilePath) {
@@ -29,13 +33,17 @@ void problem2(char* inputFilePath) {
     initIntCodeProgramFromFile(&program, inputFilePath);
 
     // Add the input.
-    insertLLongArray(&program.input, 5);
+    pushInput(&program, 5);
 
     // Run the program.
     intcodeRun(&program);
 
+    // The answer is the last output.
+    long long output = 0;
+    while (popOutput(&program, &output));
+
     clock_t end = clock();
-    printf("Problem 02: %lld [%.2fms]\n", program.output.data[program.output.numItems - 1], (double)(end - start) / CLOCKS_PER_SEC * 1000);
+    printf("Problem 02: %lld [%.2fms]\n", output, (double)(end - start) / CLOCKS_PER_SEC * 1000);
 }
 
 /*
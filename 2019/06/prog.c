@@ -41,11 +41,9 @@ void problem1(char* inputFilePath) {
     // count of the number of jumps taken.
     int totalOrbitCount = 0;
     int orbitCount;
-    char* key;
-    for (int idx = 0; idx < connections.capacity; idx += 1) {
-        if (connections.entries[idx].key == NULL) continue;
-
-        key = connections.entries[idx].key;
+    int cursor = 0;
+    char *key, *orbitedObject;
+    while (nextMap(&connections, &cursor, &key, &orbitedObject)) {
         orbitCount = 0;
         while (getMap(&connections, key, &key)) orbitCount += 1;
 
@@ -63,7 +61,7 @@ void problem2(char* inputFilePath) {
     Like part 1, keep all the orbit connections in the map. From there, backtrack on both SAN and YOU, keeping
     track of the jump distance for each connected object in two different respective maps.
 
-    Then, loop through the matching keys of both to get the minimum number of hops required to meet up.
+    Then, look up each of your orbits in Santa's to get the minimum number of hops required to meet up.
     */
     clock_t start = clock();
 
@@ -105,20 +103,17 @@ void problem2(char* inputFilePath) {
         orbitDistance += 1;
     }
 
-    // Loop through matching keys in the two orbit distance maps, keeping track of the least distance.
+    // Loop through your orbits, looking up the ones Santa shares, keeping track of the least distance.
     int minDistance = INT_MAX;
     int distance;
-    for (int idx = 0; idx < yourOrbits.capacity; idx += 1) {
-        if (yourOrbits.entries[idx].key == NULL) continue;
-
-        for (int santaIdx = 0; santaIdx < santaOrbits.capacity; santaIdx += 1) {
-            if (santaOrbits.entries[santaIdx].key == NULL) continue;
-            if (strcmp(santaOrbits.entries[santaIdx].key, yourOrbits.entries[idx].key) != 0) continue;
-
-            // Matching orbit, compute the distance and store it if it's the minimum yet found.
-            distance = yourOrbits.entries[idx].value + santaOrbits.entries[santaIdx].value;
-            if (distance < minDistance) minDistance = distance;
-        }
+    int cursor = 0;
+    long long yourDistance, santaDistance;
+    while (nextLLongMap(&yourOrbits, &cursor, &key, &yourDistance)) {
+        if (!getLLongMap(&santaOrbits, key, &santaDistance)) continue;
+
+        // Matching orbit, compute the distance and store it if it's the minimum yet found.
+        distance = yourDistance + santaDistance;
+        if (distance < minDistance) minDistance = distance;
     }
 
     clock_t end = clock();
@@ -2,165 +2,142 @@
 #include <string.h>
 #include <time.h>
 
-#include "../../utils/intcode.c"
+#include "../../utils/intcode_batch.c"
+#include "../../utils/intcode_network.c"
 
-void problem1(char* inputFilePath) {
-    clock_t start = clock();
-
-    IntCodeProgram program;
-    initIntCodeProgramFromFile(&program, inputFilePath);
-
-    long long maxSignal = -1;
+#define NUM_AMPS 5
+// The number of ways the 5 phase settings can be ordered (5!).
+#define NUM_PHASE_ORDERS 120
 
-    // Try all valid combinations of input signals (0-4).
-    for (int a = 0; a <= 4; a += 1) {
-        for (int b = 0; b <= 4; b += 1) {
+void findPhaseOrders(int minPhase, int phaseOrders[NUM_PHASE_ORDERS][NUM_AMPS]) {
+    /*
+    Finds all valid orderings of the phase settings minPhase to minPhase + 4.
+    */
+    int numPhaseOrders = 0;
+    for (int a = minPhase; a < minPhase + NUM_AMPS; a += 1) {
+        for (int b = minPhase; b < minPhase + NUM_AMPS; b += 1) {
             // These continues are to ensure that no two numbers in the phase settings are the same.
             if (b == a) continue;
 
-            for (int c = 0; c <= 4; c += 1) {
+            for (int c = minPhase; c < minPhase + NUM_AMPS; c += 1) {
                 if (c == a || c == b) continue;
 
-                for (int d = 0; d <= 4; d += 1) {
+                for (int d = minPhase; d < minPhase + NUM_AMPS; d += 1) {
                     if (d == a || d == b || d == c) continue;
 
-                    for (int e = 0; e <= 4; e += 1) {
+                    for (int e = minPhase; e < minPhase + NUM_AMPS; e += 1) {
                         if (e == a || e == b || e == c || e == d) continue;
 
-                        // Now that we've got a valid signal sequence, run them and keep track
-                        // of the maximum output signal.
-
-                        // Amp A
-                        program.input.numItems = 0;
-                        insertLLongArray(&program.input, a);
-                        insertLLongArray(&program.input, 0);
-                        intcodeRun(&program);
-
-                        // Amp B
-                        program.input.numItems = 0;
-                        insertLLongArray(&program.input, b);
-                        insertLLongArray(&program.input, program.output.data[0]);
-                        intcodeRun(&program);
-
-                        // Amp C
-                        program.input.numItems = 0;
-                        insertLLongArray(&program.input, c);
-                        insertLLongArray(&program.input, program.output.data[0]);
-                        intcodeRun(&program);
-
-                        // Amp D
-                        program.input.numItems = 0;
-                        insertLLongArray(&program.input, d);
-                        insertLLongArray(&program.input, program.output.data[0]);
-                        intcodeRun(&program);
-
-                        // Amp E
-                        program.input.numItems = 0;
-                        insertLLongArray(&program.input, e);
-                        insertLLongArray(&program.input, program.output.data[0]);
-                        intcodeRun(&program);
-
-                        if (program.output.data[0] > maxSignal) maxSignal = program.output.data[0];
+                        phaseOrders[numPhaseOrders][0] = a;
+                        phaseOrders[numPhaseOrders][1] = b;
+                        phaseOrders[numPhaseOrders][2] = c;
+                        phaseOrders[numPhaseOrders][3] = d;
+                        phaseOrders[numPhaseOrders][4] = e;
+                        numPhaseOrders += 1;
                     }
                 }
             }
         }
     }
-
-    clock_t end = clock();
-    printf("Problem 01: %lld [%.2fms]\n", maxSignal, (double)(end - start) / CLOCKS_PER_SEC * 1000);
 }
 
-void problem2(char* inputFilePath) {
+int routeAmpSignal(IntCodeNetwork* network, int amp, long long* signal) {
     /*
-    Like part 1, but now the programs keep running in a loop until amp E halts, with E's output feeding back into
-    A when E doesn't halt (i.e., it's waiting for another input).
+    Sends the amp's signal on to the next amp in the loop, keeping track of the last signal out of Amp E.
+    */
+    if (amp == NUM_AMPS - 1) *(long long*)network->context = *signal;
 
-    For this part, the Intcode interpreter was updated to handle waiting for inputs. If a program hits the STORE_INPUT
-    command without any new inputs in the buffer, it returns early. The next time the program runs, it picks up from
-    where it left off. I also added a flag to tell if a program completed by hitting the EXIT opcode or not, which is
-    used to tell when the E program is done for good.
+    return (amp + 1) % NUM_AMPS;
+}
 
-    Besides that, the solution is pretty similar to part 1, the only difference is the program running loops until
-    E is halted.
+long long runAmpLoop(IntCodeProgram* program, int* phases) {
+    /*
+    Runs a loop of amps with the given phase settings until all the amps halt, returning the last signal
+    out of Amp E.
     */
-    clock_t start = clock();
+    long long lastSignal = -1;
 
-    IntCodeProgram ampAProgram, ampBProgram, ampCProgram, ampDProgram, ampEProgram;
-    initIntCodeProgramFromFile(&ampAProgram, inputFilePath);
-    initIntCodeProgramFromFile(&ampBProgram, inputFilePath);
-    initIntCodeProgramFromFile(&ampCProgram, inputFilePath);
-    initIntCodeProgramFromFile(&ampDProgram, inputFilePath);
-    initIntCodeProgramFromFile(&ampEProgram, inputFilePath);
+    IntCodeNetwork network;
+    initIntCodeNetwork(&network, program, NUM_AMPS);
+    network.route = routeAmpSignal;
+    network.context = &lastSignal;
 
-    long long maxSignal = -1;
+    // Each amp reads it's phase setting first, then Amp A gets a signal of 0 to kick things off.
+    for (int amp = 0; amp < NUM_AMPS; amp += 1) pushInput(&network.nodes[amp].program, phases[amp]);
 
-    long long previousSignal;
-    // Try all valid combinations of input signals (5-9).
-    for (int a = 5; a <= 9; a += 1) {
-        for (int b = 5; b <= 9; b += 1) {
-            // These continues are to ensure that no two numbers in the phase settings are the same.
-            if (b == a) continue;
+    long long signal = 0;
+    sendToIntCodeNode(&network, 0, &signal, 1);
+    runIntCodeNetwork(&network);
 
-            for (int c = 5; c <= 9; c += 1) {
-                if (c == a || c == b) continue;
+    freeIntCodeNetwork(&network);
+    return lastSignal;
+}
 
-                for (int d = 5; d <= 9; d += 1) {
-                    if (d == a || d == b || d == c) continue;
+void problem1(char* inputFilePath) {
+    /*
+    Try every ordering of the phase settings, running the amps in a chain, each one a fresh run of the
+    program with it's phase setting and the previous amp's signal as input.
 
-                    for (int e = 5; e <= 9; e += 1) {
-                        if (e == a || e == b || e == c || e == d) continue;
+    Every ordering is independent of the others, so rather than running them one at a time, run all 120
+    Amp As at once as a batch, then all the Amp Bs with the Amp A signals, and so on.
+    */
+    clock_t start = clock();
 
-                        // Initialize the phase signals for each amp.
-                        ampAProgram.input.numItems = 0;
-                        insertLLongArray(&ampAProgram.input, a);
+    IntCodeProgram program;
+    initIntCodeProgramFromFile(&program, inputFilePath);
 
-                        ampBProgram.input.numItems = 0;
-                        insertLLongArray(&ampBProgram.input, b);
+    int phaseOrders[NUM_PHASE_ORDERS][NUM_AMPS];
+    findPhaseOrders(0, phaseOrders);
 
-                        ampCProgram.input.numItems = 0;
-                        insertLLongArray(&ampCProgram.input, c);
+    // As per the problem, Amp A first starts with a signal of 0 to kick things off.
+    long long signals[NUM_PHASE_ORDERS] = {0};
+    for (int amp = 0; amp < NUM_AMPS; amp += 1) {
+        IntCodeBatch batch;
+        initIntCodeBatch(&batch, &program, 0);
 
-                        ampDProgram.input.numItems = 0;
-                        insertLLongArray(&ampDProgram.input, d);
+        for (int order = 0; order < NUM_PHASE_ORDERS; order += 1) {
+            long long input[2] = {phaseOrders[order][amp], signals[order]};
+            addIntCodeJob(&batch, input, 2);
+        }
 
-                        ampEProgram.input.numItems = 0;
-                        insertLLongArray(&ampEProgram.input, e);
+        runIntCodeBatch(&batch);
+        for (int order = 0; order < NUM_PHASE_ORDERS; order += 1) signals[order] = batch.jobs[order].result;
 
-                        // Until the Amp E program halts, keep running the array of amp programs, feeding the output
-                        // of the previous amp into the next one in the chain, with E looping back into A.
+        freeIntCodeBatch(&batch);
+    }
 
-                        // As per the problem, Amp A first starts with a signal of 0 to kick things off.
-                        previousSignal = 0;
-                        do {
-                            insertLLongArray(&ampAProgram.input, previousSignal);
-                            intcodeRun(&ampAProgram);
-                            previousSignal = ampAProgram.output.data[ampAProgram.output.numItems - 1];
+    long long maxSignal = -1;
+    for (int order = 0; order < NUM_PHASE_ORDERS; order += 1) {
+        if (signals[order] > maxSignal) maxSignal = signals[order];
+    }
+    freeIntCodeProgram(&program);
+
+    clock_t end = clock();
+    printf("Problem 01: %lld [%.2fms]\n", maxSignal, (double)(end - start) / CLOCKS_PER_SEC * 1000);
+}
 
-                            insertLLongArray(&ampBProgram.input, previousSignal);
-                            intcodeRun(&ampBProgram);
-                            previousSignal = ampBProgram.output.data[ampBProgram.output.numItems - 1];
+void problem2(char* inputFilePath) {
+    /*
+    Like part 1, but now the programs keep running in a loop until amp E halts, with E's output feeding back into
+    A when E doesn't halt (i.e., it's waiting for another input).
 
-                            insertLLongArray(&ampCProgram.input, previousSignal);
-                            intcodeRun(&ampCProgram);
-                            previousSignal = ampCProgram.output.data[ampCProgram.output.numItems - 1];
+    The amps are wired together in an Intcode network, which handles all the back and forth. Each amp waits on
+    input until the previous amp sends it a signal, and the network stops once every amp has halted.
+    */
+    clock_t start = clock();
 
-                            insertLLongArray(&ampDProgram.input, previousSignal);
-                            intcodeRun(&ampDProgram);
-                            previousSignal = ampDProgram.output.data[ampDProgram.output.numItems - 1];
+    IntCodeProgram program;
+    initIntCodeProgramFromFile(&program, inputFilePath);
 
-                            insertLLongArray(&ampEProgram.input, previousSignal);
-                            intcodeRun(&ampEProgram);
-                            previousSignal = ampEProgram.output.data[ampEProgram.output.numItems - 1];
-                        } while (!ampEProgram.halted);
+    int phaseOrders[NUM_PHASE_ORDERS][NUM_AMPS];
+    findPhaseOrders(5, phaseOrders);
 
-                        // At this point, previousSignal is the most recent output from Amp E's program.
-                        if (previousSignal > maxSignal) maxSignal = previousSignal;
-                    }
-                }
-            }
-        }
+    long long maxSignal = -1;
+    for (int order = 0; order < NUM_PHASE_ORDERS; order += 1) {
+        long long signal = runAmpLoop(&program, phaseOrders[order]);
+        if (signal > maxSignal) maxSignal = signal;
     }
+    freeIntCodeProgram(&program);
 
     clock_t end = clock();
     printf("Problem 02: %lld [%.2fms]\n", maxSignal, (double)(end - start) / CLOCKS_PER_SEC * 1000);
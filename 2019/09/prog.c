@@ -21,11 +21,15 @@ void problem1(char* inputFilePath) {
     IntCodeProgram program;
     initIntCodeProgramFromFile(&program, inputFilePath);
 
-    insertLLongArray(&program.input, 1);
+    pushInput(&program, 1);
     intcodeRun(&program);
 
+    // The answer is the last output.
+    long long output = 0;
+    while (popOutput(&program, &output));
+
     clock_t end = clock();
-    printf("Problem 01: %lld [%.2fms]\n", program.output.data[program.output.numItems - 1], (double)(end - start) / CLOCKS_PER_SEC * 1000);
+    printf("Problem 01: %lld [%.2fms]\n", output, (double)(end - start) / CLOCKS_PER_SEC * 1000);
 }
 
 void problem2(char* inputFilePath) {
@@ -37,11 +41,15 @@ void problem2(char* inputFilePath) {
     IntCodeProgram program;
     initIntCodeProgramFromFile(&program, inputFilePath);
 
-    insertLLongArray(&program.input, 2);
+    pushInput(&program, 2);
     intcodeRun(&program);
 
+    // The answer is the last output.
+    long long output = 0;
+    while (popOutput(&program, &output));
+
     clock_t end = clock();
-    printf("Problem 02: %lld [%.2fms]\n", program.output.data[program.output.numItems - 1], (double)(end - start) / CLOCKS_PER_SEC * 1000);
+    printf("Problem 02: %lld [%.2fms]\n", output, (double)(end - start) / CLOCKS_PER_SEC * 1000);
 }
 
 /*
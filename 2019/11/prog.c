@@ -34,13 +34,12 @@ void problem1(char* inputFilePath) {
     LLongMap visitedTileColors;
     initLLongMap(&visitedTileColors);
 
-    char* key;
+    char key[25];
     long long tile;
     // The bot starts at (0, 0) facing up.
     int x = 0, y = 0, direction = UP;
     do {
         // Get the color of the current tile, defaulting to BLACK.
-        key = malloc(25);
         sprintf(key, "%d,%d", x, y);
 
         if (!getLLongMap(&visitedTileColors, key, &tile)) {
@@ -54,11 +53,13 @@ void problem1(char* inputFilePath) {
         // Run the program.
         intcodeRun(&program);
 
-        // Paint the tile
-        setLLongMap(&visitedTileColors, key, program.output.data[program.output.numItems - 2]);
+        // Paint the tile, unless the program halted without saying what to paint.
+        long long color, turn;
+        if (!popOutput(&program, &color) || !popOutput(&program, &turn)) break;
+        setLLongMap(&visitedTileColors, key, color);
 
         // Move the robot.
-        if (program.output.data[program.output.numItems - 1] == TURN_LEFT) {
+        if (turn == TURN_LEFT) {
             if (direction == UP) {
                 direction = LEFT;
                 x -= 1;
@@ -91,10 +92,10 @@ void problem1(char* inputFilePath) {
 
     // Tally up the unique tiles that were painted.
     int total = 0;
-    for (int idx = 0; idx < visitedTileColors.capacity; idx += 1) {
-        if (visitedTileColors.entries[idx].key == NULL) continue;
-        total += 1;
-    }
+    int cursor = 0;
+    char* tileKey;
+    long long tileColor;
+    while (nextLLongMap(&visitedTileColors, &cursor, &tileKey, &tileColor)) total += 1;
 
     clock_t end = clock();
     printf("Problem 01: %d [%.2fms]\n", total, (double)(end - start) / CLOCKS_PER_SEC * 1000);
@@ -115,7 +116,7 @@ void problem2(char* inputFilePath) {
     LLongMap visitedTileColors;
     initLLongMap(&visitedTileColors);
 
-    char* key;
+    char key[25];
     long long tile;
     // The bot starts at (0, 0) facing up.
     int x = 0, y = 0, direction = UP;
@@ -126,13 +127,11 @@ void problem2(char* inputFilePath) {
     int maxX = INT_MIN, maxY = INT_MIN;
 
     // Start the bot on a white tile.
-    key = malloc(25);
     sprintf(key, "%d,%d", x, y);
     setLLongMap(&visitedTileColors, key, WHITE);
 
     do {
         // Get the tile color.
-        key = malloc(25);
         sprintf(key, "%d,%d", x, y);
 
         if (!getLLongMap(&visitedTileColors, key, &tile)) {
@@ -146,11 +145,13 @@ void problem2(char* inputFilePath) {
         // Run the program.
         intcodeRun(&program);
 
-        // Paint the tile
-        setLLongMap(&visitedTileColors, key, program.output.data[program.output.numItems - 2]);
+        // Paint the tile, unless the program halted without saying what to paint.
+        long long color, turn;
+        if (!popOutput(&program, &color) || !popOutput(&program, &turn)) break;
+        setLLongMap(&visitedTileColors, key, color);
 
         // Move the robot.
-        if (program.output.data[program.output.numItems - 1] == TURN_LEFT) {
+        if (turn == TURN_LEFT) {
             if (direction == UP) {
                 direction = LEFT;
                 x -= 1;
@@ -189,7 +190,6 @@ void problem2(char* inputFilePath) {
     // Print the painted hull.
     for (y = 0; y < maxY + 1; y += 1) {
         for (x = 0; x < maxX + 1; x += 1) {
-            key = malloc(25);
             sprintf(key, "%d,%d", x, y);
             if (!getLLongMap(&visitedTileColors, key, &tile)) {
                 tile = BLACK;
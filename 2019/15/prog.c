@@ -1,6 +1,6 @@
-#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
@@ -16,311 +16,305 @@
 #define MOVE_WEST 3
 #define MOVE_EAST 4
 
-#define MAX_X 41
-#define MAX_Y 41
+// What's known about each cell of the maze.
+#define UNKNOWN 0
+#define WALL 1
+#define OPEN 2
+#define OXYGEN_SYSTEM 3
 
-#define DISPLAY_GAME false
+// The size the maze starts off at, before it grows to fit whatever's explored.
+#define INITIAL_MAZE_SIZE 64
 
-void problem1(char* inputFilePath) {
-    /*
-    Given an unknown maze and an IntCode program to explore it, find the shortest path to a specific
-    node in the maze.
+#define DISPLAY_GAME false
 
-    The first step is to explore the maze and build out a map of it. To do that, I gave the robot the
-    "keep your left hand on the wall" algorithm - always prefer going left, when you hit a wall, turn
-    right.
+// Offsets for each move, indexed by the move command.
+int MOVE_DX[5] = {0, 0, 0, -1, 1};
+int MOVE_DY[5] = {0, -1, 1, 0, 0};
 
-    That gives us a map we can then DFS to get back to the start point.
+/*
+The explored part of the maze, which grows in every direction as the droids find more of it. The droid
+starts at (0, 0).
 
-    This works because the maze is doesn't have any loops we get caught on.
-    */
-    clock_t start = clock();
+- cells: What's known about every cell, a row at a time, covering `minX` to `minX + width - 1` and `minY`
+  to `minY + height - 1`.
+- oxygenX, oxygenY: Where the oxygen system is, if `foundOxygen` is set.
+- oxygenDistance: The number of moves it takes to get from the start to the oxygen system.
+*/
+typedef struct {
+    unsigned char* cells;
+    int minX;
+    int minY;
+    int width;
+    int height;
+
+    bool foundOxygen;
+    int oxygenX;
+    int oxygenY;
+    int oxygenDistance;
+} Maze;
 
+/*
+A droid on the BFS frontier, it's program is a fork that has already made it's way to (x, y).
+*/
+typedef struct {
     IntCodeProgram program;
-    initIntCodeProgramFromFile(&program, inputFilePath);
+    int x;
+    int y;
+} Droid;
+
+// ================================ Maze ================================
+
+void initMaze(Maze* maze) {
+    maze->width = INITIAL_MAZE_SIZE;
+    maze->height = INITIAL_MAZE_SIZE;
+    maze->minX = -INITIAL_MAZE_SIZE / 2;
+    maze->minY = -INITIAL_MAZE_SIZE / 2;
+    maze->cells = calloc(maze->width * maze->height, 1);
+
+    maze->foundOxygen = false;
+    maze->oxygenX = 0;
+    maze->oxygenY = 0;
+    maze->oxygenDistance = -1;
+}
+
+void freeMaze(Maze* maze) {
+    free(maze->cells);
+    maze->cells = NULL;
+}
 
-    bool emptySpaces[MAX_Y][MAX_X];
-    int nodeScores[MAX_Y][MAX_X];
+bool isInMaze(Maze* maze, int x, int y) {
+    return x >= maze->minX && x < maze->minX + maze->width && y >= maze->minY && y < maze->minY + maze->height;
+}
 
-    for (int row = 0; row < MAX_Y; row += 1) {
-        for (int col = 0; col < MAX_X; col += 1) {
-            emptySpaces[row][col] = false;
-            nodeScores[row][col] = INT_MAX;
-        }
+int getMazeCell(Maze* maze, int x, int y) {
+    /*
+    Returns what's known about the cell, cells outside of the explored part of the maze are UNKNOWN.
+    */
+    if (!isInMaze(maze, x, y)) return UNKNOWN;
+    return maze->cells[(y - maze->minY) * maze->width + (x - maze->minX)];
+}
+
+void growMaze(Maze* maze, int x, int y) {
+    /*
+    Grows the maze to fit (x, y), at least doubling it's size on whichever side(s) it's outside of, so it
+    doesn't have to grow often. New cells are UNKNOWN.
+    */
+    int minX = maze->minX, maxX = maze->minX + maze->width;
+    int minY = maze->minY, maxY = maze->minY + maze->height;
+
+    if (x < minX) minX = x < minX - maze->width ? x : minX - maze->width;
+    if (x >= maxX) maxX = x >= maxX + maze->width ? x + 1 : maxX + maze->width;
+    if (y < minY) minY = y < minY - maze->height ? y : minY - maze->height;
+    if (y >= maxY) maxY = y >= maxY + maze->height ? y + 1 : maxY + maze->height;
+
+    int width = maxX - minX, height = maxY - minY;
+    unsigned char* cells = calloc(width * height, 1);
+    for (int row = 0; row < maze->height; row += 1) {
+        memcpy(cells + (row + maze->minY - minY) * width + (maze->minX - minX), maze->cells + row * maze->width, maze->width);
     }
 
-    // (21, 21) is an arbitrary starting point, which I got from figuring out the dimensions of the
-    // maze manually.
-    int x = 21, y = 21;
-    emptySpaces[y][x] = true;
-
-    // Left-hand walk through the maze until the O2 room is found.
-    long long statusCode;
-    int direction = MOVE_NORTH;
-    pushInput(&program, direction);
-    do {
-        intcodeRun(&program);
-        popOutput(&program, &statusCode);
-
-        // If the droid walks into a wall it turns right. Otherwise it steps forward and turns left.
-        if (statusCode == HIT_WALL) {
-            if (direction == MOVE_NORTH)
-                direction = MOVE_EAST;
-            else if (direction == MOVE_EAST)
-                direction = MOVE_SOUTH;
-            else if (direction == MOVE_SOUTH)
-                direction = MOVE_WEST;
-            else if (direction == MOVE_WEST)
-                direction = MOVE_NORTH;
-        } else {
-            if (direction == MOVE_NORTH) {
-                y -= 1;
-                direction = MOVE_WEST;
-            } else if (direction == MOVE_EAST) {
-                x += 1;
-                direction = MOVE_NORTH;
-            } else if (direction == MOVE_SOUTH) {
-                y += 1;
-                direction = MOVE_EAST;
-            } else if (direction == MOVE_WEST) {
-                x -= 1;
-                direction = MOVE_SOUTH;
+    free(maze->cells);
+    maze->cells = cells;
+    maze->minX = minX;
+    maze->minY = minY;
+    maze->width = width;
+    maze->height = height;
+}
+
+void setMazeCell(Maze* maze, int x, int y, int cell) {
+    if (!isInMaze(maze, x, y)) growMaze(maze, x, y);
+    maze->cells[(y - maze->minY) * maze->width + (x - maze->minX)] = (unsigned char)cell;
+}
+
+void displayMaze(Maze* maze, Droid* droids, size_t numDroids, bool* hasOxygen) {
+    /*
+    Clears the screen and draws the maze, with the droids on the frontier as '@'s, and the cells oxygen has
+    spread to (if `hasOxygen` is given) as 'O's.
+    */
+    printf("%c[2J%c[;H", (char)27, (char)27);
+    for (int row = 0; row < maze->height; row += 1) {
+        for (int col = 0; col < maze->width; col += 1) {
+            int cellIdx = row * maze->width + col;
+            char c = " #.X"[maze->cells[cellIdx]];
+            if (hasOxygen != NULL && hasOxygen[cellIdx]) c = 'O';
+            for (size_t droidIdx = 0; droidIdx < numDroids; droidIdx += 1) {
+                if (droids[droidIdx].x == col + maze->minX && droids[droidIdx].y == row + maze->minY) c = '@';
             }
-            emptySpaces[y][x] = true;
+            printf("%c", c);
         }
+        printf("\n");
+    }
+    usleep(6500);
+}
+
+// ================================ Exploring ================================
+
+void exploreMaze(char* inputFilePath, Maze* maze, bool stopAtOxygen) {
+    /*
+    Maps the maze with a BFS, where every cell on the frontier has it's own droid, forked from the droid
+    that first reached the cell next to it. Each round, every droid on the frontier tries each move into a
+    cell nobody has tried yet, with a fresh fork of itself, so the forks that move become the next frontier
+    and the old droids are freed. Since every cell is reached in the fewest moves, the round the oxygen
+    system is found in is the shortest distance to it, loops or not.
 
-        pushInput(&program, direction);
-    } while (statusCode != FOUND_OXYGEN_SYSTEM);
+    Forks share the program's memory pages, only copying the few a droid writes to as it moves, so a
+    frontier full of droids costs a lot less than it sounds like.
 
-    int destY = y, destX = x;
+    Stops as soon as the oxygen system is found if `stopAtOxygen` is set, otherwise, maps the whole maze.
+    */
+    initMaze(maze);
+    setMazeCell(maze, 0, 0, OPEN);
+
+    size_t frontierSize = 16, numDroids = 1, numNextDroids = 0;
+    Droid* droids = malloc(frontierSize * sizeof(Droid));
+    Droid* nextDroids = malloc(frontierSize * sizeof(Droid));
+    initIntCodeProgramFromFile(&droids[0].program, inputFilePath);
+    droids[0].x = 0;
+    droids[0].y = 0;
+
+    long long statusCode = HIT_WALL;
+    for (int distance = 1; numDroids > 0 && !(stopAtOxygen && maze->foundOxygen); distance += 1) {
+        for (size_t droidIdx = 0; droidIdx < numDroids; droidIdx += 1) {
+            Droid* droid = &droids[droidIdx];
+
+            for (int move = MOVE_NORTH; move <= MOVE_EAST; move += 1) {
+                int x = droid->x + MOVE_DX[move], y = droid->y + MOVE_DY[move];
+                if (getMazeCell(maze, x, y) != UNKNOWN) continue;
+
+                if (numNextDroids == frontierSize) {
+                    frontierSize *= 2;
+                    droids = realloc(droids, frontierSize * sizeof(Droid));
+                    nextDroids = realloc(nextDroids, frontierSize * sizeof(Droid));
+                    droid = &droids[droidIdx];
+                }
 
-    // Search for the shortest path.
-    IntArray visitStack;
-    initIntArray(&visitStack, MAX_Y * MAX_X * 2);
+                Droid* next = &nextDroids[numNextDroids];
+                forkIntCodeProgram(&droid->program, &next->program);
+                pushInput(&next->program, move);
+                intcodeRun(&next->program);
+                popOutput(&next->program, &statusCode);
 
-    // Starting from the start, DFS to the O2 room, keeping only the shortest path
-    // there.
-    insertIntArray(&visitStack, 21);
-    insertIntArray(&visitStack, 21);
-    insertIntArray(&visitStack, 0);
+                if (statusCode == HIT_WALL) {
+                    setMazeCell(maze, x, y, WALL);
+                    freeIntCodeProgram(&next->program);
+                    continue;
+                }
 
-    int minScore = INT_MAX;
-    int score;
-    while (visitStack.numItems > 0) {
-        score = popIntArray(&visitStack);
-        x = popIntArray(&visitStack);
-        y = popIntArray(&visitStack);
+                if (statusCode == FOUND_OXYGEN_SYSTEM && !maze->foundOxygen) {
+                    maze->foundOxygen = true;
+                    maze->oxygenX = x;
+                    maze->oxygenY = y;
+                    maze->oxygenDistance = distance;
+                }
+                setMazeCell(maze, x, y, statusCode == FOUND_OXYGEN_SYSTEM ? OXYGEN_SYSTEM : OPEN);
 
-        if (x == destX && y == destY) {
-            minScore = score;
-            break;
+                next->x = x;
+                next->y = y;
+                numNextDroids += 1;
+            }
+
+            freeIntCodeProgram(&droid->program);
         }
 
-        if (score > nodeScores[y][x]) continue;
-        nodeScores[y][x] = score;
+        Droid* swap = droids;
+        droids = nextDroids;
+        nextDroids = swap;
+        numDroids = numNextDroids;
+        numNextDroids = 0;
 
-        // NOTE: The input is bordered, so no need to bounds check.
-        if (emptySpaces[y - 1][x]) {
-            insertIntArray(&visitStack, y - 1);
-            insertIntArray(&visitStack, x);
-            insertIntArray(&visitStack, score + 1);
-        }
-        if (emptySpaces[y + 1][x]) {
-            insertIntArray(&visitStack, y + 1);
-            insertIntArray(&visitStack, x);
-            insertIntArray(&visitStack, score + 1);
-        }
-        if (emptySpaces[y][x - 1]) {
-            insertIntArray(&visitStack, y);
-            insertIntArray(&visitStack, x - 1);
-            insertIntArray(&visitStack, score + 1);
-        }
-        if (emptySpaces[y][x + 1]) {
-            insertIntArray(&visitStack, y);
-            insertIntArray(&visitStack, x + 1);
-            insertIntArray(&visitStack, score + 1);
-        }
+        if (DISPLAY_GAME) displayMaze(maze, droids, numDroids, NULL);
     }
 
-    clock_t end = clock();
-    printf("Problem 01: %d [%.2fms]\n", minScore, (double)(end - start) / CLOCKS_PER_SEC * 1000);
+    // Stopping at the oxygen system leaves the rest of the frontier behind.
+    for (size_t droidIdx = 0; droidIdx < numDroids; droidIdx += 1) freeIntCodeProgram(&droids[droidIdx].program);
+    free(droids);
+    free(nextDroids);
 }
 
-void problem2(char* inputFilePath) {
+int floodMaze(Maze* maze) {
     /*
-    If the oxygen from the found room expands to all neighboring rooms once per minute, find the amount of
-    time for the oxygen to spread throughout all empty spaces.
+    Spreads oxygen from the oxygen system through the mapped maze, a BFS over the cells a minute at a time.
+    Returns the number of minutes it takes to fill every open cell.
+    */
+    bool* hasOxygen = calloc(maze->width * maze->height, sizeof(bool));
 
-    Very similarly to part 1, use the left hand algorithm to map the maze, this time stopping when you've
-    hit the starting point (from the starting direction), instead of when you hit the oxygen room. We need
-    to make sure the whole maze is mapped, unlike part 1 where finding the O2 room was sufficient.
+    IntArray frontier, nextFrontier;
+    initIntArray(&frontier, 16);
+    initIntArray(&nextFrontier, 16);
 
-    Then, again like in part 1, do a DFS. This time do it until you've visited all the nodes, keeping track
-    of the distance of each node to the O2 room, and keeping track of the greatest distance overall.
-    */
-    clock_t start = clock();
+    int oxygenIdx = (maze->oxygenY - maze->minY) * maze->width + (maze->oxygenX - maze->minX);
+    hasOxygen[oxygenIdx] = true;
+    insertIntArray(&frontier, oxygenIdx);
 
-    IntCodeProgram program;
-    initIntCodeProgramFromFile(&program, inputFilePath);
+    int minutes = -1;
+    while (frontier.numItems > 0) {
+        minutes += 1;
+
+        while (frontier.numItems > 0) {
+            int cellIdx = popIntArray(&frontier);
 
-    char outputBuffer[MAX_Y][MAX_X];
-    bool emptySpaces[MAX_Y][MAX_X];
-    int nodeScores[MAX_Y][MAX_X];
+            // Every explored open cell has all of it's neighbors explored too, so none of them are off the edge.
+            int neighbors[4] = {cellIdx - maze->width, cellIdx + maze->width, cellIdx - 1, cellIdx + 1};
+            for (int neighborIdx = 0; neighborIdx < 4; neighborIdx += 1) {
+                int neighbor = neighbors[neighborIdx];
+                if (hasOxygen[neighbor] || maze->cells[neighbor] != OPEN) continue;
 
-    if (DISPLAY_GAME) {
-        for (int row = 0; row < MAX_Y; row += 1) {
-            for (int col = 0; col < MAX_X; col += 1) {
-                outputBuffer[row][col] = '?';
+                hasOxygen[neighbor] = true;
+                insertIntArray(&nextFrontier, neighbor);
             }
         }
-    }
 
-    for (int row = 0; row < MAX_Y; row += 1) {
-        for (int col = 0; col < MAX_X; col += 1) {
-            emptySpaces[row][col] = false;
-            nodeScores[row][col] = INT_MAX;
-        }
+        IntArray swap = frontier;
+        frontier = nextFrontier;
+        nextFrontier = swap;
+
+        if (DISPLAY_GAME) displayMaze(maze, NULL, 0, hasOxygen);
     }
 
-    int destY, destX;
-    int x = 21, y = 21;
-    emptySpaces[y][x] = true;
-
-    long long statusCode;
-    int direction = MOVE_NORTH;
-    pushInput(&program, direction);
-    do {
-        intcodeRun(&program);
-        popOutput(&program, &statusCode);
-
-        // If the droid walks into a wall it turns right.Otherwise it steps forward and turns left.
-        if (statusCode == HIT_WALL) {
-            if (direction == MOVE_NORTH)
-                direction = MOVE_EAST;
-            else if (direction == MOVE_EAST)
-                direction = MOVE_SOUTH;
-            else if (direction == MOVE_SOUTH)
-                direction = MOVE_WEST;
-            else if (direction == MOVE_WEST)
-                direction = MOVE_NORTH;
-        } else {
-            if (direction == MOVE_NORTH) {
-                y -= 1;
-                direction = MOVE_WEST;
-            } else if (direction == MOVE_EAST) {
-                x += 1;
-                direction = MOVE_NORTH;
-            } else if (direction == MOVE_SOUTH) {
-                y += 1;
-                direction = MOVE_EAST;
-            } else if (direction == MOVE_WEST) {
-                x -= 1;
-                direction = MOVE_SOUTH;
-            }
-            emptySpaces[y][x] = true;
-        }
+    freeIntArray(&frontier);
+    freeIntArray(&nextFrontier);
+    free(hasOxygen);
+    return minutes;
+}
 
-        // Store the O2 room to start the below DFS from.
-        if (statusCode == FOUND_OXYGEN_SYSTEM) {
-            destX = x;
-            destY = y;
-        }
+// ================================ Problems ================================
 
-        pushInput(&program, direction);
-
-        if (DISPLAY_GAME) {
-            if (statusCode == MOVED) {
-                outputBuffer[y][x] = '.';
-            } else if (statusCode == HIT_WALL) {
-                // We've already changed direction from the direction the wall was in,
-                // so these checks looks a little wonky
-                if (direction == MOVE_EAST) outputBuffer[y - 1][x] = '#';
-                if (direction == MOVE_WEST) outputBuffer[y + 1][x] = '#';
-                if (direction == MOVE_SOUTH) outputBuffer[y][x + 1] = '#';
-                if (direction == MOVE_NORTH) outputBuffer[y][x - 1] = '#';
-            } else {
-                outputBuffer[y][x] = 'X';
-            }
+void problem1(char* inputFilePath) {
+    /*
+    Given an unknown maze and an IntCode program to explore it, find the shortest path to a specific
+    node in the maze.
 
-            printf("%c[2J%c[;H", (char)27, (char)27);
-            for (int row = 0; row < MAX_Y; row += 1) {
-                for (int col = 0; col < MAX_X; col += 1) {
-                    if (row == y && col == x && outputBuffer[row][col] != 'X')
-                        printf("@");
-                    else
-                        printf("%c", outputBuffer[row][col]);
-                }
-                printf("\n");
-            }
-            usleep(6500);
-        }
+    Instead of walking a single droid around, BFS with a droid per cell on the frontier (see `exploreMaze`).
+    The first droid to reach the oxygen system got there in the fewest moves.
+    */
+    clock_t start = clock();
 
-        // Once we've hit the start facing north again, we've mapped the entire maze.
-        if (x == 21 && y == 21 && direction == MOVE_NORTH) break;
-    } while (true);
-
-    // DFS the entire maze, keeping the furthest distance.
-    IntArray visitStack;
-    initIntArray(&visitStack, MAX_Y * MAX_X * 2);
-
-    insertIntArray(&visitStack, destY);
-    insertIntArray(&visitStack, destX);
-    insertIntArray(&visitStack, 0);
-
-    int maxScore = INT_MIN;
-    int score;
-    while (visitStack.numItems > 0) {
-        score = popIntArray(&visitStack);
-        x = popIntArray(&visitStack);
-        y = popIntArray(&visitStack);
-
-        if (score > maxScore) maxScore = score;
-        if (score > nodeScores[y][x]) continue;
-        nodeScores[y][x] = score;
-
-        // NOTE: The input is bordered, so no need to bounds check.
-        if (emptySpaces[y - 1][x]) {
-            insertIntArray(&visitStack, y - 1);
-            insertIntArray(&visitStack, x);
-            insertIntArray(&visitStack, score + 1);
-        }
-        if (emptySpaces[y + 1][x]) {
-            insertIntArray(&visitStack, y + 1);
-            insertIntArray(&visitStack, x);
-            insertIntArray(&visitStack, score + 1);
-        }
-        if (emptySpaces[y][x - 1]) {
-            insertIntArray(&visitStack, y);
-            insertIntArray(&visitStack, x - 1);
-            insertIntArray(&visitStack, score + 1);
-        }
-        if (emptySpaces[y][x + 1]) {
-            insertIntArray(&visitStack, y);
-            insertIntArray(&visitStack, x + 1);
-            insertIntArray(&visitStack, score + 1);
-        }
+    Maze maze;
+    exploreMaze(inputFilePath, &maze, true);
+    int distance = maze.oxygenDistance;
+    freeMaze(&maze);
 
-        outputBuffer[y][x] = '0';
-        if (DISPLAY_GAME) {
-            printf("%c[2J%c[;H", (char)27, (char)27);
-            for (int row = 0; row < MAX_Y; row += 1) {
-                for (int col = 0; col < MAX_X; col += 1) {
-                    if (row == y && col == x && outputBuffer[row][col] != 'X')
-                        printf("@");
-                    else
-                        printf("%c", outputBuffer[row][col]);
-                }
-                printf("\n");
-            }
-            usleep(6500);
-        }
-    }
+    clock_t end = clock();
+    printf("Problem 01: %d [%.2fms]\n", distance, (double)(end - start) / CLOCKS_PER_SEC * 1000);
+}
+
+void problem2(char* inputFilePath) {
+    /*
+    If the oxygen from the found room expands to all neighboring rooms once per minute, find the amount of
+    time for the oxygen to spread throughout all empty spaces.
+
+    The same BFS as part 1, only this time it keeps going until the frontier runs out, at which point the
+    whole maze is mapped. Then, the oxygen is spread from the oxygen system over the map, no droids needed.
+    */
+    clock_t start = clock();
 
-    // Don't count the starting Oxygen room towards the total time taken.
-    maxScore -= 1;
+    Maze maze;
+    exploreMaze(inputFilePath, &maze, false);
+    int minutes = floodMaze(&maze);
+    freeMaze(&maze);
 
     clock_t end = clock();
-    printf("Problem 02: %d [%.2fms]\n", maxScore, (double)(end - start) / CLOCKS_PER_SEC * 1000);
+    printf("Problem 02: %d [%.2fms]\n", minutes, (double)(end - start) / CLOCKS_PER_SEC * 1000);
 }
 
 /*
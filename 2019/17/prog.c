@@ -2,11 +2,220 @@
 #include <string.h>
 #include <time.h>
 
-#include "../../utils/intcode.c"
+#include "../../utils/intcode_ascii.c"
+#include "../../utils/map.c"
 
 #define MAX_ROWS 100
 #define MAX_COLS 100
 
+// The movement routines, and the functions they call, can be at most 20 chars (not counting the newline).
+#define MAX_ROUTINE_LENGTH 20
+#define NUM_FUNCTIONS 3
+#define MAX_CALLS ((MAX_ROUTINE_LENGTH + 1) / 2)
+#define MAX_PATH_LENGTH 256
+
+// Up, right, down, left, in the order the robot turns right in.
+int DIRECTIONS[4][2] = {{-1, 0}, {0, 1}, {1, 0}, {0, -1}};
+char ROBOT_DIRECTIONS[4] = {'^', '>', 'v', '<'};
+
+/*
+A turn, followed by some number of steps forward.
+*/
+typedef struct {
+    char turn;
+    int steps;
+} Move;
+
+/*
+A movement function, as the run of moves in the path it was first used for.
+*/
+typedef struct {
+    int start;
+    int length;
+} Function;
+
+/*
+Compresses the robot's path into a main routine of calls to movement functions.
+
+- functions: The functions defined so far.
+- calls: The main routine so far, as function indexes.
+- failed: Offsets in the path (along with the functions defined when the robot got there) that couldn't be
+  finished, keyed by "<offset>:<start>,<length>:...", with the most calls there were left when it failed.
+*/
+typedef struct {
+    Move path[MAX_PATH_LENGTH];
+    int pathLength;
+
+    Function functions[NUM_FUNCTIONS];
+    int numFunctions;
+
+    int calls[MAX_CALLS];
+    int numCalls;
+
+    LLongMap failed;
+} Compressor;
+
+void readMap(IntCodeASCII* ascii, char map[MAX_ROWS][MAX_COLS], int* numRows, int* numCols) {
+    /*
+    Reads the camera's map of the scaffold, which is output a row per line, ending with a blank line.
+    */
+    *numRows = 0;
+    *numCols = 0;
+
+    char* line;
+    while (*numRows < MAX_ROWS && readIntCodeLine(ascii, &line) && ascii->lineLength > 0) {
+        *numCols = ascii->lineLength < MAX_COLS ? ascii->lineLength : MAX_COLS;
+        memcpy(map[*numRows], line, *numCols);
+        *numRows += 1;
+    }
+}
+
+bool isScaffold(char map[MAX_ROWS][MAX_COLS], int numRows, int numCols, int row, int col) {
+    return row >= 0 && row < numRows && col >= 0 && col < numCols && map[row][col] != '.';
+}
+
+int findPath(char map[MAX_ROWS][MAX_COLS], int numRows, int numCols, Move* path) {
+    /*
+    Finds the robot's path over the whole scaffold, as a list of moves. The robot goes straight as far as it
+    can (straight through intersections), then turns whichever way the scaffold goes, until it hits a dead
+    end.
+
+    Returns the number of moves in the path.
+    */
+    int row = -1, col = -1, direction = 0;
+    for (int r = 0; r < numRows && row == -1; r += 1) {
+        for (int c = 0; c < numCols && row == -1; c += 1) {
+            char* robot = memchr(ROBOT_DIRECTIONS, map[r][c], 4);
+            if (robot == NULL) continue;
+
+            row = r;
+            col = c;
+            direction = robot - ROBOT_DIRECTIONS;
+        }
+    }
+    if (row == -1) return 0;
+
+    int pathLength = 0;
+    while (pathLength < MAX_PATH_LENGTH) {
+        int left = (direction + 3) % 4, right = (direction + 1) % 4;
+
+        Move* move = &path[pathLength];
+        if (isScaffold(map, numRows, numCols, row + DIRECTIONS[left][0], col + DIRECTIONS[left][1])) {
+            move->turn = 'L';
+            direction = left;
+        } else if (isScaffold(map, numRows, numCols, row + DIRECTIONS[right][0], col + DIRECTIONS[right][1])) {
+            move->turn = 'R';
+            direction = right;
+        } else {
+            break;
+        }
+
+        move->steps = 0;
+        while (isScaffold(map, numRows, numCols, row + DIRECTIONS[direction][0], col + DIRECTIONS[direction][1])) {
+            row += DIRECTIONS[direction][0];
+            col += DIRECTIONS[direction][1];
+            move->steps += 1;
+        }
+
+        pathLength += 1;
+    }
+
+    return pathLength;
+}
+
+int routineLength(Move* moves, int numMoves) {
+    /*
+    Returns the number of chars it takes to write the moves as a routine, i.e., "R,8,L,10".
+    */
+    int length = numMoves > 0 ? numMoves * 4 - 1 : 0;
+    for (int idx = 0; idx < numMoves; idx += 1) {
+        for (int steps = moves[idx].steps; steps >= 10; steps /= 10) length += 1;
+    }
+
+    return length;
+}
+
+bool matchesPath(Move* path, Function* function, int offset) {
+    for (int idx = 0; idx < function->length; idx += 1) {
+        Move* move = &path[function->start + idx];
+        if (move->turn != path[offset + idx].turn || move->steps != path[offset + idx].steps) return false;
+    }
+
+    return true;
+}
+
+bool compressPath(Compressor* compressor, int offset) {
+    /*
+    Covers the rest of the path from the offset with calls to the functions defined so far, defining new ones
+    (from the moves at the offset) while there's any left to define. Searches depth first, remembering the
+    offsets it couldn't finish from, so it never searches the same part of the path with the same functions
+    (and as many or fewer calls left) twice.
+
+    Returns true if the whole path was covered, leaving the main routine in `calls`, otherwise, returns false.
+    */
+    if (offset == compressor->pathLength) return true;
+
+    int callsLeft = MAX_CALLS - compressor->numCalls;
+    if (callsLeft == 0) return false;
+
+    char key[64];
+    int keyLength = sprintf(key, "%d", offset);
+    for (int idx = 0; idx < compressor->numFunctions; idx += 1) {
+        keyLength += sprintf(key + keyLength, ":%d,%d", compressor->functions[idx].start, compressor->functions[idx].length);
+    }
+
+    long long failedCallsLeft;
+    bool hasFailed = getLLongMap(&compressor->failed, key, &failedCallsLeft);
+    if (hasFailed && failedCallsLeft >= callsLeft) return false;
+
+    Move* path = compressor->path;
+    compressor->numCalls += 1;
+
+    // Call one of the functions that matches the path here.
+    for (int idx = 0; idx < compressor->numFunctions; idx += 1) {
+        Function* function = &compressor->functions[idx];
+        if (offset + function->length > compressor->pathLength) continue;
+        if (!matchesPath(path, function, offset)) continue;
+
+        compressor->calls[compressor->numCalls - 1] = idx;
+        if (compressPath(compressor, offset + function->length)) return true;
+    }
+
+    // Or define a new function from the path here, longest first.
+    if (compressor->numFunctions < NUM_FUNCTIONS) {
+        int maxLength = 1;
+        while (offset + maxLength < compressor->pathLength && routineLength(&path[offset], maxLength + 1) <= MAX_ROUTINE_LENGTH) maxLength += 1;
+
+        Function* function = &compressor->functions[compressor->numFunctions];
+        compressor->numFunctions += 1;
+        compressor->calls[compressor->numCalls - 1] = compressor->numFunctions - 1;
+
+        for (int length = maxLength; length > 0; length -= 1) {
+            function->start = offset;
+            function->length = length;
+            if (compressPath(compressor, offset + length)) return true;
+        }
+
+        compressor->numFunctions -= 1;
+    }
+
+    compressor->numCalls -= 1;
+
+    // The map copies the key, and it only gets this far with more calls left than any earlier failure.
+    setLLongMap(&compressor->failed, key, callsLeft);
+    return false;
+}
+
+void writeRoutine(IntCodeASCII* ascii, Move* moves, int numMoves) {
+    char routine[MAX_ROUTINE_LENGTH * 2];
+    int length = 0;
+    for (int idx = 0; idx < numMoves; idx += 1) {
+        length += sprintf(routine + length, "%s%c,%d", idx > 0 ? "," : "", moves[idx].turn, moves[idx].steps);
+    }
+
+    writeIntCodeLine(ascii, routine);
+}
+
 void problem1(char* inputFilePath) {
     /*
     The IntCode program outputs an ASCII-map, the problem is asking to find the number
@@ -20,33 +229,19 @@ void problem1(char* inputFilePath) {
     IntCodeProgram program;
     initIntCodeProgramFromFile(&program, inputFilePath);
 
-    intcodeRun(&program);
-
     char map[MAX_ROWS][MAX_COLS];
+    int numRows, numCols;
 
-    int row = 0, col = 0, numCols = -1;
-    for (int idx = 0; idx < program.output.numItems; idx += 1) {
-        if ((char)program.output.data[idx] == '\n') {
-            // Save the number of cols for the first time.
-            if (numCols == -1) numCols = col + 1;
+    IntCodeASCII ascii;
+    initIntCodeASCII(&ascii, &program);
+    readMap(&ascii, map, &numRows, &numCols);
 
-            row += 1;
-            col = 0;
-
-            continue;
-        }
-
-        map[row][col] = (char)program.output.data[idx];
-
-        col += 1;
-    }
-
-    // Save the number of rows
-    int numRows = row + 1;
+    freeIntCodeASCII(&ascii);
+    freeIntCodeProgram(&program);
 
     int totalAlignment = 0;
-    for (row = 0; row < numRows; row += 1) {
-        for (col = 0; col < numCols; col += 1) {
+    for (int row = 0; row < numRows; row += 1) {
+        for (int col = 0; col < numCols; col += 1) {
             // Can't have an intersection on the border of the map.
             if (row == 0 || row == numRows - 1 || col == 0 || col == numCols - 1) continue;
 
@@ -69,7 +264,8 @@ void problem2(char* inputFilePath) {
     /*
     Program the cleaning robot to traverse the maze, and report it's final output.
 
-    I did this one manually, by printing out the maze and building the commands all by hand.
+    The robot's path over the scaffold is read off the map, and compressed into a main routine calling three
+    movement functions A, B and C (each of which is a run of the path), all within 20 chars.
     */
     clock_t start = clock();
 
@@ -79,28 +275,49 @@ void problem2(char* inputFilePath) {
     // Enable the bot.
     program.program[0] = 2;
 
-    // Program
-    pushInputASCII(&program, "A,B,B,A,C,A,C,A,C,B");
+    IntCodeASCII ascii;
+    initIntCodeASCII(&ascii, &program);
+
+    // The map's still output first.
+    char map[MAX_ROWS][MAX_COLS];
+    int numRows, numCols;
+    readMap(&ascii, map, &numRows, &numCols);
+
+    Compressor compressor;
+    compressor.pathLength = findPath(map, numRows, numCols, compressor.path);
+    compressor.numFunctions = 0;
+    compressor.numCalls = 0;
+    initLLongMap(&compressor.failed);
 
-    // A
-    pushInputASCII(&program, "R,6,R,6,R,8,L,10,L,4");
-    // B
-    pushInputASCII(&program, "R,6,L,10,R,8");
-    // C
-    pushInputASCII(&program, "L,4,L,12,R,6,L,10");
-    // Continuous Feed
-    pushInputASCII(&program, "n");
+    long long dustCollected = -1;
+    if (compressPath(&compressor, 0)) {
+        // Main routine
+        char routine[MAX_CALLS * 2];
+        for (int idx = 0; idx < compressor.numCalls; idx += 1) {
+            routine[idx * 2] = 'A' + compressor.calls[idx];
+            routine[idx * 2 + 1] = idx == compressor.numCalls - 1 ? '\0' : ',';
+        }
+        writeIntCodeLine(&ascii, routine);
+
+        // A, B and C, any the routine doesn't need are left empty.
+        for (int idx = 0; idx < NUM_FUNCTIONS; idx += 1) {
+            Function* function = &compressor.functions[idx];
+            if (idx < compressor.numFunctions) writeRoutine(&ascii, &compressor.path[function->start], function->length);
+            else writeIntCodeLine(&ascii, "");
+        }
 
-    intcodeRun(&program);
+        // Continuous Feed
+        writeIntCodeLine(&ascii, "n");
 
-    // Print the feed, minus the final output which is the non-ASCII answer.
-    for (int idx = 0; idx < program.output.numItems - 1; idx += 1) {
-        printf("%c", (char)program.output.data[idx]);
+        // Skip the prompts, the final output is the non-ASCII answer.
+        char* line;
+        while (readIntCodeLine(&ascii, &line));
+        if (ascii.hasValue) dustCollected = ascii.value;
     }
-    printf("\n");
 
-    long long dustCollected;
-    popOutput(&program, &dustCollected);
+    freeLLongMap(&compressor.failed);
+    freeIntCodeASCII(&ascii);
+    freeIntCodeProgram(&program);
 
     clock_t end = clock();
     printf("Problem 02: %lld [%.2fms]\n", dustCollected, (double)(end - start) / CLOCKS_PER_SEC * 1000);
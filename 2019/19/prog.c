@@ -4,34 +4,329 @@
 #include <string.h>
 #include <time.h>
 
-#include "../../utils/intcode.c"
+#include "../../utils/intcode_batch.c"
+#include "../../utils/map.c"
 
 #define MAX_ROWS 50
 #define MAX_COLS 50
 
 #define SHIP_LENGTH 100
 
+// The number of columns probed per edge, per batch.
+#define PROBE_WINDOW 8
+
+// The spacing between columns when looking for the beam in a row from scratch. The beam is always wider
+// than this past the first few rows.
+#define BEAM_SCAN_STEP 4
+
+// How much wider the beam can look than it really is at a row, with each of it's edges rounded to a whole
+// column (by less than a column each), see `problem2`.
+#define EDGE_ROUNDING 2
+
+/*
+Probes the beam with the drone program, caching every probe, and running probes in parallel batches.
+
+- probes: If each (x, y) probed is in the beam, keyed by "x,y".
+- pending: The (x, y) of each queued probe that hasn't run yet, back to back.
+- numRuns: The number of times the drone program has been run.
+- refRow, refLeft, refRight: The edges of the last row found, used to guess the edges of other rows.
+*/
+typedef struct {
+    IntCodeProgram* program;
+
+    LLongMap probes;
+    LLongArray pending;
+    size_t numRuns;
+
+    long long refRow;
+    long long refLeft;
+    long long refRight;
+} BeamTracer;
+
+/*
+A search for one edge of the beam in a row, narrowing down the columns between the last one known to be in
+the beam (`inside`) and the first one known to be out of it (`outside`), on the edge's side.
+
+- direction: -1 for the left edge, 1 for the right edge.
+- candidates: The columns probed in the current round, in the order they're checked in.
+*/
+typedef struct {
+    int direction;
+
+    bool hasInside;
+    long long inside;
+    bool hasOutside;
+    long long outside;
+
+    long long candidates[PROBE_WINDOW];
+    int numCandidates;
+} EdgeSearch;
+
+// ================================ Probing ================================
+
+void initBeamTracer(BeamTracer* tracer, IntCodeProgram* program) {
+    tracer->program = program;
+
+    initLLongMap(&tracer->probes);
+    initLLongArray(&tracer->pending, 2 * PROBE_WINDOW * 2);
+    tracer->numRuns = 0;
+
+    tracer->refRow = -1;
+    tracer->refLeft = 0;
+    tracer->refRight = 0;
+}
+
+void freeBeamTracer(BeamTracer* tracer) {
+    /*
+    Frees the probe cache, but not the program.
+    */
+    freeLLongMap(&tracer->probes);
+    freeLLongArray(&tracer->pending);
+}
+
+void queueProbe(BeamTracer* tracer, long long x, long long y) {
+    /*
+    Queues a probe of (x, y) for the next batch, unless it's already been probed (or queued).
+    */
+    if (x < 0 || y < 0) return;
+
+    char key[48];
+    long long inBeam;
+    sprintf(key, "%lld,%lld", x, y);
+    if (getLLongMap(&tracer->probes, key, &inBeam)) return;
+
+    // There's only ever a couple of windows worth of probes queued at once.
+    for (size_t idx = 0; idx < tracer->pending.numItems; idx += 2) {
+        if (tracer->pending.data[idx] == x && tracer->pending.data[idx + 1] == y) return;
+    }
+
+    insertLLongArray(&tracer->pending, x);
+    insertLLongArray(&tracer->pending, y);
+}
+
+void runProbes(BeamTracer* tracer) {
+    /*
+    Runs every queued probe at once, as a batch, caching the results.
+    */
+    size_t numProbes = tracer->pending.numItems / 2;
+    if (numProbes == 0) return;
+
+    IntCodeBatch batch;
+    initIntCodeBatch(&batch, tracer->program, 0);
+    for (size_t probeIdx = 0; probeIdx < numProbes; probeIdx += 1) addIntCodeJob(&batch, tracer->pending.data + probeIdx * 2, 2);
+
+    runIntCodeBatch(&batch);
+
+    char key[48];
+    for (size_t probeIdx = 0; probeIdx < numProbes; probeIdx += 1) {
+        sprintf(key, "%lld,%lld", tracer->pending.data[probeIdx * 2], tracer->pending.data[probeIdx * 2 + 1]);
+        setLLongMap(&tracer->probes, key, batch.jobs[probeIdx].result);
+    }
+
+    tracer->numRuns += numProbes;
+    tracer->pending.numItems = 0;
+    freeIntCodeBatch(&batch);
+}
+
+bool isInBeam(BeamTracer* tracer, long long x, long long y) {
+    /*
+    Returns if (x, y) is in the beam, which has to have been probed already, anything off the grid isn't.
+    */
+    if (x < 0 || y < 0) return false;
+
+    char key[48];
+    long long inBeam = 0;
+    sprintf(key, "%lld,%lld", x, y);
+    getLLongMap(&tracer->probes, key, &inBeam);
+    return inBeam == 1;
+}
+
+// ================================ Tracing ================================
+
+void initEdgeSearch(EdgeSearch* search, int direction) {
+    search->direction = direction;
+    search->hasInside = false;
+    search->inside = 0;
+    search->hasOutside = false;
+    search->outside = 0;
+    search->numCandidates = 0;
+}
+
+bool queueEdgeSearch(BeamTracer* tracer, EdgeSearch* search, long long y, long long guess) {
+    /*
+    Queues the next round of probes for the search, starting from the guess if nothing's known yet. Returns
+    false once the edge has been found, so there's nothing left to probe.
+
+    Until the edge is bracketed, the search gallops away from the side it's on (1, 2, 4, ... columns), and
+    once it is, the columns in between are split into PROBE_WINDOW + 1 even parts, probing every split at
+    once.
+    */
+    search->numCandidates = 0;
+
+    if (!search->hasInside && !search->hasOutside) {
+        search->candidates[search->numCandidates++] = guess;
+    } else if (!search->hasOutside) {
+        for (int idx = 0; idx < PROBE_WINDOW; idx += 1) search->candidates[search->numCandidates++] = search->inside + search->direction * (1LL << idx);
+    } else if (!search->hasInside) {
+        for (int idx = 0; idx < PROBE_WINDOW; idx += 1) search->candidates[search->numCandidates++] = search->outside - search->direction * (1LL << idx);
+    } else {
+        long long gap = (search->outside - search->inside) * search->direction;
+        if (gap <= 1) return false;
+
+        long long last = search->inside;
+        for (int idx = 1; idx <= PROBE_WINDOW; idx += 1) {
+            long long x = search->inside + search->direction * (gap * idx / (PROBE_WINDOW + 1));
+            if (x == last || x == search->outside) continue;
+            search->candidates[search->numCandidates++] = x;
+            last = x;
+        }
+    }
+
+    for (int idx = 0; idx < search->numCandidates; idx += 1) queueProbe(tracer, search->candidates[idx], y);
+    return true;
+}
+
+void updateEdgeSearch(BeamTracer* tracer, EdgeSearch* search, long long y) {
+    /*
+    Narrows the search down with the results of it's last round of probes.
+    */
+    bool gallopingIn = search->hasOutside && !search->hasInside;
+
+    for (int idx = 0; idx < search->numCandidates; idx += 1) {
+        long long x = search->candidates[idx];
+        bool inBeam = isInBeam(tracer, x, y);
+
+        // Galloping in from outside the beam, the first probe in it brackets the edge. Otherwise, the
+        // first probe out of it does.
+        if (inBeam) {
+            search->hasInside = true;
+            search->inside = x;
+            if (gallopingIn) break;
+        } else {
+            search->hasOutside = true;
+            search->outside = x;
+            if (!gallopingIn) break;
+        }
+    }
+}
+
+bool findBeamColumn(BeamTracer* tracer, long long y, long long* x) {
+    /*
+    Scans the row for any column in the beam, from the left, BEAM_SCAN_STEP columns at a time. Returns false
+    if the beam isn't anywhere close to the row's diagonal.
+    */
+    for (long long start = 0; start <= y * 8; start += PROBE_WINDOW * BEAM_SCAN_STEP) {
+        for (int idx = 0; idx < PROBE_WINDOW; idx += 1) queueProbe(tracer, start + idx * BEAM_SCAN_STEP, y);
+        runProbes(tracer);
+
+        for (int idx = 0; idx < PROBE_WINDOW; idx += 1) {
+            if (!isInBeam(tracer, start + idx * BEAM_SCAN_STEP, y)) continue;
+            *x = start + idx * BEAM_SCAN_STEP;
+            return true;
+        }
+    }
+    return false;
+}
+
+void findBeamEdges(BeamTracer* tracer, long long y, long long* left, long long* right) {
+    /*
+    Finds the first and last columns of the beam in the row.
+
+    The beam's edges are (close to) straight lines from the origin, so the edges of the last row found are
+    scaled to this row as a first guess, which is usually only a few columns off. Both edges are then
+    searched for at the same time, each round of both searches running as a single batch.
+    */
+    EdgeSearch leftSearch, rightSearch;
+    initEdgeSearch(&leftSearch, -1);
+    initEdgeSearch(&rightSearch, 1);
+
+    long long leftGuess, rightGuess;
+    if (tracer->refRow == -1) {
+        // Nothing's known about the beam yet, find a column in it the slow way.
+        long long x;
+        if (!findBeamColumn(tracer, y, &x)) {
+            printf("No beam in row %lld\n", y);
+            exit(1);
+        }
+        leftSearch.hasInside = rightSearch.hasInside = true;
+        leftSearch.inside = rightSearch.inside = x;
+        leftGuess = rightGuess = x;
+    } else {
+        leftGuess = tracer->refLeft * y / tracer->refRow;
+        rightGuess = tracer->refRight * y / tracer->refRow;
+    }
+
+    while (true) {
+        bool leftQueued = queueEdgeSearch(tracer, &leftSearch, y, leftGuess);
+        bool rightQueued = queueEdgeSearch(tracer, &rightSearch, y, rightGuess);
+        if (!leftQueued && !rightQueued) break;
+
+        runProbes(tracer);
+        if (leftQueued) updateEdgeSearch(tracer, &leftSearch, y);
+        if (rightQueued) updateEdgeSearch(tracer, &rightSearch, y);
+    }
+
+    *left = leftSearch.inside;
+    *right = rightSearch.inside;
+
+    tracer->refRow = y;
+    tracer->refLeft = *left;
+    tracer->refRight = *right;
+}
+
+long long shipRoom(BeamTracer* tracer, long long y, long long* x) {
+    /*
+    Returns the number of columns the ship has to fit in with it's top edge at the row, from the left edge of
+    the beam at it's bottom row to the right edge of the beam at it's top row, storing the column it's left
+    edge would be at.
+    */
+    long long topLeft, topRight, bottomLeft, bottomRight;
+    findBeamEdges(tracer, y, &topLeft, &topRight);
+    findBeamEdges(tracer, y + SHIP_LENGTH - 1, &bottomLeft, &bottomRight);
+
+    *x = bottomLeft;
+    return topRight - bottomLeft + 1;
+}
+
+bool canFitShip(BeamTracer* tracer, long long y, long long* x) {
+    /*
+    Returns if the ship fits in the beam with it's top edge at the row, storing the column it's left edge
+    would be at.
+    */
+    return shipRoom(tracer, y, x) >= SHIP_LENGTH;
+}
+
+// ================================ Problems ================================
+
 void problem1(char* inputFilePath) {
     /*
     Simply provide all the coordinates in the given range, and count the number of coords in
     the beam range.
+
+    Each coordinate is an independent run of the drone program, so they're all run at once as a batch.
     */
     clock_t start = clock();
 
     IntCodeProgram program;
     initIntCodeProgramFromFile(&program, inputFilePath);
 
+    IntCodeBatch batch;
+    initIntCodeBatch(&batch, &program, 0);
+    for (int row = 0; row < MAX_ROWS; row += 1) {
+        for (int col = 0; col < MAX_COLS; col += 1) {
+            long long coords[2] = {col, row};
+            addIntCodeJob(&batch, coords, 2);
+        }
+    }
+
+    runIntCodeBatch(&batch);
+
     long long countInBeamRange = 0;
     long long inBeamRange;
     for (int row = 0; row < MAX_ROWS; row += 1) {
         for (int col = 0; col < MAX_COLS; col += 1) {
-            clearInput(&program);
-            pushInput(&program, col);
-            pushInput(&program, row);
-
-            intcodeRun(&program);
+            inBeamRange = batch.jobs[row * MAX_COLS + col].result;
 
-            popOutput(&program, &inBeamRange);
             countInBeamRange += inBeamRange;
             if (inBeamRange)
                 printf("#");
@@ -41,85 +336,75 @@ void problem1(char* inputFilePath) {
         printf("\n");
     }
 
+    freeIntCodeBatch(&batch);
+    freeIntCodeProgram(&program);
+
     clock_t end = clock();
     printf("Problem 01: %lld [%.2fms]\n", countInBeamRange, (double)(end - start) / CLOCKS_PER_SEC * 1000);
 }
 
 void problem2(char* inputFilePath) {
     /*
-    Basically brute-forcing a bunch of different coordinates, but with more restrictions on the coords we check.
+    Find the closest spot the ship (a SHIP_LENGTH square) fits in the beam.
+
+    The square fits with it's top edge at row `y` if the right edge of the beam at row `y` is at least
+    SHIP_LENGTH - 1 past the left edge of the beam at the bottom row. The beam widens as it goes, but it's
+    edges are rounded to whole columns, so the ship doesn't just keep fitting once it fits, the fit can
+    flicker on and off for a stretch of rows first. Past that stretch it does keep fitting, so binary search
+    for a row it fits at, only ever tracking the edges of the rows the search lands on (see
+    `findBeamEdges`), then scan back over the stretch before it for the first row it fits at.
 
-    Knowing that the beam is continuous, we can stop checking the current row when we've hit a non-beam space
-    after the beam space, and the next row's beam must start at or after the last row's col.
+    The room the ship has grows by the difference of the edges' slopes every row, but can look up to
+    EDGE_ROUNDING columns smaller than that at any one row. So the room at the rows already checked caps
+    the room at every row before them, and the scan stops once that cap is too small for the ship.
 
-    Whenever we hit a beam spot, check if the spot a ship's length down and right are also beam spots, if so,
-    we've found the spot the ship can fit in.
+    Probes are cached, so the rows near the end of the search, which overlap a lot, barely run the drone at
+    all.
     */
     clock_t start = clock();
 
     IntCodeProgram program;
     initIntCodeProgramFromFile(&program, inputFilePath);
 
-    int startBeamCol = -1;
-    long long inBeamRange;
-    // Somewhat of an educated guess about a starting row, col the ship absolutely cannot be at.
-    int row = SHIP_LENGTH * 5, col = SHIP_LENGTH;
-    while (true) {
-        clearInput(&program);
-        pushInput(&program, col);
-        pushInput(&program, row);
-
-        intcodeRun(&program);
-
-        popOutput(&program, &inBeamRange);
-
-        if (!inBeamRange) {
-            // Finished the beams for this row, continue on to the next
-            if (startBeamCol != -1) {
-                row += 1;
-                col = startBeamCol;
-                startBeamCol = -1;
-            } else {
-                // Haven't found the beam yet, keep going.
-                col += 1;
-            }
-        } else {
-            // Found the start of this row's beam.
-            if (startBeamCol == -1) startBeamCol = col;
-
-            // Check right
-            clearInput(&program);
-            pushInput(&program, col + SHIP_LENGTH - 1);
-            pushInput(&program, row);
+    BeamTracer tracer;
+    initBeamTracer(&tracer, &program);
 
-            intcodeRun(&program);
-
-            popOutput(&program, &inBeamRange);
-            if (!inBeamRange) {
-                // Move on to check the next column.
-                col += 1;
-                continue;
-            };
-
-            // Check down
-            clearInput(&program);
-            pushInput(&program, col);
-            pushInput(&program, row + SHIP_LENGTH - 1);
-
-            intcodeRun(&program);
+    // Double the row until the ship fits, then binary search between the last two.
+    long long low = SHIP_LENGTH, high = SHIP_LENGTH * 2, x;
+    while (!canFitShip(&tracer, high, &x)) {
+        low = high;
+        high *= 2;
+    }
+    while (high - low > 1) {
+        long long mid = low + (high - low) / 2;
+        if (canFitShip(&tracer, mid, &x))
+            high = mid;
+        else
+            low = mid;
+    }
 
-            popOutput(&program, &inBeamRange);
+    // Scan back for the first row the ship fits at, while any row could still have room for it. `maxRoom`
+    // is the most room the row being scanned could have, given the rows after it. The reference edges are
+    // rounded inwards, so the widening they give is never more than the real one.
+    double widening = (double)tracer.refRight / tracer.refRow - (double)tracer.refLeft / tracer.refRow;
+    double maxRoom = shipRoom(&tracer, high, &x) + EDGE_ROUNDING - widening;
 
-            // If both right and down are also in range, we've found a spot the ship can fit in.
-            if (inBeamRange) break;
+    long long row = high;
+    for (long long scanRow = high - 1; maxRoom >= SHIP_LENGTH && scanRow > SHIP_LENGTH; scanRow -= 1) {
+        long long room = shipRoom(&tracer, scanRow, &x);
+        if (room >= SHIP_LENGTH) row = scanRow;
 
-            // Otherwise, move on to the next column.
-            col += 1;
-        }
+        if (room + EDGE_ROUNDING < maxRoom) maxRoom = room + EDGE_ROUNDING;
+        maxRoom -= widening;
     }
+    canFitShip(&tracer, row, &x);
+
+    size_t numRuns = tracer.numRuns;
+    freeBeamTracer(&tracer);
+    freeIntCodeProgram(&program);
 
     clock_t end = clock();
-    printf("Problem 02: %d [%.2fms]\n", col * 10000 + row, (double)(end - start) / CLOCKS_PER_SEC * 1000);
+    printf("Problem 02: %lld in %zu runs [%.2fms]\n", x * 10000 + row, numRuns, (double)(end - start) / CLOCKS_PER_SEC * 1000);
 }
 
 /*
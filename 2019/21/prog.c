@@ -1,138 +1,499 @@
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
-#include "../../utils/intcode.c"
+#include "../../utils/intcode_batch.c"
 
-void problem1(char* inputFilePath) {
-    clock_t start = clock();
+/*
+Springdroids have a sensor that can detect whether there is ground at various distances in the direction
+it is facing; these values are provided in read-only registers A (one tile away) to D (four tiles away) when
+walking, and up to I (nine tiles away) when running. If there is ground at the given distance, the register
+will be true; if there is a hole, the register will be false.
 
-    IntCodeProgram program;
-    initIntCodeProgramFromFile(&program, inputFilePath);
+There are only three instructions available in springscript, and a program can have at most 15 of them:
 
-    /*
-    Springdroids have a sensor that can detect whether there is ground at various distances in the direction
-    it is facing; these values are provided in read-only registers. Your springdroid can detect ground at four
-    distances:
-        one tile away (A)
-        two tiles away (B)
-        three tiles away (C)
-        and four tiles away (D)
+AND X Y sets Y to true if both X and Y are true; otherwise, it sets Y to false.
+OR X Y sets Y to true if at least one of X or Y is true; otherwise, it sets Y to false.
+NOT X Y sets Y to true if X is false; otherwise, it sets Y to false.
+
+Y has to be one of the two writable registers, T (temporary) and J (jump), which both start off false
+every time the program runs. If J is true at the end, the droid jumps, landing 4 tiles ahead.
+
+Rather than writing springscript by hand, it's synthesized: programs are enumerated shortest first, and
+checked against every hull the droid has fallen through so far, on the host. Only programs that make it
+across all of them are run on the Intcode VM (a batch of them at a time, across every core). When they
+fail, the hull they fell through is read out of the output, and the search starts over with one more hull
+to check against.
+*/
+
+#define MAX_INSTRUCTIONS 15
+#define MAX_SENSORS 9
+#define NUM_REGISTERS (MAX_SENSORS + 2)
+#define T_REGISTER MAX_SENSORS
+#define J_REGISTER (MAX_SENSORS + 1)
+
+// Every possible reading of the sensors, and the words it takes for a truth table to have a bit for each.
+#define MAX_SITUATIONS (1 << MAX_SENSORS)
+#define MAX_TABLE_WORDS (MAX_SITUATIONS / 64)
+
+#define MAX_HULLS 64
+#define MAX_HULL_LENGTH 128
+#define MAX_ROUNDS 64
+
+// The number of candidate programs run on the VM at once.
+#define CANDIDATES_PER_ROUND 8
+
+// The max number of distinct program states enumerated per round, must be a power of two.
+#define MAX_STATES (1 << 18)
 
-    If there is ground at the given distance, the register will be true; if there is a hole, the register will be false.
+char REGISTER_NAMES[NUM_REGISTERS] = {'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'T', 'J'};
 
-    There are only three instructions available in springscript:
+typedef enum { AND, OR, NOT } Operation;
+char* OPERATION_NAMES[3] = {"AND", "OR", "NOT"};
 
-    AND X Y sets Y to true if both X and Y are true; otherwise, it sets Y to false.
-    OR X Y sets Y to true if at least one of X or Y is true; otherwise, it sets Y to false.
-    NOT X Y sets Y to true if X is false; otherwise, it sets Y to false.
+typedef struct {
+    Operation operation;
+    int x;
+    int y;
+} Instruction;
+
+/*
+A stretch of hull the droid fell through, from where it started.
+*/
+typedef struct {
+    bool ground[MAX_HULL_LENGTH];
+    int length;
+} Hull;
+
+/*
+Enumerates springscript programs.
+
+Hulls:
+- hulls: Every hull the droid has fallen through so far.
+- situations: Every sensor reading the droid could have on those hulls (as a bitmask of the sensors, one bit
+  per sensor), each of which gets a bit in the truth tables, at it's index in `situationIdxs`.
+- sensors: The truth table of each sensor register.
+
+Enumerating:
+- tables: The truth tables of T and J for each program state, `numWords` words each. Two programs with the
+  same tables act the same on every hull seen so far, so only the shortest one is kept.
+- live: Whether T is live in each state (see `isCanonical`).
+- parents, instructions: The state each state came from, and the instruction that got it there, to
+  rebuild it's program from.
+- slots: A hash table of state indexes (-1 marks an empty slot), to find duplicate states.
+*/
+typedef struct {
+    int numSensors;
+    char* command;
+
+    Hull hulls[MAX_HULLS];
+    int numHulls;
+
+    int situations[MAX_SITUATIONS];
+    int situationIdxs[MAX_SITUATIONS];
+    int numSituations;
+    int numWords;
+    unsigned long long sensors[MAX_SENSORS][MAX_TABLE_WORDS];
+
+    unsigned long long* tables;
+    bool* live;
+    int* parents;
+    Instruction* instructions;
+    int numStates;
+    int* slots;
+} Synthesizer;
+
+// ================================ Hulls ================================
+
+int senseHull(Hull* hull, int position, int numSensors) {
+    /*
+    Returns the sensor reading of the droid at the position on the hull, past the end of which is all ground.
+    */
+    int situation = 0;
+    for (int sensor = 0; sensor < numSensors; sensor += 1) {
+        int tile = position + sensor + 1;
+        if (tile >= hull->length || hull->ground[tile]) situation |= 1 << sensor;
+    }
+
+    return situation;
+}
+
+bool crossHull(Synthesizer* synth, Hull* hull, unsigned long long* jump) {
+    /*
+    Walks the droid across the hull, jumping wherever the jump truth table says to. Returns false if it falls
+    in a hole, otherwise, returns true.
     */
+    int position = 0;
+    while (position < hull->length) {
+        if (!hull->ground[position]) return false;
 
+        int idx = synth->situationIdxs[senseHull(hull, position, synth->numSensors)];
+        position += (jump[idx / 64] >> (idx % 64)) & 1 ? 4 : 1;
+    }
+
+    return true;
+}
+
+bool parseHull(long long* output, size_t outputSize, Hull* hull) {
     /*
-    JUMP
-        @
-        ##.##.##
+    Reads the hull out of a failed run's output, which shows the droid (@) at the start of the hull, right
+    above it:
 
+    @................
+    #####.#..########
 
+    Returns false if there's no hull in the output, otherwise, returns true.
     */
+    size_t idx = 0;
+    while (idx < outputSize && output[idx] != '@') idx += 1;
+    if (idx == outputSize) return false;
+
+    // The droid's column, and the start of the next line.
+    size_t column = 0;
+    while (idx > column && output[idx - column - 1] != '\n') column += 1;
+    while (idx < outputSize && output[idx] != '\n') idx += 1;
+    idx += 1 + column;
+
+    hull->length = 0;
+    while (idx < outputSize && (output[idx] == '#' || output[idx] == '.') && hull->length < MAX_HULL_LENGTH) {
+        hull->ground[hull->length] = output[idx] == '#';
+        hull->length += 1;
+        idx += 1;
+    }
+
+    return hull->length > 0;
+}
 
-    // GROUND = TRUE, HOLE = FALSE
+bool addHull(Synthesizer* synth, Hull* hull) {
+    /*
+    Adds the hull to the ones checked against, giving any new situations the droid could see on it a bit in
+    the truth tables. Returns false if it's already been added (or there's no room left), otherwise, returns
+    true.
+    */
+    for (int hullIdx = 0; hullIdx < synth->numHulls; hullIdx += 1) {
+        Hull* other = &synth->hulls[hullIdx];
+        if (other->length == hull->length && memcmp(other->ground, hull->ground, hull->length * sizeof(bool)) == 0) return false;
+    }
+    if (synth->numHulls == MAX_HULLS) return false;
 
-    // Store if 2 is hole in T
-    pushInputASCII(&program, "NOT B T");
-    // Store if 3 is hole in J.
-    pushInputASCII(&program, "NOT C J");
-    // Store if 2 OR 3 is hole in J
-    pushInputASCII(&program, "OR T J");
-    // And if 4 is safe, jump
-    pushInputASCII(&program, "AND D J");
-    // else if there's an empty space right in front of you, jump (base case).
-    pushInputASCII(&program, "NOT A T");
-    pushInputASCII(&program, "OR T J");
+    synth->hulls[synth->numHulls] = *hull;
+    synth->numHulls += 1;
 
-    pushInputASCII(&program, "WALK");
+    for (int position = 0; position < hull->length; position += 1) {
+        int situation = senseHull(hull, position, synth->numSensors);
+        if (synth->situationIdxs[situation] != -1) continue;
 
-    intcodeRun(&program);
+        int idx = synth->numSituations;
+        synth->situationIdxs[situation] = idx;
+        synth->situations[idx] = situation;
+        synth->numSituations += 1;
 
-    // Print the feed, minus the final output which is the non-ASCII answer.
-    for (int idx = 0; idx < program.output.numItems - 1; idx += 1) {
-        printf("%c", (char)program.output.data[idx]);
+        for (int sensor = 0; sensor < synth->numSensors; sensor += 1) {
+            if ((situation >> sensor) & 1) synth->sensors[sensor][idx / 64] |= 1ull << (idx % 64);
+        }
     }
-    printf("\n");
 
-    long long hullDamage;
-    popOutput(&program, &hullDamage);
+    synth->numWords = (synth->numSituations + 63) / 64;
+    if (synth->numWords == 0) synth->numWords = 1;
+    return true;
+}
 
-    clock_t end = clock();
-    printf("Problem 01: %lld [%.2fms]\n", hullDamage, (double)(end - start) / CLOCKS_PER_SEC * 1000);
+// ================================ Synthesizing ================================
+
+void initSynthesizer(Synthesizer* synth, int numSensors, char* command) {
+    synth->numSensors = numSensors;
+    synth->command = command;
+
+    synth->numHulls = 0;
+    synth->numSituations = 0;
+    synth->numWords = 1;
+    for (int situation = 0; situation < MAX_SITUATIONS; situation += 1) synth->situationIdxs[situation] = -1;
+    memset(synth->sensors, 0, sizeof(synth->sensors));
+
+    synth->tables = malloc(MAX_STATES * 2 * MAX_TABLE_WORDS * sizeof(unsigned long long));
+    synth->live = malloc(MAX_STATES * sizeof(bool));
+    synth->parents = malloc(MAX_STATES * sizeof(int));
+    synth->instructions = malloc(MAX_STATES * sizeof(Instruction));
+    synth->slots = malloc(2 * MAX_STATES * sizeof(int));
+    synth->numStates = 0;
 }
 
-void problem2(char* inputFilePath) {
-    clock_t start = clock();
+void freeSynthesizer(Synthesizer* synth) {
+    free(synth->tables);
+    free(synth->live);
+    free(synth->parents);
+    free(synth->instructions);
+    free(synth->slots);
+    synth->tables = NULL;
+    synth->live = NULL;
+    synth->parents = NULL;
+    synth->instructions = NULL;
+    synth->slots = NULL;
+}
 
-    IntCodeProgram program;
-    initIntCodeProgramFromFile(&program, inputFilePath);
+unsigned long long* stateTables(Synthesizer* synth, int stateIdx) {
+    // The T table, followed by the J table.
+    return synth->tables + (size_t)stateIdx * 2 * synth->numWords;
+}
+
+unsigned long long hashTables(unsigned long long* tables, int numWords) {
+    unsigned long long hash = 0;
+    for (int idx = 0; idx < 2 * numWords; idx += 1) {
+        hash = (hash ^ tables[idx]) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 29;
+    }
+
+    return hash;
+}
+
+bool isCanonical(bool live, Operation operation, int x, int y) {
+    /*
+    Only programs in a canonical form are enumerated, where T is only ever used to work out a single value
+    that's then folded into J. Working it out starts with a NOT, so it doesn't matter what was in T before,
+    and in between, T is dead. Most useful programs can be written this way, and it means states that only
+    differ in a dead T are the same state.
+
+    While T is dead, J can be combined with a sensor, or a new value started in T. While it's live, T can be
+    combined with a sensor, or folded into J.
+    */
+    if (!live) {
+        if (y == J_REGISTER) return x < T_REGISTER || (operation == NOT && x == J_REGISTER);
+        return operation == NOT && x != T_REGISTER;
+    }
+
+    if (y == T_REGISTER) return x < T_REGISTER ? operation != NOT : operation == NOT && x == T_REGISTER;
+    return x == T_REGISTER;
+}
+
+bool addState(Synthesizer* synth, int parent, Instruction instruction, bool live) {
+    /*
+    Adds the state in the next free slot of `tables` (already filled in) as a new state, unless there's
+    already a state with the same truth tables (and T live or dead). Returns true if it was added.
+    */
+    int numWords = synth->numWords;
+    unsigned long long* tables = stateTables(synth, synth->numStates);
+
+    size_t mask = 2 * MAX_STATES - 1;
+    size_t slot = (hashTables(tables, numWords) + live) & mask;
+    while (synth->slots[slot] != -1) {
+        int other = synth->slots[slot];
+        if (synth->live[other] == live && memcmp(stateTables(synth, other), tables, 2 * numWords * sizeof(unsigned long long)) == 0) return false;
+        slot = (slot + 1) & mask;
+    }
 
+    synth->slots[slot] = synth->numStates;
+    synth->live[synth->numStates] = live;
+    synth->parents[synth->numStates] = parent;
+    synth->instructions[synth->numStates] = instruction;
+    synth->numStates += 1;
+    return true;
+}
+
+bool isCandidate(Synthesizer* synth, int stateIdx, int* candidates, int numCandidates) {
     /*
-    Springdroids have a sensor that can detect whether there is ground at various distances in the direction
-    it is facing; these values are provided in read-only registers. Your springdroid can detect ground at four
-    distances:
-        one tile away (A)
-        two tiles away (B)
-        three tiles away (C)
-        and four tiles away (D)
-        Register E indicates whether there is ground five tiles away.
-        Register F indicates whether there is ground six tiles away.
-        Register G indicates whether there is ground seven tiles away.
-        Register H indicates whether there is ground eight tiles away.
-        Register I indicates whether there is ground nine tiles away.
-
-    If there is ground at the given distance, the register will be true; if there is a hole, the register will be false.
-
-    There are only three instructions available in springscript:
-
-    AND X Y sets Y to true if both X and Y are true; otherwise, it sets Y to false.
-    OR X Y sets Y to true if at least one of X or Y is true; otherwise, it sets Y to false.
-    NOT X Y sets Y to true if X is false; otherwise, it sets Y to false.
+    A state's program is a candidate if it makes it across every hull so far, and jumps differently to every
+    other candidate (on those hulls).
     */
+    int numWords = synth->numWords;
+    unsigned long long* jump = stateTables(synth, stateIdx) + numWords;
+
+    for (int idx = 0; idx < numCandidates; idx += 1) {
+        if (memcmp(stateTables(synth, candidates[idx]) + numWords, jump, numWords * sizeof(unsigned long long)) == 0) return false;
+    }
+
+    for (int hullIdx = 0; hullIdx < synth->numHulls; hullIdx += 1) {
+        if (!crossHull(synth, &synth->hulls[hullIdx], jump)) return false;
+    }
+
+    return true;
+}
+
+int findCandidates(Synthesizer* synth, int sensors, int* candidates, int maxCandidates) {
+    /*
+    Enumerates programs that only read the given sensors (a bitmask), breadth first (so shortest first), by
+    the truth tables of T and J they end up with, storing the states of up to `maxCandidates` programs that
+    make it across every hull so far.
+
+    Returns the number of candidates found.
+    */
+    int numWords = synth->numWords;
+    size_t tableSize = numWords * sizeof(unsigned long long);
+    unsigned long long full[MAX_TABLE_WORDS];
+    for (int word = 0; word < numWords; word += 1) {
+        int numBits = synth->numSituations - word * 64;
+        full[word] = numBits >= 64 ? ~0ull : (1ull << (numBits > 0 ? numBits : 0)) - 1;
+    }
+
+    for (size_t slot = 0; slot < 2 * MAX_STATES; slot += 1) synth->slots[slot] = -1;
+    synth->numStates = 0;
+
+    // The empty program, with T and J both false.
+    memset(stateTables(synth, 0), 0, 2 * tableSize);
+    Instruction none = {AND, 0, 0};
+    addState(synth, -1, none, false);
+
+    int numCandidates = 0;
+    if (isCandidate(synth, 0, candidates, numCandidates)) candidates[numCandidates++] = 0;
+
+    int depthStart = 0;
+    for (int depth = 1; depth <= MAX_INSTRUCTIONS && numCandidates < maxCandidates; depth += 1) {
+        int depthEnd = synth->numStates;
+
+        for (int stateIdx = depthStart; stateIdx < depthEnd && numCandidates < maxCandidates; stateIdx += 1) {
+            for (int op = AND; op <= NOT; op += 1) {
+                for (int x = 0; x < NUM_REGISTERS; x += 1) {
+                    if (x < T_REGISTER && !((sensors >> x) & 1)) continue;
+
+                    for (int y = T_REGISTER; y <= J_REGISTER; y += 1) {
+                        if (!isCanonical(synth->live[stateIdx], op, x, y)) continue;
+                        if (synth->numStates == MAX_STATES || numCandidates == maxCandidates) return numCandidates;
+
+                        unsigned long long* from = stateTables(synth, stateIdx);
+                        unsigned long long* to = stateTables(synth, synth->numStates);
+                        memcpy(to, from, 2 * tableSize);
+
+                        unsigned long long* xTable = x == T_REGISTER ? from : x == J_REGISTER ? from + numWords : synth->sensors[x];
+                        unsigned long long* yTable = y == T_REGISTER ? to : to + numWords;
+                        for (int word = 0; word < numWords; word += 1) {
+                            if (op == AND) yTable[word] &= xTable[word];
+                            else if (op == OR) yTable[word] |= xTable[word];
+                            else yTable[word] = ~xTable[word] & full[word];
+                        }
+
+                        // Once T's been folded into J, it's dead.
+                        bool live = y == T_REGISTER;
+                        if (!live) memset(to, 0, tableSize);
+
+                        Instruction instruction = {op, x, y};
+                        if (!addState(synth, stateIdx, instruction, live)) continue;
+                        if (isCandidate(synth, synth->numStates - 1, candidates, numCandidates)) candidates[numCandidates++] = synth->numStates - 1;
+                    }
+                }
+            }
+        }
+
+        depthStart = depthEnd;
+    }
+
+    return numCandidates;
+}
 
+size_t writeProgram(Synthesizer* synth, int stateIdx, long long* input) {
     /*
-    JUMP
-        @
-        ##.##.##
+    Writes the springscript program that got to the state, ending with the command to start the droid, to
+    the input as ASCII. Returns the length of the input.
+    */
+    Instruction instructions[MAX_INSTRUCTIONS];
+    int numInstructions = 0;
+    for (int idx = stateIdx; synth->parents[idx] != -1; idx = synth->parents[idx]) instructions[numInstructions++] = synth->instructions[idx];
+
+    char line[16];
+    size_t inputSize = 0;
+    for (int idx = numInstructions - 1; idx >= -1; idx -= 1) {
+        if (idx >= 0) {
+            Instruction* instruction = &instructions[idx];
+            snprintf(line, sizeof(line), "%s %c %c\n", OPERATION_NAMES[instruction->operation], REGISTER_NAMES[instruction->x],
+                     REGISTER_NAMES[instruction->y]);
+        } else {
+            snprintf(line, sizeof(line), "%s\n", synth->command);
+        }
+
+        for (char* c = line; *c != '\0'; c += 1) input[inputSize++] = *c;
+    }
 
+    return inputSize;
+}
 
+long long synthesize(IntCodeProgram* program, int numSensors, char* command) {
+    /*
+    Finds a springscript program that gets the droid across the hull, and returns the hull damage it reports,
+    or -1 if it couldn't find one.
+
+    Each round, a batch of candidate programs (that make it across every hull seen so far) are run on the
+    VM in parallel. Any that fail add the hull they fell through to the ones to check against, until one
+    makes it.
     */
+    Synthesizer synth;
+    initSynthesizer(&synth, numSensors, command);
+
+    // Programs that read fewer sensors have far fewer states to enumerate, so the sensors are added a few at
+    // a time: A to D always, then every combination of the rest, fewest first. Once a set of sensors has no
+    // candidates (or too many states to find one in), it won't with more hulls to check against either.
+    int numExtras = numSensors - 4;
+    int sensorSets[1 << (MAX_SENSORS - 4)];
+    int numSensorSets = 0;
+    for (int numExtra = 0; numExtra <= numExtras; numExtra += 1) {
+        for (int extras = 0; extras < (1 << numExtras); extras += 1) {
+            if (__builtin_popcount(extras) == numExtra) sensorSets[numSensorSets++] = 0xF | (extras << 4);
+        }
+    }
 
-    // GROUND = TRUE, HOLE = FALSE
-
-    // Store if 2 is hole in T
-    pushInputASCII(&program, "NOT B T");
-    // Store if 3 is hole in J.
-    pushInputASCII(&program, "NOT C J");
-    // Store if 2 OR 3 is hole in J
-    pushInputASCII(&program, "OR T J");
-    // And if 4 is safe, jump
-    pushInputASCII(&program, "AND D J");
-    // AND if 8 is also safe, jump. If 8 is not safe, we'll have to jump a little later, because if not
-    // an immediate jump will kill the robot.
-    pushInputASCII(&program, "AND H J");
-    // else if there's an empty space right in front of you, jump (base case).
-    pushInputASCII(&program, "NOT A T");
-    pushInputASCII(&program, "OR T J");
-
-    pushInputASCII(&program, "RUN");
-
-    intcodeRun(&program);
-
-    // Print the feed, minus the final output which is the non-ASCII answer.
-    for (int idx = 0; idx < program.output.numItems - 1; idx += 1) {
-        printf("%c", (char)program.output.data[idx]);
+    long long hullDamage = -1;
+    long long input[(MAX_INSTRUCTIONS + 1) * 16];
+    int candidates[CANDIDATES_PER_ROUND];
+    int sensorSet = 0;
+
+    for (int round = 0; round < MAX_ROUNDS && hullDamage == -1; round += 1) {
+        int numCandidates = 0;
+        while (sensorSet < numSensorSets && numCandidates == 0) {
+            numCandidates = findCandidates(&synth, sensorSets[sensorSet], candidates, CANDIDATES_PER_ROUND);
+            if (numCandidates == 0) sensorSet += 1;
+        }
+        if (numCandidates == 0) break;
+
+        IntCodeBatch batch;
+        initIntCodeBatch(&batch, program, 0);
+        for (int idx = 0; idx < numCandidates; idx += 1) addIntCodeJob(&batch, input, writeProgram(&synth, candidates[idx], input));
+        runIntCodeBatch(&batch);
+
+        // The hull damage is the only output that isn't ASCII.
+        bool learned = false;
+        for (size_t jobIdx = 0; jobIdx < batch.numJobs && hullDamage == -1; jobIdx += 1) {
+            IntCodeJob* job = &batch.jobs[jobIdx];
+            if (job->result > 127) {
+                hullDamage = job->result;
+                break;
+            }
+
+            Hull hull;
+            if (parseHull(job->output, job->outputSize, &hull) && addHull(&synth, &hull)) learned = true;
+        }
+
+        freeIntCodeBatch(&batch);
+
+        // Nothing new to go on, so the next round would try the exact same programs.
+        if (hullDamage == -1 && !learned) break;
     }
-    printf("\n");
 
-    long long hullDamage;
-    popOutput(&program, &hullDamage);
+    freeSynthesizer(&synth);
+    return hullDamage;
+}
+
+void problem1(char* inputFilePath) {
+    clock_t start = clock();
+
+    IntCodeProgram program;
+    initIntCodeProgramFromFile(&program, inputFilePath);
+
+    long long hullDamage = synthesize(&program, 4, "WALK");
+
+    freeIntCodeProgram(&program);
+
+    clock_t end = clock();
+    printf("Problem 01: %lld [%.2fms]\n", hullDamage, (double)(end - start) / CLOCKS_PER_SEC * 1000);
+}
+
+void problem2(char* inputFilePath) {
+    clock_t start = clock();
+
+    IntCodeProgram program;
+    initIntCodeProgramFromFile(&program, inputFilePath);
+
+    long long hullDamage = synthesize(&program, 9, "RUN");
+
+    freeIntCodeProgram(&program);
 
     clock_t end = clock();
     printf("Problem 02: %lld [%.2fms]\n", hullDamage, (double)(end - start) / CLOCKS_PER_SEC * 1000);
@@ -2,212 +2,109 @@
 #include <string.h>
 #include <time.h>
 
-#include "../../utils/intcode.c"
+#include "../../utils/intcode_network.c"
 
 #define NETWORK_SIZE 50
+#define NAT_ADDRESS 255
 
-void problem1(char* inputFilePath) {
+/*
+The NAT, which holds on to the last packet sent to address 255, and sends it to pc 0 whenever the network
+goes idle.
+*/
+typedef struct {
+    bool stopOnFirstPacket;
+    bool hasPacket;
+    long long packet[2];
+    long long prevY;
+} Nat;
+
+int routePacket(IntCodeNetwork* network, int networkAddress, long long* packet) {
     /*
-    Pretty simple - initialize 50 pcs with the program and continuously run them in sequence until
-    a packet to 255 is encountered.
+    Routes the packet (address, X, Y) to the pc at it's address. Packets to the NAT are stored, overriding
+    any previous packet (as per the problem description).
+    */
+    if (packet[0] != NAT_ADDRESS) return packet[0];
 
-    To run each pc, first forward any incoming packets to the pc, or -1 otherwise. Then run it, and push all
-    the outgoing packets to the packet queue for the outgoing pcs to consume the next time they run.
+    Nat* nat = network->context;
+    nat->hasPacket = true;
+    nat->packet[0] = packet[1];
+    nat->packet[1] = packet[2];
+
+    if (nat->stopOnFirstPacket) stopIntCodeNetwork(network);
+    return DROP_MESSAGE;
+}
+
+bool wakeNetwork(IntCodeNetwork* network) {
+    /*
+    When the network is idle, the NAT sends it's stored packet to pc 0 to kick it off again. If it's about
+    to send the same Y value twice in a row, we're done.
     */
-    clock_t start = clock();
+    Nat* nat = network->context;
+    if (!nat->hasPacket || nat->packet[1] == nat->prevY) return false;
 
-    FILE* inputFile = fopen(inputFilePath, "r");
-    char* line = NULL;
-    size_t lineCap = 0;
-    ssize_t lineLen;
+    nat->prevY = nat->packet[1];
+    return sendToIntCodeNode(network, 0, nat->packet, 2);
+}
 
-    // Parse the input file, to initialize the network from.
-    LLongArray input;
-    initLLongArray(&input, 500);
-    lineLen = getline(&line, &lineCap, inputFile);
+void runNetwork(char* inputFilePath, Nat* nat) {
+    /*
+    Initializes 50 pcs with the program, each with it's network address as the first input, and runs them
+    as an Intcode network until it stops.
 
-    int parserEndIdx = 0;
-    while (parserEndIdx < lineLen - 1) insertLLongArray(&input, parseNumber(line, parserEndIdx, &parserEndIdx));
-    fclose(inputFile);
+    Each pc's output is chopped up into packets (address, X, Y), with only X and Y delivered to the pc at
+    that address. Pcs with no incoming packets are given -1, and the network goes idle once every pc has been
+    given -1 without sending anything.
+    */
+    IntCodeProgram program;
+    initIntCodeProgramFromFile(&program, inputFilePath);
 
-    // Initialize the network.
-    IntCodeProgram network[NETWORK_SIZE];
+    IntCodeNetwork network;
+    initIntCodeNetwork(&network, &program, NETWORK_SIZE);
     for (int networkAddress = 0; networkAddress < NETWORK_SIZE; networkAddress += 1) {
-        initIntCodeProgramFromLLongArray(&network[networkAddress], &input);
-        pushInput(&network[networkAddress], networkAddress);
+        pushInput(&network.nodes[networkAddress].program, networkAddress);
     }
-    IntCodeProgram* pc;
 
-    // The packets (X1, Y1, X2, Y2, ...) for each pc in the network.
-    LLongArray packetQueue[NETWORK_SIZE];
-    for (int networkAddress = 0; networkAddress < NETWORK_SIZE; networkAddress += 1) {
-        initLLongArray(&packetQueue[networkAddress], 100);
-    }
+    network.messageSize = 3;
+    network.headerSize = 1;
+    network.route = routePacket;
+    network.hasIdleInput = true;
+    network.idleInput = -1;
+    network.onIdle = wakeNetwork;
+    network.context = nat;
 
-    // Until we encounter an outgoing packet to 255, run the network, forwarding the output packets
-    // of each pc.
-    long long outgoingNetworkAddress, x, y;
-    while (true) {
-        for (int networkAddress = 0; networkAddress < NETWORK_SIZE; networkAddress += 1) {
-            pc = &network[networkAddress];
-
-            // If there are fresh incoming packets for the network, send them all, otherwise send -1.
-            if (packetQueue[networkAddress].numItems > 0) {
-                for (int idx = 0; idx < packetQueue[networkAddress].numItems; idx += 2) {
-                    x = packetQueue[networkAddress].data[idx];
-                    y = packetQueue[networkAddress].data[idx + 1];
-
-                    pushInput(pc, x);
-                    pushInput(pc, y);
-                }
-
-                // We've processed all the packets, clear the queue.
-                packetQueue[networkAddress].numItems = 0;
-            } else {
-                pushInput(pc, -1);
-            }
-
-            // Run the program.
-            intcodeRun(pc);
-
-            // Store the output packet in the queue.
-            for (int idx = 0; idx < pc->output.numItems; idx += 3) {
-                outgoingNetworkAddress = pc->output.data[idx];
-                x = pc->output.data[idx + 1];
-                y = pc->output.data[idx + 2];
-
-                // Found the first packet to 255, we're done.
-                if (outgoingNetworkAddress == 255) break;
-
-                // Queue the packet for the next time the outgoing pc is run.
-                insertLLongArray(&packetQueue[outgoingNetworkAddress], x);
-                insertLLongArray(&packetQueue[outgoingNetworkAddress], y);
-            }
-
-            // We've forwarded all the packets, clear the output.
-            pc->output.numItems = 0;
-        }
-
-        // Found the first packet to 255, we're done.
-        if (outgoingNetworkAddress == 255) break;
-    }
+    runIntCodeNetwork(&network);
 
-    clock_t end = clock();
-    printf("Problem 01: X=%lld, Y=%lld [%.2fms]\n", x, y, (double)(end - start) / CLOCKS_PER_SEC * 1000);
+    freeIntCodeNetwork(&network);
+    freeIntCodeProgram(&program);
 }
 
-void problem2(char* inputFilePath) {
+void problem1(char* inputFilePath) {
     /*
-    Very similar to part 1. This time store outgoing packets to 255, and if no packets get sent or
-    received, forward the stored 255 packet to pc 0 to re-kick-off the network.
-
-    Stop when the same packet gets forwarded to pc 0 twice in a row.
+    Pretty simple - run the network until the first packet to 255 is sent.
     */
     clock_t start = clock();
 
-    FILE* inputFile = fopen(inputFilePath, "r");
-    char* line = NULL;
-    size_t lineCap = 0;
-    ssize_t lineLen;
-
-    // Parse the input file, to initialize the network from.
-    LLongArray input;
-    initLLongArray(&input, 500);
-    lineLen = getline(&line, &lineCap, inputFile);
+    Nat nat = {.stopOnFirstPacket = true, .hasPacket = false, .prevY = -1};
+    runNetwork(inputFilePath, &nat);
 
-    int parserEndIdx = 0;
-    while (parserEndIdx < lineLen - 1) insertLLongArray(&input, parseNumber(line, parserEndIdx, &parserEndIdx));
-    fclose(inputFile);
-
-    // Initialize the network.
-    IntCodeProgram network[NETWORK_SIZE];
-    for (int networkAddress = 0; networkAddress < NETWORK_SIZE; networkAddress += 1) {
-        initIntCodeProgramFromLLongArray(&network[networkAddress], &input);
-        pushInput(&network[networkAddress], networkAddress);
-    }
+    clock_t end = clock();
+    printf("Problem 01: X=%lld, Y=%lld [%.2fms]\n", nat.packet[0], nat.packet[1], (double)(end - start) / CLOCKS_PER_SEC * 1000);
+}
 
-    IntCodeProgram* pc;
+void problem2(char* inputFilePath) {
+    /*
+    Very similar to part 1. This time store outgoing packets to 255, and if the network goes idle, forward
+    the stored 255 packet to pc 0 to re-kick-off the network.
 
-    // The packets (X1, Y1, X2, Y2, ...) for each pc in the network.
-    LLongArray packetQueue[NETWORK_SIZE];
-    for (int networkAddress = 0; networkAddress < NETWORK_SIZE; networkAddress += 1) {
-        initLLongArray(&packetQueue[networkAddress], 100);
-    }
+    Stop when the same Y value gets forwarded to pc 0 twice in a row.
+    */
+    clock_t start = clock();
 
-    // Until the NAT pc sends the same output twice in a row to pc 0, send packets between the pcs. When the
-    // network is idle (no incoming or outgoing packets), the NAT will kick start the network again with it's
-    // stored packet (natX, natY).
-    int sentPackets, numOutputs;
-    long long prevNatX = -1, prevNatY = -1, natX, natY;
-    long long outgoingNetworkAddress = 1, x = 2, y = 3;
-    while (true) {
-        sentPackets = 0;
-        numOutputs = 0;
-
-        // Process all the pcs in the network, sending and receiving packets.
-        for (int networkAddress = 0; networkAddress < NETWORK_SIZE; networkAddress += 1) {
-            pc = &network[networkAddress];
-
-            // If there are fresh incoming packets for the network, send them all, otherwise send -1.
-            if (packetQueue[networkAddress].numItems > 0) {
-                for (int idx = 0; idx < packetQueue[networkAddress].numItems; idx += 2) {
-                    sentPackets += 1;
-
-                    x = packetQueue[networkAddress].data[idx];
-                    y = packetQueue[networkAddress].data[idx + 1];
-
-                    pushInput(pc, x);
-                    pushInput(pc, y);
-                }
-
-                // We've processed all the packets, clear the queue.
-                packetQueue[networkAddress].numItems = 0;
-            } else {
-                pushInput(pc, -1);
-            }
-
-            // Run the program.
-            intcodeRun(pc);
-
-            // Store the output packet in the queue.
-            for (int idx = 0; idx < pc->output.numItems; idx += 3) {
-                numOutputs += 1;
-
-                outgoingNetworkAddress = pc->output.data[idx];
-                x = pc->output.data[idx + 1];
-                y = pc->output.data[idx + 2];
-
-                // If the outgoing address is to the NAT pc, store the packet without worrying about
-                // overriding previous packets (as per the project description).
-                //
-                // Otherwise, queue the packet as normal.
-                if (outgoingNetworkAddress == 255) {
-                    natX = x;
-                    natY = y;
-                } else {
-                    insertLLongArray(&packetQueue[outgoingNetworkAddress], x);
-                    insertLLongArray(&packetQueue[outgoingNetworkAddress], y);
-                }
-            }
-
-            // We've forwarded all the packets, clear the output.
-            pc->output.numItems = 0;
-        }
-
-        // If no packets were sent or received, send the NAT packet to pc 0 to kick off the network again.
-        if (sentPackets == 0 && numOutputs == 0) {
-            // If sending the same packet to pc 0 twice in a row, we're done.
-            if (natX == prevNatX && natY == prevNatY) break;
-
-            prevNatX = natX;
-            prevNatY = natY;
-            insertLLongArray(&packetQueue[0], natX);
-            insertLLongArray(&packetQueue[0], natY);
-        }
-    }
+    Nat nat = {.stopOnFirstPacket = false, .hasPacket = false, .prevY = -1};
+    runNetwork(inputFilePath, &nat);
 
     clock_t end = clock();
-    printf("Problem 02: X=%lld, Y=%lld [%.2fms]\n", natX, natY, (double)(end - start) / CLOCKS_PER_SEC * 1000);
+    printf("Problem 02: X=%lld, Y=%lld [%.2fms]\n", nat.packet[0], nat.packet[1], (double)(end - start) / CLOCKS_PER_SEC * 1000);
 }
 
 /*
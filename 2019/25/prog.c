@@ -1,45 +1,467 @@
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
-#include "../../utils/intcode.c"
+#include "../../utils/intcode_ascii.c"
+
+#define MAX_ROOMS 64
+#define MAX_ROOM_ITEMS 8
+#define MAX_ITEMS 32
+#define MAX_NAME_LENGTH 64
+#define NUM_DIRECTIONS 4
+
+// Any more lines than this in response to a single command, and the program's stuck in a loop.
+#define MAX_RESPONSE_LINES 256
+
+// How many states the explored state cache can hold, must be a power of two.
+#define STATE_CACHE_SIZE 1024
+
+// What's behind a door, when it isn't a room (yet).
+#define UNEXPLORED -1
+#define NO_DOOR -2
+#define PRESSURE_SENSITIVE_FLOOR -3
+
+// In order, so the opposite of a direction is 2 along.
+char* DIRECTIONS[NUM_DIRECTIONS] = {"north", "east", "south", "west"};
+
+typedef enum { NO_SECTION, DOORS_SECTION, ITEMS_SECTION } ResponseSection;
+
+/*
+Everything worth knowing in what the program printed in response to a command.
+
+- room: The last room the droid was in, if `hasRoom` is set, and the doors and items in it.
+- ejected: The pressure-sensitive floor sent the droid back to the checkpoint.
+- stuck: Something the droid's holding is keeping it from moving.
+- looping: The program wouldn't stop printing.
+- halted: The game's over, if it's won, `password` is set.
+*/
+typedef struct {
+    char room[MAX_NAME_LENGTH];
+    bool hasRoom;
+    bool doors[NUM_DIRECTIONS];
+    char items[MAX_ROOM_ITEMS][MAX_NAME_LENGTH];
+    int numItems;
+
+    bool ejected;
+    bool stuck;
+    bool looping;
+    bool halted;
+    long long password;
+} Response;
+
+/*
+A room on the ship, with where each of it's doors go, and the droid just after it walked in (holding
+nothing), to fork from.
+*/
+typedef struct {
+    char name[MAX_NAME_LENGTH];
+    int doors[NUM_DIRECTIONS];
+    char items[MAX_ROOM_ITEMS][MAX_NAME_LENGTH];
+    int numItems;
+    IntCodeProgram droid;
+} Room;
+
+/*
+An item that's safe to pick up, and the room it's in.
+*/
+typedef struct {
+    char name[MAX_NAME_LENGTH];
+    int room;
+} Item;
+
+/*
+A state of the droid that's been explored, by a hash of it's memory (0 marks an empty slot), and the room
+it's in.
+*/
+typedef struct {
+    unsigned long long hash;
+    int room;
+} State;
+
+/*
+The map of the ship, with the room in front of the pressure-sensitive floor and the direction it's in.
+
+Every state of the droid explored so far is kept in `states`, so a move that puts the droid back in a
+state it's already been in (like walking back the way it came) is known without looking up where it ended
+up by name.
+*/
+typedef struct {
+    Room rooms[MAX_ROOMS];
+    int numRooms;
+
+    int checkpoint;
+    int floorDirection;
+
+    Item items[MAX_ITEMS];
+    int numItems;
+
+    State states[STATE_CACHE_SIZE];
+    int numStates;
+} Ship;
+
+// ================================ Commands ================================
+
+void copyName(char* dest, char* src, size_t length) {
+    /*
+    Copies the first `length` chars of the name, cutting it short if it's too long to fit.
+    */
+    if (length > MAX_NAME_LENGTH - 1) length = MAX_NAME_LENGTH - 1;
+    memcpy(dest, src, length);
+    dest[length] = '\0';
+}
+
+void parseResponseLine(Response* response, char* line, ResponseSection* section) {
+    /*
+    Parses a line of the program's output into the response. Lists (of doors or items) run from their
+    heading to the next empty line.
+    */
+    size_t length = strlen(line);
+
+    if (length >= 6 && strncmp(line, "== ", 3) == 0) {
+        // A new room, anything about the previous one is out of date.
+        copyName(response->room, line + 3, length - 6);
+        response->hasRoom = true;
+        memset(response->doors, 0, sizeof(response->doors));
+        response->numItems = 0;
+        *section = NO_SECTION;
+    } else if (strcmp(line, "Doors here lead:") == 0) {
+        *section = DOORS_SECTION;
+    } else if (strcmp(line, "Items here:") == 0) {
+        *section = ITEMS_SECTION;
+    } else if (strncmp(line, "- ", 2) == 0) {
+        if (*section == DOORS_SECTION) {
+            for (int direction = 0; direction < NUM_DIRECTIONS; direction += 1) {
+                if (strcmp(line + 2, DIRECTIONS[direction]) == 0) response->doors[direction] = true;
+            }
+        } else if (*section == ITEMS_SECTION && response->numItems < MAX_ROOM_ITEMS) {
+            copyName(response->items[response->numItems], line + 2, length - 2);
+            response->numItems += 1;
+        }
+    } else if (length == 0) {
+        *section = NO_SECTION;
+    }
+
+    if (strstr(line, "ejected back") != NULL) response->ejected = true;
+    if (strstr(line, "can't move") != NULL) response->stuck = true;
+
+    char* password = strstr(line, "typing ");
+    if (password != NULL) response->password = atoll(password + 7);
+}
+
+void runCommand(IntCodeProgram* droid, char* command, Response* response) {
+    /*
+    Sends the command to the droid (or nothing, if it's NULL), and runs it until it asks for the next one,
+    parsing what it prints into the response.
+    */
+    memset(response, 0, sizeof(Response));
+    response->password = -1;
+
+    IntCodeASCII ascii;
+    initIntCodeASCII(&ascii, droid);
+    if (command != NULL) writeIntCodeLine(&ascii, command);
+
+    ResponseSection section = NO_SECTION;
+    int numLines = 0;
+    char* line;
+    while (readIntCodeLine(&ascii, &line)) {
+        numLines += 1;
+        if (numLines > MAX_RESPONSE_LINES) {
+            response->looping = true;
+            break;
+        }
+
+        parseResponseLine(response, line, &section);
+    }
+
+    response->halted = ascii.finished;
+    freeIntCodeASCII(&ascii);
+}
+
+// ================================ Exploring ================================
+
+State* findState(Ship* ship, unsigned long long hash) {
+    /*
+    Finds the droid's state in the explored states by it's hash, or the empty slot it would go in. Returns
+    NULL if there's no room left for it.
+    */
+    if (ship->numStates >= STATE_CACHE_SIZE / 2) return NULL;
+
+    size_t slot = hash & (STATE_CACHE_SIZE - 1);
+    while (ship->states[slot].hash != 0 && ship->states[slot].hash != hash) slot = (slot + 1) & (STATE_CACHE_SIZE - 1);
+
+    return &ship->states[slot];
+}
+
+void cacheState(Ship* ship, unsigned long long hash, int roomIdx) {
+    State* state = findState(ship, hash);
+    if (state == NULL || state->hash != 0) return;
+
+    state->hash = hash;
+    state->room = roomIdx;
+    ship->numStates += 1;
+}
+
+unsigned long long hashDroid(IntCodeProgram* droid) {
+    unsigned long long hash = hashIntCodeProgram(droid);
+    return hash == 0 ? 1 : hash;
+}
+
+int findRoom(Ship* ship, char* name) {
+    for (int roomIdx = 0; roomIdx < ship->numRooms; roomIdx += 1) {
+        if (strcmp(ship->rooms[roomIdx].name, name) == 0) return roomIdx;
+    }
+
+    return -1;
+}
+
+int addRoom(Ship* ship, Response* response, IntCodeProgram* droid) {
+    /*
+    Adds the room the droid just walked into to the map, taking ownership of the droid. Returns the room's
+    index, or -1 if the map is full (freeing the droid).
+    */
+    if (ship->numRooms == MAX_ROOMS) {
+        freeIntCodeProgram(droid);
+        return -1;
+    }
+
+    Room* room = &ship->rooms[ship->numRooms];
+    strcpy(room->name, response->room);
+    for (int direction = 0; direction < NUM_DIRECTIONS; direction += 1) {
+        room->doors[direction] = response->doors[direction] ? UNEXPLORED : NO_DOOR;
+    }
+    memcpy(room->items, response->items, sizeof(room->items));
+    room->numItems = response->numItems;
+    room->droid = *droid;
+
+    ship->numRooms += 1;
+    return ship->numRooms - 1;
+}
+
+void exploreShip(Ship* ship, IntCodeProgram* program) {
+    /*
+    Maps out the ship, breadth first from where the droid starts, by forking the droid in each room and
+    walking it through every door. The rooms list doubles as the queue, each room being expanded once when
+    it's first found.
+
+    Walking onto the pressure-sensitive floor (without the right weight) ejects the droid back, which is how
+    the checkpoint is found.
+    */
+    IntCodeProgram droid;
+    forkIntCodeProgram(program, &droid);
+
+    Response response;
+    runCommand(&droid, NULL, &response);
+    cacheState(ship, hashDroid(&droid), addRoom(ship, &response, &droid));
+
+    for (int roomIdx = 0; roomIdx < ship->numRooms; roomIdx += 1) {
+        Room* room = &ship->rooms[roomIdx];
+
+        for (int direction = 0; direction < NUM_DIRECTIONS; direction += 1) {
+            if (room->doors[direction] != UNEXPLORED) continue;
+
+            IntCodeProgram next;
+            forkIntCodeProgram(&room->droid, &next);
+            runCommand(&next, DIRECTIONS[direction], &response);
+
+            if (response.ejected) {
+                ship->checkpoint = roomIdx;
+                ship->floorDirection = direction;
+                room->doors[direction] = PRESSURE_SENSITIVE_FLOOR;
+                freeIntCodeProgram(&next);
+                continue;
+            }
+
+            // A state that's been explored already is a room that's on the map already.
+            unsigned long long hash = hashDroid(&next);
+            State* state = findState(ship, hash);
+            if (state != NULL && state->hash == hash) {
+                room->doors[direction] = state->room;
+                freeIntCodeProgram(&next);
+                continue;
+            }
+
+            if (response.halted || !response.hasRoom) {
+                room->doors[direction] = NO_DOOR;
+                freeIntCodeProgram(&next);
+                continue;
+            }
+
+            int nextIdx = findRoom(ship, response.room);
+            if (nextIdx == -1) {
+                nextIdx = addRoom(ship, &response, &next);
+                if (nextIdx == -1) {
+                    room->doors[direction] = NO_DOOR;
+                    continue;
+                }
+            } else {
+                freeIntCodeProgram(&next);
+            }
+            cacheState(ship, hash, nextIdx);
+
+            room->doors[direction] = nextIdx;
+            Room* nextRoom = &ship->rooms[nextIdx];
+            int back = (direction + 2) % NUM_DIRECTIONS;
+            if (nextRoom->doors[back] == UNEXPLORED) nextRoom->doors[back] = roomIdx;
+        }
+    }
+}
+
+bool isItemSafe(Room* room, char* item) {
+    /*
+    Tests picking up the item in a fork of the droid in the room. Some items end the game when they're
+    picked up, one sends the program into a loop, and one sticks to the droid so it can't move.
+    */
+    IntCodeProgram droid;
+    forkIntCodeProgram(&room->droid, &droid);
+
+    char command[MAX_NAME_LENGTH + 8];
+    snprintf(command, sizeof(command), "take %s", item);
+
+    Response response;
+    runCommand(&droid, command, &response);
+    bool safe = !response.halted && !response.looping;
+
+    // Try walking out through any door.
+    for (int direction = 0; safe && direction < NUM_DIRECTIONS; direction += 1) {
+        if (room->doors[direction] < 0) continue;
+
+        runCommand(&droid, DIRECTIONS[direction], &response);
+        safe = !response.halted && !response.looping && !response.stuck;
+        break;
+    }
+
+    freeIntCodeProgram(&droid);
+    return safe;
+}
+
+void findSafeItems(Ship* ship) {
+    for (int roomIdx = 0; roomIdx < ship->numRooms; roomIdx += 1) {
+        Room* room = &ship->rooms[roomIdx];
+
+        for (int itemIdx = 0; itemIdx < room->numItems && ship->numItems < MAX_ITEMS; itemIdx += 1) {
+            if (!isItemSafe(room, room->items[itemIdx])) continue;
+
+            strcpy(ship->items[ship->numItems].name, room->items[itemIdx]);
+            ship->items[ship->numItems].room = roomIdx;
+            ship->numItems += 1;
+        }
+    }
+}
+
+// ================================ Walking ================================
+
+void walkTo(Ship* ship, IntCodeProgram* droid, int* roomIdx, int targetIdx) {
+    /*
+    Walks the droid along the shortest path on the map from it's room to the target room.
+    */
+    int prevRoom[MAX_ROOMS];
+    int prevDirection[MAX_ROOMS];
+    for (int idx = 0; idx < ship->numRooms; idx += 1) prevRoom[idx] = -1;
+
+    int queue[MAX_ROOMS];
+    int queueStart = 0, queueEnd = 0;
+    queue[queueEnd++] = *roomIdx;
+    prevRoom[*roomIdx] = *roomIdx;
+
+    while (queueStart < queueEnd && prevRoom[targetIdx] == -1) {
+        int current = queue[queueStart++];
+
+        for (int direction = 0; direction < NUM_DIRECTIONS; direction += 1) {
+            int next = ship->rooms[current].doors[direction];
+            if (next < 0 || prevRoom[next] != -1) continue;
+
+            prevRoom[next] = current;
+            prevDirection[next] = direction;
+            queue[queueEnd++] = next;
+        }
+    }
+
+    // Trace the path back from the target, then walk it forwards.
+    int path[MAX_ROOMS];
+    int pathLength = 0;
+    for (int current = targetIdx; current != *roomIdx; current = prevRoom[current]) {
+        path[pathLength++] = prevDirection[current];
+    }
+
+    Response response;
+    while (pathLength > 0) runCommand(droid, DIRECTIONS[path[--pathLength]], &response);
+
+    *roomIdx = targetIdx;
+}
+
+long long passCheckpoint(Ship* ship, IntCodeProgram* droid) {
+    /*
+    With every safe item in hand at the checkpoint, tries every subset of them on the pressure-sensitive
+    floor, in Gray code order so that each try only drops or picks up a single item. Returns the password,
+    or -1 if no subset works.
+    */
+    char command[MAX_NAME_LENGTH + 8];
+    Response response;
+
+    for (long long step = 0; step < (1ll << ship->numItems); step += 1) {
+        if (step > 0) {
+            // The item that changes between consecutive Gray codes is the lowest set bit of the step.
+            int itemIdx = 0;
+            while (((step >> itemIdx) & 1) == 0) itemIdx += 1;
+
+            long long dropped = step ^ (step >> 1);
+            snprintf(command, sizeof(command), "%s %s", (dropped >> itemIdx) & 1 ? "drop" : "take", ship->items[itemIdx].name);
+            runCommand(droid, command, &response);
+        }
+
+        runCommand(droid, DIRECTIONS[ship->floorDirection], &response);
+        if (response.halted) return response.password;
+    }
+
+    return -1;
+}
 
 void problem1(char* inputFilePath) {
     /*
-    It's a text adventure game! I played it manually.
+    It's a text adventure game! The droid has to find the right items on the ship to weigh exactly enough
+    for the pressure-sensitive floor past the security checkpoint.
+
+    The ship is explored first (from forks of the droid, no walking back and forth), and each item is tested
+    in a fork to see if it's safe to pick up. Then one droid picks up every safe item, walks to the checkpoint
+    and tries every combination of them on the floor.
     */
     clock_t start = clock();
 
     IntCodeProgram program;
     initIntCodeProgramFromFile(&program, inputFilePath);
 
-    char input;
-    while (true) {
-        // Run the program.
-        intcodeRun(&program);
-
-        // Print the output.
-        for (int idx = 0; idx < program.output.numItems; idx += 1) {
-            printf("%c", (char)program.output.data[idx]);
-        }
-        printf("\n");
+    Ship* ship = calloc(1, sizeof(Ship));
+    ship->checkpoint = -1;
+    exploreShip(ship, &program);
+    findSafeItems(ship);
 
-        // If the program's halted, it's over.
-        if (program.halted) break;
+    long long password = -1;
+    if (ship->checkpoint != -1) {
+        IntCodeProgram droid;
+        forkIntCodeProgram(&ship->rooms[0].droid, &droid);
 
-        // Input command.
-        while (input != '\n') {
-            scanf("%c", &input);
-            pushInput(&program, (int)input);
+        char command[MAX_NAME_LENGTH + 8];
+        Response response;
+        int roomIdx = 0;
+        for (int itemIdx = 0; itemIdx < ship->numItems; itemIdx += 1) {
+            walkTo(ship, &droid, &roomIdx, ship->items[itemIdx].room);
+            snprintf(command, sizeof(command), "take %s", ship->items[itemIdx].name);
+            runCommand(&droid, command, &response);
         }
+        walkTo(ship, &droid, &roomIdx, ship->checkpoint);
 
-        // Reset I/O.
-        input = '\0';
-        clearOutput(&program);
+        password = passCheckpoint(ship, &droid);
+        freeIntCodeProgram(&droid);
     }
 
+    for (int roomIdx = 0; roomIdx < ship->numRooms; roomIdx += 1) freeIntCodeProgram(&ship->rooms[roomIdx].droid);
+    free(ship);
+    freeIntCodeProgram(&program);
+
     clock_t end = clock();
-    printf("Problem 01: %d [%.2fms]\n", 0, (double)(end - start) / CLOCKS_PER_SEC * 1000);
+    printf("Problem 01: %lld [%.2fms]\n", password, (double)(end - start) / CLOCKS_PER_SEC * 1000);
 }
 
 /*
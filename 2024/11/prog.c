@@ -86,15 +86,18 @@ void problem1(char* inputFilePath) {
     printf("Problem 01: %zu [%.2fms]\n", rocks->numItems, (double)(end - start) / CLOCKS_PER_SEC * 1000);
 }
 
-long long stonesAfterBlinks(long long stone, int blinks, LLongMap* cache) {
+// Blinks are packed into the low bits of the cache key, below the stone's number.
+#define BLINK_BITS 7
+
+long long stonesAfterBlinks(long long stone, int blinks, Int64Map* cache) {
     /*
     Gets the number of stones the given stone will turn into after the given number of blinks.
 
     This function works by recursively getting the number of rocks this rock's alteration(s) will turn into
     after 1 less blink, and uses the cache to prevent long computations of numbers we've already seen.
 
-    The cache stores the resultant number of rocks, keyed by "<stone_number>-<blinks>". We use the composite
-    key instead of a map of maps because I only have a str -> long long map implemented.
+    The cache stores the resultant number of rocks, keyed by the stone number and blinks packed into a single
+    integer, `stone << BLINK_BITS | blinks`, which has plenty of room since blinks never go past 75.
     */
 
     // Not blinking = no new stones are added.
@@ -102,14 +105,12 @@ long long stonesAfterBlinks(long long stone, int blinks, LLongMap* cache) {
 
     int digits = countDigits(stone);
 
-    // Create the "<stone_number>-<blinks>" key for map lookup and insertion.
-    char* key = malloc(25);
-    sprintf(key, "%lld-%d", stone, blinks);
+    int64_t key = ((int64_t)stone << BLINK_BITS) | blinks;
 
     // If we have the number of stones this stone will turn into after the current number of blinks, just
     // return that.
-    long long nextStones;
-    if (getLLongMap(cache, key, &nextStones)) return nextStones;
+    int64_t nextStones;
+    if (getInt64Map(cache, key, &nextStones)) return nextStones;
 
     // Otherwise, get the total number of stones this stone will turn into after applying the rock-changing rule,
     // while also "consuming" the current blink.
@@ -122,7 +123,7 @@ long long stonesAfterBlinks(long long stone, int blinks, LLongMap* cache) {
     }
 
     // Store the result in the cache for future lookup.
-    setLLongMap(cache, key, nextStones);
+    setInt64Map(cache, key, nextStones);
 
     return nextStones;
 }
@@ -155,13 +156,12 @@ void problem2(char* inputFilePath) {
 
     int parserEndIdx = 0;
     while (parserEndIdx < fileLen - 1) insertLLongArray(&rocks, parseNumber(input, parserEndIdx, &parserEndIdx));
-    fclose(inputFile);
 
     int BLINK_COUNT = 75;
 
     // This cache will hold the number of rocks a given rock turns into after a certain number of blinks.
-    LLongMap cache;
-    initLLongMap(&cache);
+    Int64Map cache;
+    initInt64Map(&cache);
 
     // For each rock in the input, get the number of stones after BLINK_COUNT blinks, and sum them together.
     long long totalStones = 0;
@@ -169,6 +169,9 @@ void problem2(char* inputFilePath) {
         totalStones += stonesAfterBlinks(rocks.data[idx], BLINK_COUNT, &cache);
     }
 
+    freeInt64Map(&cache);
+    freeLLongArray(&rocks);
+
     clock_t end = clock();
     printf("Problem 02: %lld [%.2fms]\n", totalStones, (double)(end - start) / CLOCKS_PER_SEC * 1000);
 }
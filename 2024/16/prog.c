@@ -23,6 +23,18 @@
 #define MOVE_COST 1
 #define TURN_COST 1000
 
+/*
+A node to visit, along with the score to get there and the direction the reindeer's facing once it's there.
+*/
+typedef struct {
+    int row;
+    int col;
+    int score;
+    int direction;
+} Visit;
+
+DEFINE_ARRAY(Visit, VisitArray)
+
 int getDirectionScore(int direction1, int direction2) {
     /*
     Gets the score to go from one direction to another:
@@ -96,22 +108,20 @@ void problem1(char* inputFilePath) {
         }
     }
 
-    IntArray visitStack;
-    initIntArray(&visitStack, numRows * numCols * 4);
+    VisitArray visitStack;
+    initVisitArray(&visitStack, numRows * numCols);
 
-    insertIntArray(&visitStack, startRow);
-    insertIntArray(&visitStack, startCol);
-    insertIntArray(&visitStack, 0);
     // The reindeer starts facing EAST.
-    insertIntArray(&visitStack, EAST);
+    pushVisitArray(&visitStack, (Visit){startRow, startCol, 0, EAST});
 
     int minScore = INT_MAX;
     int score, direction;
     while (visitStack.numItems > 0) {
-        direction = popIntArray(&visitStack);
-        score = popIntArray(&visitStack);
-        col = popIntArray(&visitStack);
-        row = popIntArray(&visitStack);
+        Visit visit = popVisitArray(&visitStack);
+        row = visit.row;
+        col = visit.col;
+        score = visit.score;
+        direction = visit.direction;
 
         // If we've reached the end
         if (map[row][col] == END) {
@@ -126,37 +136,27 @@ void problem1(char* inputFilePath) {
 
         // N
         if (map[row - 1][col] == EMPTY_SPACE || map[row - 1][col] == END) {
-            insertIntArray(&visitStack, row - 1);
-            insertIntArray(&visitStack, col);
-            insertIntArray(&visitStack, score + getDirectionScore(direction, NORTH));
-            insertIntArray(&visitStack, NORTH);
+            pushVisitArray(&visitStack, (Visit){row - 1, col, score + getDirectionScore(direction, NORTH), NORTH});
         }
 
         // E
         if (map[row][col + 1] == EMPTY_SPACE || map[row][col + 1] == END) {
-            insertIntArray(&visitStack, row);
-            insertIntArray(&visitStack, col + 1);
-            insertIntArray(&visitStack, score + getDirectionScore(direction, EAST));
-            insertIntArray(&visitStack, EAST);
+            pushVisitArray(&visitStack, (Visit){row, col + 1, score + getDirectionScore(direction, EAST), EAST});
         }
 
         // S
         if (map[row + 1][col] == EMPTY_SPACE || map[row + 1][col] == END) {
-            insertIntArray(&visitStack, row + 1);
-            insertIntArray(&visitStack, col);
-            insertIntArray(&visitStack, score + getDirectionScore(direction, SOUTH));
-            insertIntArray(&visitStack, SOUTH);
+            pushVisitArray(&visitStack, (Visit){row + 1, col, score + getDirectionScore(direction, SOUTH), SOUTH});
         }
 
         // W
         if (map[row][col - 1] == EMPTY_SPACE || map[row][col - 1] == END) {
-            insertIntArray(&visitStack, row);
-            insertIntArray(&visitStack, col - 1);
-            insertIntArray(&visitStack, score + getDirectionScore(direction, WEST));
-            insertIntArray(&visitStack, WEST);
+            pushVisitArray(&visitStack, (Visit){row, col - 1, score + getDirectionScore(direction, WEST), WEST});
         }
     }
 
+    freeVisitArray(&visitStack);
+
     clock_t end = clock();
     printf("Problem 01: %d [%.2fms]\n", minScore, (double)(end - start) / CLOCKS_PER_SEC * 1000);
 }
@@ -249,23 +249,21 @@ void problem2(char* inputFilePath) {
         }
     }
 
-    IntArray visitStack;
-    initIntArray(&visitStack, numRows * numCols * 4);
+    VisitArray visitStack;
+    initVisitArray(&visitStack, numRows * numCols);
 
-    insertIntArray(&visitStack, startRow);
-    insertIntArray(&visitStack, startCol);
-    insertIntArray(&visitStack, 0);
     // The reindeer starts facing EAST.
-    insertIntArray(&visitStack, EAST);
+    pushVisitArray(&visitStack, (Visit){startRow, startCol, 0, EAST});
 
     // Get the cheapest score, as in part 1.
     int minScore = INT_MAX;
     int score, direction;
     while (visitStack.numItems > 0) {
-        direction = popIntArray(&visitStack);
-        score = popIntArray(&visitStack);
-        col = popIntArray(&visitStack);
-        row = popIntArray(&visitStack);
+        Visit visit = popVisitArray(&visitStack);
+        row = visit.row;
+        col = visit.col;
+        score = visit.score;
+        direction = visit.direction;
 
         // If we've reached the end
         if (map[row][col] == END) {
@@ -280,37 +278,27 @@ void problem2(char* inputFilePath) {
 
         // N
         if (map[row - 1][col] == EMPTY_SPACE || map[row - 1][col] == END) {
-            insertIntArray(&visitStack, row - 1);
-            insertIntArray(&visitStack, col);
-            insertIntArray(&visitStack, score + getDirectionScore(direction, NORTH));
-            insertIntArray(&visitStack, NORTH);
+            pushVisitArray(&visitStack, (Visit){row - 1, col, score + getDirectionScore(direction, NORTH), NORTH});
         }
 
         // E
         if (map[row][col + 1] == EMPTY_SPACE || map[row][col + 1] == END) {
-            insertIntArray(&visitStack, row);
-            insertIntArray(&visitStack, col + 1);
-            insertIntArray(&visitStack, score + getDirectionScore(direction, EAST));
-            insertIntArray(&visitStack, EAST);
+            pushVisitArray(&visitStack, (Visit){row, col + 1, score + getDirectionScore(direction, EAST), EAST});
         }
 
         // S
         if (map[row + 1][col] == EMPTY_SPACE || map[row + 1][col] == END) {
-            insertIntArray(&visitStack, row + 1);
-            insertIntArray(&visitStack, col);
-            insertIntArray(&visitStack, score + getDirectionScore(direction, SOUTH));
-            insertIntArray(&visitStack, SOUTH);
+            pushVisitArray(&visitStack, (Visit){row + 1, col, score + getDirectionScore(direction, SOUTH), SOUTH});
         }
 
         // W
         if (map[row][col - 1] == EMPTY_SPACE || map[row][col - 1] == END) {
-            insertIntArray(&visitStack, row);
-            insertIntArray(&visitStack, col - 1);
-            insertIntArray(&visitStack, score + getDirectionScore(direction, WEST));
-            insertIntArray(&visitStack, WEST);
+            pushVisitArray(&visitStack, (Visit){row, col - 1, score + getDirectionScore(direction, WEST), WEST});
         }
     }
 
+    freeVisitArray(&visitStack);
+
     // The score at the end node is the min score.
     nodeScores[endRow][endCol] = minScore;
 
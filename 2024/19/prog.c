@@ -7,6 +7,9 @@
 #include "../../utils/map.c"
 #include "../../utils/string.c"
 
+// Print how full the design cache got, and how long it's probes are.
+#define PRINT_MAP_STATS false
+
 long long designsPossible(char* design, int designLength, StringArray* availableStripes, LLongMap* cache) {
     /*
     Gets the total number of designs possible for the given design, using different combinations of
@@ -16,14 +19,16 @@ long long designsPossible(char* design, int designLength, StringArray* available
         1. The design starts with an available stripe pattern
         2. The rest of the pattern (minus the available stripe prefix) is possible.
 
-    Encountered patterns are stored in the cache to speed things up.
+    Encountered patterns are stored in the cache to speed things up. The rest of a design is always a suffix of
+    it, so it's looked up by it's length right where it is in the design, without copying it out (the cache
+    only copies the keys it keeps).
     */
     // The base case, a design of length 0 is possible, you don't need any stripes to make it!
     if (designLength == 0) return 1;
 
     // Check if we've already encountered this design.
     long long cachePossible;
-    if (getLLongMap(cache, design, &cachePossible)) {
+    if (getLLongMapWithLength(cache, design, designLength, &cachePossible)) {
         return cachePossible;
     }
 
@@ -33,16 +38,11 @@ long long designsPossible(char* design, int designLength, StringArray* available
     for (int idx = 0; idx < availableStripes->numItems; idx += 1) {
         if (startsWith(design, availableStripes->data[idx])) {
             stripeLength = strlen(availableStripes->data[idx]);
-            // Copy the design into a substring to not override keys in the map.
-            char* subString = malloc(designLength - stripeLength + 1);
-            memcpy(subString, design + stripeLength, designLength - stripeLength);
-            subString[designLength - stripeLength] = '\0';
-
-            possible += designsPossible(subString, designLength - stripeLength, availableStripes, cache);
+            possible += designsPossible(design + stripeLength, designLength - stripeLength, availableStripes, cache);
         }
     }
 
-    setLLongMap(cache, design, possible);
+    setLLongMapWithLength(cache, design, designLength, possible);
 
     return possible;
 }
@@ -84,19 +84,19 @@ void problem1(char* inputFilePath) {
     // Process the needed designs
     int possibleDesigns = 0;
     while ((lineLen = getline(&line, &lineCap, inputFile)) > 0) {
-        // If there's a new line ending the line, replace it with a NULL terminator, otherwise
-        // we need to make more space in the new buffer to add the NULL terminator.
-        if (line[lineLen - 1] != '\n') lineLen += 1;
-    
-        // Copy the design into a substring to not override keys in the map.
-        char* newLine = malloc(lineLen);
-        memcpy(newLine, line, lineLen);
-        newLine[lineLen - 1] = '\0';
-
-        if (designsPossible(newLine, lineLen - 1, &availableStripes, &designCache) > 0) possibleDesigns += 1;
+        // Replace the new line ending the line (if there is one) with a NULL terminator. The cache copies
+        // it's keys, so the line can be reused for the next design.
+        if (line[lineLen - 1] == '\n') {
+            lineLen -= 1;
+            line[lineLen] = '\0';
+        }
+
+        if (designsPossible(line, lineLen, &availableStripes, &designCache) > 0) possibleDesigns += 1;
     }
 
     fclose(inputFile);
+    free(line);
+    freeLLongMap(&designCache);
 
     clock_t end = clock();
     printf("Problem 01: %d [%.2fms]\n", possibleDesigns, (double)(end - start) / CLOCKS_PER_SEC * 1000);
@@ -134,19 +134,25 @@ void problem2(char* inputFilePath) {
     // Process the needed designs
     long long possibleDesigns = 0;
     while ((lineLen = getline(&line, &lineCap, inputFile)) > 0) {
-        // If there's a new line ending the line, replace it with a NULL terminator, otherwise
-        // we need to make more space in the new buffer to add the NULL terminator.
-        if (line[lineLen - 1] != '\n') lineLen += 1;
-
-        // Copy the design into a substring to not override keys in the map.
-        char* newLine = malloc(lineLen);
-        memcpy(newLine, line, lineLen);
-        newLine[lineLen - 1] = '\0';
+        // Replace the new line ending the line (if there is one) with a NULL terminator.
+        if (line[lineLen - 1] == '\n') {
+            lineLen -= 1;
+            line[lineLen] = '\0';
+        }
 
-        possibleDesigns += designsPossible(newLine, lineLen - 1, &availableStripes, &designCache);
+        possibleDesigns += designsPossible(line, lineLen, &availableStripes, &designCache);
     }
 
     fclose(inputFile);
+    free(line);
+
+    if (PRINT_MAP_STATS) {
+        MapStats stats;
+        getLLongMapStats(&designCache, &stats);
+        printMapStats(&stats, true);
+    }
+
+    freeLLongMap(&designCache);
 
     clock_t end = clock();
     printf("Problem 02: %lld [%.2fms]\n", possibleDesigns, (double)(end - start) / CLOCKS_PER_SEC * 1000);
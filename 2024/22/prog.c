@@ -12,6 +12,9 @@
 #define SECRET_LEVELS 2000
 #define SECRET_MODULO 16777216
 
+// Print how full the sequence maps got, and how long their probes are.
+#define PRINT_MAP_STATS false
+
 void problem1(char* inputFilePath) {
     /*
     The problem is asking us to perform a series of operations on a set of input numbers for 2000
@@ -48,6 +51,14 @@ void problem1(char* inputFilePath) {
     printf("Problem 01: %lld [%.2fms]\n", secretSum, (double)(end - start) / CLOCKS_PER_SEC * 1000);
 }
 
+int64_t sequenceKey(int diff1, int diff2, int diff3, int diff4) {
+    /*
+    Packs a sequence of 4 price deltas into a single map key. Each delta is between -9 and 9, so it's shifted to
+    be between 0 and 18, and used as a digit of a base 19 number.
+    */
+    return (((int64_t)(diff1 + 9) * 19 + (diff2 + 9)) * 19 + (diff3 + 9)) * 19 + (diff4 + 9);
+}
+
 void problem2(char* inputFilePath) {
     /*
     For each of the part 1 iterations, we store the one's digit of the input number after the set of operations, which
@@ -68,14 +79,13 @@ void problem2(char* inputFilePath) {
 
     // Only the first appearance of the delta sequence can count, so we need to store if
     // we've seen the sequence before for the input being processed.
-    long long encounteredThrowaway;
-    LLongMap encounteredSequence;
-    initLLongMap(&encounteredSequence);
+    Int64Map encounteredSequence;
+    initInt64Map(&encounteredSequence);
 
     // A map of a delta sequence and the sum so far of all the prices for that sequence, across
     // all inputs.
-    LLongMap sequenceSum;
-    initLLongMap(&sequenceSum);
+    Int64Map sequenceSum;
+    initInt64Map(&sequenceSum);
 
     // The price sequence for a single input number.
     IntArray sequence;
@@ -90,7 +100,7 @@ void problem2(char* inputFilePath) {
         // Reset
         secretLevel = 0;
         sequence.numItems = 0;
-        freeLLongMap(&encounteredSequence);
+        clearInt64Map(&encounteredSequence);
 
         number = parseNumber(input, endParserIdx, &endParserIdx);
 
@@ -107,7 +117,6 @@ void problem2(char* inputFilePath) {
         }
 
         // Sum the sequence delta prices.
-        long long cacheValue;
         int diff1, diff2, diff3, diff4, value;
         for (int idx = 4; idx < sequence.numItems - 1; idx += 1) {
             diff1 = sequence.data[idx - 3] - sequence.data[idx - 4];
@@ -116,30 +125,32 @@ void problem2(char* inputFilePath) {
             diff4 = sequence.data[idx] - sequence.data[idx - 1];
             value = sequence.data[idx];
 
-            char* key = malloc(25);
-            sprintf(key, "%d,%d,%d,%d", diff1, diff2, diff3, diff4);
+            int64_t key = sequenceKey(diff1, diff2, diff3, diff4);
 
             // If we've already encountered this sequence, skip it.
-            if (getLLongMap(&encounteredSequence, key, &encounteredThrowaway)) continue;
-            setLLongMap(&encounteredSequence, key, 1);
+            if (!setInt64Map(&encounteredSequence, key, 1)) continue;
 
             // Add the price to the sum for that sequence.
-            if (!getLLongMap(&sequenceSum, key, &cacheValue)) {
-                setLLongMap(&sequenceSum, key, value);
-            } else {
-                setLLongMap(&sequenceSum, key, cacheValue + value);
-            }
+            addInt64Map(&sequenceSum, key, value);
         }
     }
 
     // Get the max value from the sequence cache.
     long long maxValue = -1;
-    for (int idx = 0; idx < sequenceSum.capacity; idx += 1) {
-        if (sequenceSum.entries[idx].key == NULL) continue;
-
-        maxValue = sequenceSum.entries[idx].value > maxValue ? sequenceSum.entries[idx].value : maxValue;
+    int cursor = 0;
+    int64_t key, sum;
+    while (nextInt64Map(&sequenceSum, &cursor, &key, &sum)) maxValue = sum > maxValue ? sum : maxValue;
+
+    if (PRINT_MAP_STATS) {
+        MapStats stats;
+        getInt64MapStats(&sequenceSum, &stats);
+        printMapStats(&stats, true);
     }
 
+    freeInt64Map(&encounteredSequence);
+    freeInt64Map(&sequenceSum);
+    freeIntArray(&sequence);
+
     clock_t end = clock();
     printf("Problem 02: %lld [%.2fms]\n", maxValue, (double)(end - start) / CLOCKS_PER_SEC * 1000);
 }
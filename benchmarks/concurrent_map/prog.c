@@ -0,0 +1,329 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../utils/concurrent_map.c"
+#include "../../utils/math.c"
+
+#define NUM_THREAD_COUNTS 5
+int THREAD_COUNTS[NUM_THREAD_COUNTS] = {1, 2, 4, 8, 16};
+
+// The stones workload, 2024/11's part 2 with a lot more starting stones.
+#define NUM_STONES 2000
+#define MAX_STONE 1000000
+#define BLINKS 75
+#define BLINK_BITS 7
+
+// The designs workload, 2024/19's part 2 with made up stripes and designs.
+#define NUM_STRIPES 400
+#define MAX_STRIPE_LENGTH 8
+#define NUM_DESIGNS 4000
+#define DESIGN_LENGTH 50
+
+char COLORS[5] = {'w', 'u', 'b', 'r', 'g'};
+
+// Print the stats of the shared maps, once every thread has finished with them.
+#define PRINT_MAP_STATS false
+
+/*
+The work split up between the threads, each of which keeps taking the next stone (or design) until there's
+none left, adding up the results as it goes.
+*/
+typedef struct {
+    long long* stones;
+    char** designs;
+    int numItems;
+    int nextItem;
+
+    char** stripes;
+    int* stripeLengths;
+
+    ConcurrentInt64Map stoneCache;
+    ConcurrentLLongMap designCache;
+
+    long long total;
+    pthread_mutex_t totalLock;
+} Workload;
+
+unsigned int nextRandom(unsigned int* seed) {
+    *seed = *seed * 1103515245 + 12345;
+    return *seed >> 8;
+}
+
+double msSince(struct timespec* start) {
+    /*
+    `clock()` adds up the CPU time of every thread, so the workloads are timed by the wall clock instead.
+    */
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) * 1000.0 + (end.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+// ================================ Stones ================================
+
+long long stonesAfterBlinks(long long stone, int blinks, Int64Map* cache) {
+    /*
+    Same as 2024/11's, the number of stones the stone turns into after the blinks.
+    */
+    if (blinks == 0) return 1;
+
+    int64_t key = ((int64_t)stone << BLINK_BITS) | blinks;
+    int64_t nextStones;
+    if (getInt64Map(cache, key, &nextStones)) return nextStones;
+
+    int digits = countDigits(stone);
+    if (stone == 0) nextStones = stonesAfterBlinks(1, blinks - 1, cache);
+    else if (digits % 2 == 0) nextStones = stonesAfterBlinks(leftHalf(stone, digits), blinks - 1, cache) + stonesAfterBlinks(rightHalf(stone, digits), blinks - 1, cache);
+    else nextStones = stonesAfterBlinks(stone * 2024, blinks - 1, cache);
+
+    setInt64Map(cache, key, nextStones);
+    return nextStones;
+}
+
+long long concurrentStonesAfterBlinks(long long stone, int blinks, ConcurrentInt64Buffer* cache) {
+    /*
+    `stonesAfterBlinks`, sharing the cache with the other threads.
+    */
+    if (blinks == 0) return 1;
+
+    int64_t key = ((int64_t)stone << BLINK_BITS) | blinks;
+    int64_t nextStones;
+    if (getConcurrentInt64Buffer(cache, key, &nextStones)) return nextStones;
+
+    int digits = countDigits(stone);
+    if (stone == 0) nextStones = concurrentStonesAfterBlinks(1, blinks - 1, cache);
+    else if (digits % 2 == 0) nextStones = concurrentStonesAfterBlinks(leftHalf(stone, digits), blinks - 1, cache) + concurrentStonesAfterBlinks(rightHalf(stone, digits), blinks - 1, cache);
+    else nextStones = concurrentStonesAfterBlinks(stone * 2024, blinks - 1, cache);
+
+    insertConcurrentInt64Buffer(cache, key, nextStones);
+    return nextStones;
+}
+
+void* runStonesWorker(void* arg) {
+    Workload* workload = arg;
+
+    ConcurrentInt64Buffer cache;
+    initConcurrentInt64Buffer(&cache, &workload->stoneCache);
+
+    long long total = 0;
+    int itemIdx;
+    while ((itemIdx = __atomic_fetch_add(&workload->nextItem, 1, __ATOMIC_RELAXED)) < workload->numItems) {
+        total += concurrentStonesAfterBlinks(workload->stones[itemIdx], BLINKS, &cache);
+    }
+
+    freeConcurrentInt64Buffer(&cache);
+
+    pthread_mutex_lock(&workload->totalLock);
+    workload->total += total;
+    pthread_mutex_unlock(&workload->totalLock);
+
+    return NULL;
+}
+
+// ================================ Designs ================================
+
+long long designsPossible(char* design, int designLength, Workload* workload, LLongMap* cache) {
+    /*
+    Same as 2024/19's, the number of ways the design can be made out of the stripes.
+    */
+    if (designLength == 0) return 1;
+
+    long long possible;
+    if (getLLongMapWithLength(cache, design, designLength, &possible)) return possible;
+
+    possible = 0;
+    for (int idx = 0; idx < NUM_STRIPES; idx += 1) {
+        int stripeLength = workload->stripeLengths[idx];
+        if (stripeLength > designLength || strncmp(design, workload->stripes[idx], stripeLength) != 0) continue;
+
+        possible += designsPossible(design + stripeLength, designLength - stripeLength, workload, cache);
+    }
+
+    setLLongMapWithLength(cache, design, designLength, possible);
+    return possible;
+}
+
+long long concurrentDesignsPossible(char* design, int designLength, Workload* workload, ConcurrentLLongBuffer* cache) {
+    /*
+    `designsPossible`, sharing the cache with the other threads.
+    */
+    if (designLength == 0) return 1;
+
+    long long possible;
+    if (getConcurrentLLongBufferWithLength(cache, design, designLength, &possible)) return possible;
+
+    possible = 0;
+    for (int idx = 0; idx < NUM_STRIPES; idx += 1) {
+        int stripeLength = workload->stripeLengths[idx];
+        if (stripeLength > designLength || strncmp(design, workload->stripes[idx], stripeLength) != 0) continue;
+
+        possible += concurrentDesignsPossible(design + stripeLength, designLength - stripeLength, workload, cache);
+    }
+
+    insertConcurrentLLongBufferWithLength(cache, design, designLength, possible);
+    return possible;
+}
+
+void* runDesignsWorker(void* arg) {
+    Workload* workload = arg;
+
+    ConcurrentLLongBuffer cache;
+    initConcurrentLLongBuffer(&cache, &workload->designCache);
+
+    long long total = 0;
+    int itemIdx;
+    while ((itemIdx = __atomic_fetch_add(&workload->nextItem, 1, __ATOMIC_RELAXED)) < workload->numItems) {
+        total += concurrentDesignsPossible(workload->designs[itemIdx], DESIGN_LENGTH, workload, &cache);
+    }
+
+    freeConcurrentLLongBuffer(&cache);
+
+    pthread_mutex_lock(&workload->totalLock);
+    workload->total += total;
+    pthread_mutex_unlock(&workload->totalLock);
+
+    return NULL;
+}
+
+// ================================ Workloads ================================
+
+void initWorkload(Workload* workload) {
+    /*
+    Makes up the stones, stripes and designs. The stripes are at least 2 colors long, so there aren't so many
+    ways to make a design that the counts overflow.
+    */
+    unsigned int seed = 2024;
+
+    workload->stones = malloc(NUM_STONES * sizeof(long long));
+    for (int idx = 0; idx < NUM_STONES; idx += 1) workload->stones[idx] = nextRandom(&seed) % MAX_STONE;
+
+    workload->stripes = malloc(NUM_STRIPES * sizeof(char*));
+    workload->stripeLengths = malloc(NUM_STRIPES * sizeof(int));
+    for (int idx = 0; idx < NUM_STRIPES; idx += 1) {
+        int length = 2 + nextRandom(&seed) % (MAX_STRIPE_LENGTH - 1);
+        workload->stripes[idx] = malloc(length + 1);
+        for (int colorIdx = 0; colorIdx < length; colorIdx += 1) workload->stripes[idx][colorIdx] = COLORS[nextRandom(&seed) % 5];
+        workload->stripes[idx][length] = '\0';
+        workload->stripeLengths[idx] = length;
+    }
+
+    // Designs are made out of stripes, so most of them are possible.
+    workload->designs = malloc(NUM_DESIGNS * sizeof(char*));
+    for (int idx = 0; idx < NUM_DESIGNS; idx += 1) {
+        char* design = malloc(DESIGN_LENGTH + MAX_STRIPE_LENGTH + 1);
+        int length = 0;
+        while (length < DESIGN_LENGTH) {
+            int stripeIdx = nextRandom(&seed) % NUM_STRIPES;
+            memcpy(design + length, workload->stripes[stripeIdx], workload->stripeLengths[stripeIdx]);
+            length += workload->stripeLengths[stripeIdx];
+        }
+        design[DESIGN_LENGTH] = '\0';
+        workload->designs[idx] = design;
+    }
+
+    pthread_mutex_init(&workload->totalLock, NULL);
+}
+
+void freeWorkload(Workload* workload) {
+    for (int idx = 0; idx < NUM_STRIPES; idx += 1) free(workload->stripes[idx]);
+    for (int idx = 0; idx < NUM_DESIGNS; idx += 1) free(workload->designs[idx]);
+
+    free(workload->stones);
+    free(workload->stripes);
+    free(workload->stripeLengths);
+    free(workload->designs);
+
+    pthread_mutex_destroy(&workload->totalLock);
+}
+
+long long runSingleThreaded(Workload* workload, bool stones, double* ms) {
+    /*
+    Runs the workload on this thread alone with a plain map, for the results (and timings) to check the
+    threaded runs against.
+    */
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    long long total = 0;
+    if (stones) {
+        Int64Map cache;
+        initInt64Map(&cache);
+        for (int idx = 0; idx < NUM_STONES; idx += 1) total += stonesAfterBlinks(workload->stones[idx], BLINKS, &cache);
+        freeInt64Map(&cache);
+    } else {
+        LLongMap cache;
+        initLLongMap(&cache);
+        for (int idx = 0; idx < NUM_DESIGNS; idx += 1) total += designsPossible(workload->designs[idx], DESIGN_LENGTH, workload, &cache);
+        freeLLongMap(&cache);
+    }
+
+    *ms = msSince(&start);
+    return total;
+}
+
+long long runThreaded(Workload* workload, bool stones, int numThreads, double* ms) {
+    /*
+    Runs the workload split up between the threads, sharing a concurrent map.
+    */
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    workload->numItems = stones ? NUM_STONES : NUM_DESIGNS;
+    workload->nextItem = 0;
+    workload->total = 0;
+    if (stones) initConcurrentInt64Map(&workload->stoneCache);
+    else initConcurrentLLongMap(&workload->designCache);
+
+    pthread_t threads[numThreads];
+    for (int id = 0; id < numThreads; id += 1) pthread_create(&threads[id], NULL, stones ? runStonesWorker : runDesignsWorker, workload);
+    for (int id = 0; id < numThreads; id += 1) pthread_join(threads[id], NULL);
+
+    *ms = msSince(&start);
+
+    if (PRINT_MAP_STATS) {
+        MapStats stats;
+        if (stones) getConcurrentInt64MapStats(&workload->stoneCache, &stats);
+        else getConcurrentLLongMapStats(&workload->designCache, &stats);
+        printMapStats(&stats, false);
+    }
+
+    if (stones) freeConcurrentInt64Map(&workload->stoneCache);
+    else freeConcurrentLLongMap(&workload->designCache);
+
+    return workload->total;
+}
+
+/*
+Measures how the sharded concurrent maps scale, with memoized recursions split up between 1 to 16 threads by
+their top level: 2024/11's stones (integer keys) and 2024/19's designs (string keys), on made up inputs big
+enough to be worth splitting. Every run's total is checked against a single threaded run with a plain map.
+
+Usage: prog [max number of threads]
+*/
+int main(int argc, char** argv) {
+    int maxThreads = argc > 1 ? atoi(argv[1]) : THREAD_COUNTS[NUM_THREAD_COUNTS - 1];
+
+    Workload workload;
+    initWorkload(&workload);
+
+    for (int stones = 1; stones >= 0; stones -= 1) {
+        char* name = stones ? "Stones" : "Designs";
+
+        double plainMs;
+        long long expected = runSingleThreaded(&workload, stones, &plainMs);
+        printf("%-7s  plain map: %lld [%.2fms]\n", name, expected, plainMs);
+
+        for (int countIdx = 0; countIdx < NUM_THREAD_COUNTS && THREAD_COUNTS[countIdx] <= maxThreads; countIdx += 1) {
+            int numThreads = THREAD_COUNTS[countIdx];
+
+            double ms;
+            long long total = runThreaded(&workload, stones, numThreads, &ms);
+            printf("%-7s %2d threads: %lld [%.2fms, %.2fx]%s\n", name, numThreads, total, ms, plainMs / ms, total == expected ? "" : " MISMATCH");
+        }
+    }
+
+    freeWorkload(&workload);
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../../utils/intcode_arcade.c"
+
+// The number of times to play the game with each checkpoint interval, for the timings.
+#define NUM_GAMES 10
+
+// Checkpoint intervals to compare, 0 for no checkpoints.
+#define NUM_INTERVALS 3
+size_t CHECKPOINT_INTERVALS[NUM_INTERVALS] = {0, ARCADE_CHECKPOINT_INTERVAL, 16};
+
+long long playGame(IntCodeProgram* program, size_t checkpointInterval, size_t* numFrames) {
+    /*
+    Plays the game headless to the end, following the ball, storing the number of frames played. Returns the
+    final score.
+    */
+    resetIntCodeProgram(program);
+    clearInput(program);
+
+    IntCodeArcade arcade;
+    initIntCodeArcade(&arcade, program, checkpointInterval);
+
+    while (runIntCodeArcadeFrame(&arcade)) moveIntCodeJoystick(&arcade, followBall(&arcade));
+
+    long long score = arcade.screen.score;
+    *numFrames = arcade.screen.numFrames;
+
+    freeIntCodeArcade(&arcade);
+    return score;
+}
+
+long long replayFromCheckpoint(IntCodeProgram* program) {
+    /*
+    Plays the game to the end, then rewinds to the last checkpoint and plays it out again from there, which
+    should end with the same score. Returns the score after the rewind, or -1 if there was no checkpoint.
+    */
+    resetIntCodeProgram(program);
+    clearInput(program);
+
+    IntCodeArcade arcade;
+    initIntCodeArcade(&arcade, program, ARCADE_CHECKPOINT_INTERVAL);
+
+    while (runIntCodeArcadeFrame(&arcade)) moveIntCodeJoystick(&arcade, followBall(&arcade));
+
+    long long score = -1;
+    if (restoreIntCodeArcade(&arcade)) {
+        // The checkpoint was taken at the end of a frame, before the joystick moved.
+        moveIntCodeJoystick(&arcade, followBall(&arcade));
+        while (runIntCodeArcadeFrame(&arcade)) moveIntCodeJoystick(&arcade, followBall(&arcade));
+        score = arcade.screen.score;
+    }
+
+    freeIntCodeArcade(&arcade);
+    return score;
+}
+
+/*
+Measures how fast the 2019/13 arcade game runs headless, in frames per second, with checkpoints taken every
+so often (or not at all), and checks that rewinding to a checkpoint replays the game to the same score.
+
+Usage: prog <2019/13 input file>
+*/
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        printf("Usage: %s <2019/13 input file>\n", argv[0]);
+        return 1;
+    }
+
+    IntCodeProgram program;
+    initIntCodeProgramFromFile(&program, argv[1]);
+
+    // Insert unlimited quarters
+    program.program[0] = 2;
+
+    long long expectedScore = -1;
+    for (int intervalIdx = 0; intervalIdx < NUM_INTERVALS; intervalIdx += 1) {
+        size_t interval = CHECKPOINT_INTERVALS[intervalIdx];
+
+        size_t numFrames = 0;
+        long long score = 0;
+        clock_t start = clock();
+        for (int game = 0; game < NUM_GAMES; game += 1) score = playGame(&program, interval, &numFrames);
+        double ms = (double)(clock() - start) / CLOCKS_PER_SEC * 1000 / NUM_GAMES;
+
+        if (expectedScore == -1) expectedScore = score;
+        printf("Checkpoint every %4zu frames: %lld in %zu frames [%.2fms, %.0f frames/s]%s\n", interval, score, numFrames, ms,
+               numFrames / (ms / 1000), score == expectedScore ? "" : " MISMATCH");
+    }
+
+    long long replayedScore = replayFromCheckpoint(&program);
+    printf("Replayed from the last checkpoint: %lld%s\n", replayedScore, replayedScore == expectedScore ? "" : " MISMATCH");
+
+    freeIntCodeProgram(&program);
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../utils/intcode.c"
+
+#define NETWORK_SIZE 50
+
+long long runBoost(char* inputFilePath, IntCodeEngine engine) {
+    /*
+    The 2019/09 BOOST program in sensor boost mode, which is one long run of a single program.
+    */
+    IntCodeProgram program;
+    initIntCodeProgramFromFile(&program, inputFilePath);
+    program.engine = engine;
+
+    pushInput(&program, 2);
+    intcodeRun(&program);
+
+    long long coordinates = 0;
+    while (popOutput(&program, &coordinates));
+    freeIntCodeProgram(&program);
+
+    return coordinates;
+}
+
+long long runBreakout(char* inputFilePath, IntCodeEngine engine) {
+    /*
+    The 2019/13 breakout game, played to the end with the paddle following the ball. The program stops
+    and waits on input every frame.
+    */
+    IntCodeProgram program;
+    initIntCodeProgramFromFile(&program, inputFilePath);
+    program.engine = engine;
+
+    // Insert unlimited quarters.
+    program.program[0] = 2;
+
+    long long score = 0, ballX = 0, paddleX = 0;
+    long long tile[3];
+    do {
+        intcodeRun(&program);
+
+        while (countOutput(&program) >= 3) {
+            popOutputs(&program, tile, 3);
+            if (tile[0] == -1 && tile[1] == 0) score = tile[2];
+            else if (tile[2] == 3) paddleX = tile[0];
+            else if (tile[2] == 4) ballX = tile[0];
+        }
+        if (program.blockedOnOutput) continue;
+
+        pushInput(&program, ballX > paddleX ? 1 : ballX < paddleX ? -1 : 0);
+    } while (!program.halted);
+
+    freeIntCodeProgram(&program);
+
+    return score;
+}
+
+long long runNetwork(char* inputFilePath, IntCodeEngine engine) {
+    /*
+    The 2019/23 network of 50 programs, run until the NAT sends the same Y value twice in a row. Each
+    program only runs a few instructions at a time before waiting on input.
+    */
+    IntCodeProgram network[NETWORK_SIZE];
+    LLongArray packetQueue[NETWORK_SIZE];
+    for (int address = 0; address < NETWORK_SIZE; address += 1) {
+        initIntCodeProgramFromFile(&network[address], inputFilePath);
+        network[address].engine = engine;
+        pushInput(&network[address], address);
+
+        initLLongArray(&packetQueue[address], 100);
+    }
+
+    long long natX = 0, natY = 0, prevNatY = -1;
+    while (true) {
+        bool idle = true;
+
+        for (int address = 0; address < NETWORK_SIZE; address += 1) {
+            IntCodeProgram* pc = &network[address];
+
+            if (packetQueue[address].numItems > 0) {
+                for (int idx = 0; idx < packetQueue[address].numItems; idx += 1) pushInput(pc, packetQueue[address].data[idx]);
+                packetQueue[address].numItems = 0;
+                idle = false;
+            } else {
+                pushInput(pc, -1);
+            }
+
+            intcodeRun(pc);
+
+            long long packet[3];
+            while (countOutput(pc) >= 3) {
+                popOutputs(pc, packet, 3);
+                idle = false;
+                if (packet[0] == 255) {
+                    natX = packet[1];
+                    natY = packet[2];
+                } else {
+                    insertLLongArray(&packetQueue[packet[0]], packet[1]);
+                    insertLLongArray(&packetQueue[packet[0]], packet[2]);
+                }
+            }
+        }
+
+        if (idle) {
+            if (natY == prevNatY) break;
+
+            prevNatY = natY;
+            insertLLongArray(&packetQueue[0], natX);
+            insertLLongArray(&packetQueue[0], natY);
+        }
+    }
+
+    for (int address = 0; address < NETWORK_SIZE; address += 1) {
+        freeIntCodeProgram(&network[address]);
+        freeLLongArray(&packetQueue[address]);
+    }
+
+    return natY;
+}
+
+void benchmark(char* name, long long (*workload)(char*, IntCodeEngine), char* inputFilePath) {
+    /*
+    Runs the workload with both engines, reporting the time each took and making sure they agree.
+    */
+    clock_t start = clock();
+    long long loopResult = workload(inputFilePath, LOOP_ENGINE);
+    clock_t end = clock();
+    double loopMs = (double)(end - start) / CLOCKS_PER_SEC * 1000;
+
+    start = clock();
+    long long threadedResult = workload(inputFilePath, THREADED_ENGINE);
+    end = clock();
+    double threadedMs = (double)(end - start) / CLOCKS_PER_SEC * 1000;
+
+    printf("%-10s loop: %8.2fms  threaded: %8.2fms  [%.2fx]", name, loopMs, threadedMs, loopMs / threadedMs);
+    if (loopResult != threadedResult) printf("  MISMATCH: %lld != %lld", loopResult, threadedResult);
+    printf("\n");
+}
+
+/*
+Compares the run time of the Intcode engines on some of the heavier 2019 programs.
+
+Usage: prog <2019/09 input> <2019/13 input> <2019/23 input>
+*/
+int main(int argc, char** argv) {
+    benchmark("2019/09", runBoost, argv[1]);
+    benchmark("2019/13", runBreakout, argv[2]);
+    benchmark("2019/23", runNetwork, argv[3]);
+
+    return 0;
+}
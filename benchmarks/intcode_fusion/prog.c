@@ -0,0 +1,87 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../../utils/intcode.c"
+
+// The number of times to run the program for each timing.
+#define NUM_RUNS 20
+
+typedef struct {
+    long long lastOutput;
+    double ms;
+    long long numInstructions;
+    long long numDispatches;
+} FusionResult;
+
+FusionResult runFusion(char* inputFilePath, long long* inputs, int numInputs, bool fuseInstructions) {
+    /*
+    Runs the program NUM_RUNS times from the start with the given inputs, with or without fusing
+    instructions, timing the runs and (when profiling is compiled in) counting the instructions and
+    dispatches.
+    */
+    IntCodeProgram program;
+    initIntCodeProgramFromFile(&program, inputFilePath);
+    program.fuseInstructions = fuseInstructions;
+#ifdef INTCODE_PROFILE
+    profileIntCodeProgram(&program);
+#endif
+
+    FusionResult result = {.lastOutput = 0};
+
+    clock_t start = clock();
+    for (int run = 0; run < NUM_RUNS; run += 1) {
+        pushInputs(&program, inputs, numInputs);
+
+        long long output;
+        do {
+            intcodeRun(&program);
+            while (popOutput(&program, &output)) result.lastOutput = output;
+        } while (program.blockedOnOutput);
+
+        // Make sure the next run starts over, even if this one stopped waiting on input.
+        program.halted = true;
+        clearInput(&program);
+    }
+    clock_t end = clock();
+    result.ms = (double)(end - start) / CLOCKS_PER_SEC * 1000;
+
+    if (program.profile != NULL) {
+        result.numInstructions = program.profile->numInstructions;
+        result.numDispatches = program.profile->numDispatches;
+    }
+
+    freeIntCodeProgram(&program);
+    return result;
+}
+
+/*
+Compares running an Intcode program on the threaded engine with and without fusing common pairs of
+instructions (see `fuseInstruction`). The output has to match, and the fused runs should be faster.
+
+Build with -DINTCODE_PROFILE to also count how many dispatches each instruction takes, which is 1 without
+fusion, and less with it (the timings are a lot slower then, so compare them without the flag).
+
+Usage: prog <intcode file> [inputs...]
+*/
+int main(int argc, char** argv) {
+    int numInputs = argc - 2;
+    long long* inputs = malloc((numInputs > 0 ? numInputs : 1) * sizeof(long long));
+    for (int idx = 0; idx < numInputs; idx += 1) inputs[idx] = atoll(argv[idx + 2]);
+
+    FusionResult plain = runFusion(argv[1], inputs, numInputs, false);
+    FusionResult fused = runFusion(argv[1], inputs, numInputs, true);
+
+    printf("plain: %8.2fms  fused: %8.2fms  [%.2fx]", plain.ms, fused.ms, plain.ms / fused.ms);
+    if (plain.lastOutput != fused.lastOutput) printf("  MISMATCH: %lld != %lld", plain.lastOutput, fused.lastOutput);
+    printf("\n");
+
+#ifdef INTCODE_PROFILE
+    printf("plain: %lld instructions in %lld dispatches [%.3f per instruction]\n", plain.numInstructions, plain.numDispatches, (double)plain.numDispatches / plain.numInstructions);
+    printf("fused: %lld instructions in %lld dispatches [%.3f per instruction]\n", fused.numInstructions, fused.numDispatches, (double)fused.numDispatches / fused.numInstructions);
+#endif
+
+    free(inputs);
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../../utils/intcode.c"
+
+// The number of times to load the program each way for the timings.
+#define NUM_LOADS 100
+
+/*
+Converts an Intcode program into a binary image (see `writeIntCodeImage`), then checks the image loads back
+into the same program and compares how long loading it takes against parsing the original.
+
+Usage: prog <intcode file> <image file>
+*/
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        printf("Usage: %s <intcode file> <image file>\n", argv[0]);
+        return 1;
+    }
+
+    IntCodeProgram program;
+    initIntCodeProgramFromFile(&program, argv[1]);
+
+    if (!writeIntCodeImage(&program, argv[2], true)) {
+        printf("Couldn't write the image to %s\n", argv[2]);
+        return 1;
+    }
+
+    IntCodeProgram loaded;
+    if (!initIntCodeProgramFromImage(&loaded, argv[2])) {
+        printf("Couldn't load the image from %s\n", argv[2]);
+        return 1;
+    }
+
+    bool matches = loaded.programSize == program.programSize;
+    for (size_t idx = 0; matches && idx < program.programSize; idx += 1) matches = loaded.program[idx] == program.program[idx];
+    printf("Wrote %zu words to %s, %s\n", program.programSize, argv[2], matches ? "which load back the same" : "which DON'T load back the same");
+
+    freeIntCodeProgram(&loaded);
+    freeIntCodeProgram(&program);
+    if (!matches) return 1;
+
+    clock_t start = clock();
+    for (int load = 0; load < NUM_LOADS; load += 1) {
+        initIntCodeProgramFromFile(&program, argv[1]);
+        freeIntCodeProgram(&program);
+    }
+    clock_t end = clock();
+    printf("Parse: [%.2fms]\n", (double)(end - start) / CLOCKS_PER_SEC * 1000 / NUM_LOADS);
+
+    start = clock();
+    for (int load = 0; load < NUM_LOADS; load += 1) {
+        initIntCodeProgramFromImage(&loaded, argv[2]);
+        freeIntCodeProgram(&loaded);
+    }
+    end = clock();
+    printf("Image: [%.2fms]\n", (double)(end - start) / CLOCKS_PER_SEC * 1000 / NUM_LOADS);
+
+    return 0;
+}
@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Count everything the program runs, see IntCodeProfile.
+#define INTCODE_PROFILE
+
+#include "../../utils/intcode.c"
+
+#define REPORT_ROWS 15
+
+/*
+Profiles an Intcode program, running it to the end with the given inputs and reporting where it spent it's
+time, to find the instructions and blocks worth specializing.
+
+The program has to halt (or stop waiting on input) with only the given inputs, any output is printed as it
+comes.
+
+Usage: prog <intcode file> [inputs...]
+*/
+int main(int argc, char** argv) {
+    IntCodeProgram program;
+    initIntCodeProgramFromFile(&program, argv[1]);
+    profileIntCodeProgram(&program);
+
+    for (int idx = 2; idx < argc; idx += 1) pushInput(&program, atoll(argv[idx]));
+
+    clock_t start = clock();
+
+    long long output;
+    printf("Output:");
+    do {
+        intcodeRun(&program);
+        while (popOutput(&program, &output)) printf(" %lld", output);
+    } while (program.blockedOnOutput);
+    printf("\n");
+
+    clock_t end = clock();
+    printf("Ran in [%.2fms]\n", (double)(end - start) / CLOCKS_PER_SEC * 1000);
+
+    printIntCodeProfile(&program, REPORT_ROWS);
+    freeIntCodeProgram(&program);
+
+    return 0;
+}
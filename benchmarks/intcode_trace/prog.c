@@ -0,0 +1,94 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../../utils/intcode_trace.c"
+
+// The number of random steps to seek to in the replay.
+#define NUM_SEEKS 1000
+
+long long runUntraced(IntCodeProgram* program, long long* inputs, int numInputs) {
+    /*
+    Runs the program to the end with the given inputs, returning it's last output.
+    */
+    pushInputs(program, inputs, numInputs);
+
+    long long output, lastOutput = 0;
+    do {
+        intcodeRun(program);
+        while (popOutput(program, &output)) lastOutput = output;
+    } while (program->blockedOnOutput);
+
+    return lastOutput;
+}
+
+long long runTraced(IntCodeTrace* trace, IntCodeProgram* program, long long* inputs, int numInputs) {
+    /*
+    Same as `runUntraced`, but recording the run in the trace.
+    */
+    pushInputs(program, inputs, numInputs);
+
+    long long output, lastOutput = 0;
+    do {
+        traceIntCodeRun(trace, program);
+        while (popOutput(program, &output)) lastOutput = output;
+    } while (program->blockedOnOutput);
+
+    return lastOutput;
+}
+
+double timeSince(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC * 1000;
+}
+
+/*
+Measures what tracing an Intcode program costs: how much slower a traced run is than an untraced one on
+each engine, how big the trace is, and how long seeking to random steps of it takes.
+
+Usage: prog <intcode file> [inputs...]
+*/
+int main(int argc, char** argv) {
+    int numInputs = argc - 2;
+    long long* inputs = malloc((numInputs > 0 ? numInputs : 1) * sizeof(long long));
+    for (int idx = 0; idx < numInputs; idx += 1) inputs[idx] = atoll(argv[idx + 2]);
+
+    IntCodeProgram program;
+    initIntCodeProgramFromFile(&program, argv[1]);
+
+    clock_t start = clock();
+    long long threadedOutput = runUntraced(&program, inputs, numInputs);
+    printf("Threaded engine: %lld [%.2fms]\n", threadedOutput, timeSince(start));
+
+    program.engine = LOOP_ENGINE;
+    start = clock();
+    long long loopOutput = runUntraced(&program, inputs, numInputs);
+    printf("Loop engine:     %lld [%.2fms]\n", loopOutput, timeSince(start));
+
+    IntCodeTrace trace;
+    initIntCodeTrace(&trace, 0);
+
+    start = clock();
+    long long tracedOutput = runTraced(&trace, &program, inputs, numInputs);
+    printf("Traced:          %lld [%.2fms]\n", tracedOutput, timeSince(start));
+
+    if (tracedOutput != threadedOutput || loopOutput != threadedOutput) printf("MISMATCH\n");
+
+    printf("Trace: %zu steps in %zu bytes [%.2f bytes per step], %zu checkpoints\n", trace.numSteps, trace.numBytes,
+           (double)trace.numBytes / (trace.numSteps > 0 ? trace.numSteps : 1), trace.numCheckpoints);
+
+    IntCodeReplay replay;
+    initIntCodeReplay(&replay, &trace);
+
+    srand(2019);
+    start = clock();
+    for (int seek = 0; seek < NUM_SEEKS; seek += 1) seekIntCodeReplay(&replay, (size_t)rand() % (trace.numSteps + 1));
+    printf("Seek: [%.4fms] per seek\n", timeSince(start) / NUM_SEEKS);
+
+    freeIntCodeReplay(&replay);
+    freeIntCodeTrace(&trace);
+    freeIntCodeProgram(&program);
+    free(inputs);
+
+    return 0;
+}
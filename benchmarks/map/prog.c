@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../../utils/map.c"
+#include "../../utils/swiss_map.c"
+
+// Every key gets this many bytes in the key buffer, NULL terminator included.
+#define KEY_STRIDE 16
+
+#define NUM_SIZES 3
+int SIZES[NUM_SIZES] = {10000, 1000000, 10000000};
+
+// Print a histogram of each map's probe lengths, under it's stats.
+#define PRINT_HISTOGRAM false
+
+/*
+The keys to benchmark with, back to back `KEY_STRIDE` bytes apart. The keys that are in the map come first,
+followed by as many keys that aren't.
+*/
+typedef struct {
+    char* data;
+    int* lengths;
+    int numKeys;
+} Keys;
+
+typedef struct {
+    double insertMs;
+    double hitMs;
+    double missMs;
+    long long checksum;
+
+    MapStats stats;
+} Timings;
+
+void initKeys(Keys* keys, int numKeys) {
+    /*
+    Makes `numKeys` keys for the map, and as many again that won't be in it. Keys are made from scrambled
+    numbers, so neighboring keys don't look alike.
+    */
+    keys->numKeys = numKeys;
+    keys->data = malloc((size_t)numKeys * 2 * KEY_STRIDE);
+    keys->lengths = malloc((size_t)numKeys * 2 * sizeof(int));
+
+    for (int idx = 0; idx < numKeys * 2; idx += 1) {
+        unsigned int scrambled = (unsigned int)idx * 2654435761u;
+        keys->lengths[idx] = sprintf(keys->data + (size_t)idx * KEY_STRIDE, "%s%x", idx < numKeys ? "k" : "m", scrambled);
+    }
+}
+
+void freeKeys(Keys* keys) {
+    free(keys->data);
+    free(keys->lengths);
+}
+
+double msSince(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC * 1000;
+}
+
+int lookupOrder(int idx, int numKeys) {
+    /*
+    Visits every key once, in an order that jumps all over the map. 1000003 is prime (and bigger than any
+    of the sizes' factors), so stepping by it modulo the number of keys hits every key.
+    */
+    return (int)(((long long)idx * 1000003) % numKeys);
+}
+
+Timings benchmarkLLongMap(Keys* keys) {
+    Timings timings = {0};
+    int numKeys = keys->numKeys;
+
+    LLongMap map;
+    initLLongMap(&map);
+
+    clock_t start = clock();
+    for (int idx = 0; idx < numKeys; idx += 1) setLLongMapWithLength(&map, keys->data + (size_t)idx * KEY_STRIDE, keys->lengths[idx], idx);
+    timings.insertMs = msSince(start);
+
+    long long value;
+    start = clock();
+    for (int idx = 0; idx < numKeys; idx += 1) {
+        int keyIdx = lookupOrder(idx, numKeys);
+        if (getLLongMapWithLength(&map, keys->data + (size_t)keyIdx * KEY_STRIDE, keys->lengths[keyIdx], &value)) timings.checksum += value;
+    }
+    timings.hitMs = msSince(start);
+
+    start = clock();
+    for (int idx = numKeys; idx < numKeys * 2; idx += 1) {
+        if (getLLongMapWithLength(&map, keys->data + (size_t)idx * KEY_STRIDE, keys->lengths[idx], &value)) timings.checksum += value;
+    }
+    timings.missMs = msSince(start);
+
+    getLLongMapStats(&map, &timings.stats);
+    freeLLongMap(&map);
+    return timings;
+}
+
+Timings benchmarkSwissLLongMap(Keys* keys) {
+    Timings timings = {0};
+    int numKeys = keys->numKeys;
+
+    SwissLLongMap map;
+    initSwissLLongMap(&map);
+
+    clock_t start = clock();
+    for (int idx = 0; idx < numKeys; idx += 1) setSwissLLongMapWithLength(&map, keys->data + (size_t)idx * KEY_STRIDE, keys->lengths[idx], idx);
+    timings.insertMs = msSince(start);
+
+    long long value;
+    start = clock();
+    for (int idx = 0; idx < numKeys; idx += 1) {
+        int keyIdx = lookupOrder(idx, numKeys);
+        if (getSwissLLongMapWithLength(&map, keys->data + (size_t)keyIdx * KEY_STRIDE, keys->lengths[keyIdx], &value)) timings.checksum += value;
+    }
+    timings.hitMs = msSince(start);
+
+    start = clock();
+    for (int idx = numKeys; idx < numKeys * 2; idx += 1) {
+        if (getSwissLLongMapWithLength(&map, keys->data + (size_t)idx * KEY_STRIDE, keys->lengths[idx], &value)) timings.checksum += value;
+    }
+    timings.missMs = msSince(start);
+
+    getSwissLLongMapStats(&map, &timings.stats);
+    freeSwissLLongMap(&map);
+    return timings;
+}
+
+void printTimings(char* name, int numKeys, Timings* timings, long long expectedChecksum) {
+    printf("%-6s %8d keys: insert [%.2fms], hits [%.2fms, %.1fM/s], misses [%.2fms, %.1fM/s]%s\n", name, numKeys, timings->insertMs,
+           timings->hitMs, numKeys / timings->hitMs / 1000, timings->missMs, numKeys / timings->missMs / 1000,
+           timings->checksum == expectedChecksum ? "" : " MISMATCH");
+
+    printf("       ");
+    printMapStats(&timings->stats, PRINT_HISTOGRAM);
+}
+
+/*
+Compares the lookup throughput of the linear probing `LLongMap` against the Swiss table `SwissLLongMap`, at
+10k, 1M and 10M keys. Each map is filled with the keys, then every key is looked up (in a scattered order),
+and then as many keys that aren't in the map.
+
+Usage: prog [max number of keys]
+*/
+int main(int argc, char** argv) {
+    int maxKeys = argc > 1 ? atoi(argv[1]) : SIZES[NUM_SIZES - 1];
+
+    for (int sizeIdx = 0; sizeIdx < NUM_SIZES && SIZES[sizeIdx] <= maxKeys; sizeIdx += 1) {
+        int numKeys = SIZES[sizeIdx];
+
+        Keys keys;
+        initKeys(&keys, numKeys);
+
+        // Every key's value is it's index, and every key is hit once.
+        long long expectedChecksum = (long long)numKeys * (numKeys - 1) / 2;
+
+        Timings linear = benchmarkLLongMap(&keys);
+        printTimings("Linear", numKeys, &linear, expectedChecksum);
+
+        Timings swiss = benchmarkSwissLLongMap(&keys);
+        printTimings("Swiss", numKeys, &swiss, expectedChecksum);
+
+        freeKeys(&keys);
+    }
+
+    return 0;
+}
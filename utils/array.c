@@ -2,6 +2,7 @@
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 /*
     INT ARRAYS
@@ -101,6 +102,13 @@ void insertLLongArray(LLongArray* array, long long item) {
     array->numItems += 1;
 }
 
+void copyLLongArray(LLongArray* array, LLongArray* copy) {
+    // Initializes `copy` with the same size and items as `array`.
+    initLLongArray(copy, array->size);
+    memcpy(copy->data, array->data, array->numItems * sizeof(long long));
+    copy->numItems = array->numItems;
+}
+
 bool containsLLongArray(LLongArray* array, long long item) {
     for (int idx = 0; idx < array->numItems; idx += 1) {
         if (array->data[idx] == item) {
@@ -2,6 +2,7 @@
 #define array_h
 
 #include <stdlib.h>
+#include <string.h>
 
 /*
     INT ARRAY
@@ -33,4 +34,90 @@ typedef struct {
     size_t stringMaxSize;
 } StringArray;
 
+/*
+    TYPED ARRAYS
+
+    `DEFINE_ARRAY(T, Name)` defines `Name`, a growable array of `T` (any type, structs included), laid out
+    like the arrays above, along with it's functions:
+
+    - initName(array, initialSize) / freeName(array)
+    - reserveName(array, numItems): Makes room for at least `numItems` items, without adding any.
+    - pushName(array, item): Adds a copy of the item to the end.
+    - pushNName(array, items, numItems): Adds copies of the first `numItems` of `items` to the end.
+    - appendName(array, other): Adds copies of all of `other`'s items to the end.
+    - emplaceName(array): Adds an uninitialized item to the end, returning a pointer to it to be filled in.
+    - popName(array): Removes the last item, returning it. The array must be non-empty.
+
+    Pushing only calls out to grow the array when it's full, otherwise, it's a single store. So a grid search
+    can keep it's (row, col, score, direction) visits in an array of structs, pushing each one in one go:
+
+    typedef struct {
+        int row, col, score, direction;
+    } Visit;
+
+    DEFINE_ARRAY(Visit, VisitArray)
+
+    VisitArray visits;
+    initVisitArray(&visits, 64);
+    pushVisitArray(&visits, (Visit){row, col, 0, EAST});
+    Visit visit = popVisitArray(&visits);
+    freeVisitArray(&visits);
+*/
+#define DEFINE_ARRAY(T, Name)                                                                                \
+    typedef struct {                                                                                         \
+        T* data;                                                                                             \
+        size_t numItems;                                                                                     \
+        size_t size;                                                                                         \
+    } Name;                                                                                                  \
+                                                                                                             \
+    void init##Name(Name* array, size_t initialSize) {                                                       \
+        array->data = malloc((initialSize > 0 ? initialSize : 1) * sizeof(T));                               \
+        array->numItems = 0;                                                                                 \
+        array->size = initialSize > 0 ? initialSize : 1;                                                     \
+    }                                                                                                        \
+                                                                                                             \
+    void free##Name(Name* array) {                                                                           \
+        free(array->data);                                                                                   \
+        array->data = NULL;                                                                                  \
+        array->numItems = 0;                                                                                 \
+        array->size = 0;                                                                                     \
+    }                                                                                                        \
+                                                                                                             \
+    __attribute__((noinline)) void grow##Name(Name* array, size_t numItems) {                                \
+        /* Doubles the size until it fits `numItems` items. Kept out of line, so pushes inline. */           \
+        size_t size = array->size > 0 ? array->size : 1;                                                     \
+        while (size < numItems) size *= 2;                                                                   \
+                                                                                                             \
+        array->data = realloc(array->data, size * sizeof(T));                                                \
+        array->size = size;                                                                                  \
+    }                                                                                                        \
+                                                                                                             \
+    void reserve##Name(Name* array, size_t numItems) {                                                       \
+        if (numItems > array->size) grow##Name(array, numItems);                                             \
+    }                                                                                                        \
+                                                                                                             \
+    void push##Name(Name* array, T item) {                                                                   \
+        if (array->numItems == array->size) grow##Name(array, array->numItems + 1);                          \
+        array->data[array->numItems++] = item;                                                               \
+    }                                                                                                        \
+                                                                                                             \
+    void pushN##Name(Name* array, const T* items, size_t numItems) {                                         \
+        reserve##Name(array, array->numItems + numItems);                                                    \
+        memcpy(array->data + array->numItems, items, numItems * sizeof(T));                                  \
+        array->numItems += numItems;                                                                         \
+    }                                                                                                        \
+                                                                                                             \
+    void append##Name(Name* array, const Name* other) {                                                      \
+        pushN##Name(array, other->data, other->numItems);                                                    \
+    }                                                                                                        \
+                                                                                                             \
+    T* emplace##Name(Name* array) {                                                                          \
+        if (array->numItems == array->size) grow##Name(array, array->numItems + 1);                          \
+        return &array->data[array->numItems++];                                                              \
+    }                                                                                                        \
+                                                                                                             \
+    T pop##Name(Name* array) {                                                                               \
+        return array->data[--array->numItems];                                                               \
+    }
+
 #endif
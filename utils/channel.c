@@ -0,0 +1,180 @@
+#ifndef channel_c
+#define channel_c
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+An LLongChannel is a fixed-capacity, first-in-first-out queue of long longs, backed by a ring buffer.
+
+Unlike an LLongArray, nothing is ever reallocated, pushing to a full channel fails instead. That's what
+lets a channel sit between two things running at different speeds (like two Intcode programs) without
+growing forever - when it's full, the producer has to wait for the consumer to catch up.
+
+The capacity is always a power of two, so wrapping around the ring buffer is just a mask. `head` and
+`tail` only ever count up, the number of items in the channel is `tail - head`.
+*/
+typedef struct {
+    long long* data;
+    size_t capacity;
+    size_t head;
+    size_t tail;
+} LLongChannel;
+
+void initLLongChannel(LLongChannel* channel, size_t capacity) {
+    /*
+    Initializes an empty channel, rounding the capacity up to the next power of two.
+    */
+    channel->capacity = 1;
+    while (channel->capacity < capacity) channel->capacity *= 2;
+
+    channel->data = malloc(channel->capacity * sizeof(long long));
+    channel->head = 0;
+    channel->tail = 0;
+}
+
+void freeLLongChannel(LLongChannel* channel) {
+    free(channel->data);
+    channel->data = NULL;
+    channel->capacity = 0;
+    channel->head = 0;
+    channel->tail = 0;
+}
+
+size_t countLLongChannel(LLongChannel* channel) {
+    // The number of items in the channel.
+    return channel->tail - channel->head;
+}
+
+size_t spaceLLongChannel(LLongChannel* channel) {
+    // The number of items that can be pushed before the channel is full.
+    return channel->capacity - (channel->tail - channel->head);
+}
+
+bool pushLLongChannel(LLongChannel* channel, long long item) {
+    /*
+    Pushes the item to the back of the channel.
+
+    Returns false (and doesn't push anything) if the channel is full, otherwise, returns true.
+    */
+    if (channel->tail - channel->head == channel->capacity) return false;
+
+    channel->data[channel->tail & (channel->capacity - 1)] = item;
+    channel->tail += 1;
+    return true;
+}
+
+bool popLLongChannel(LLongChannel* channel, long long* item) {
+    /*
+    Pops the item at the front of the channel, storing it in `item`.
+
+    Returns false if the channel is empty, otherwise, returns true.
+    */
+    if (channel->tail == channel->head) return false;
+
+    *item = channel->data[channel->head & (channel->capacity - 1)];
+    channel->head += 1;
+    return true;
+}
+
+size_t pushManyLLongChannel(LLongChannel* channel, long long* items, size_t numItems) {
+    /*
+    Pushes as many of the items as will fit to the back of the channel, in order.
+
+    Returns the number of items pushed.
+    */
+    size_t space = spaceLLongChannel(channel);
+    if (numItems > space) numItems = space;
+
+    // The items might wrap around the end of the ring buffer, which means copying in two parts.
+    size_t start = channel->tail & (channel->capacity - 1);
+    size_t firstPart = channel->capacity - start < numItems ? channel->capacity - start : numItems;
+    memcpy(channel->data + start, items, firstPart * sizeof(long long));
+    memcpy(channel->data, items + firstPart, (numItems - firstPart) * sizeof(long long));
+
+    channel->tail += numItems;
+    return numItems;
+}
+
+size_t popManyLLongChannel(LLongChannel* channel, long long* dest, size_t maxItems) {
+    /*
+    Pops up to `maxItems` items from the front of the channel into `dest`, in order.
+
+    Returns the number of items popped.
+    */
+    size_t numItems = countLLongChannel(channel);
+    if (numItems > maxItems) numItems = maxItems;
+
+    size_t start = channel->head & (channel->capacity - 1);
+    size_t firstPart = channel->capacity - start < numItems ? channel->capacity - start : numItems;
+    memcpy(dest, channel->data + start, firstPart * sizeof(long long));
+    memcpy(dest + firstPart, channel->data, (numItems - firstPart) * sizeof(long long));
+
+    channel->head += numItems;
+    return numItems;
+}
+
+long long getLLongChannel(LLongChannel* channel, size_t idx) {
+    /*
+    Gets the item `idx` items from the front of the channel, without popping it. The index must be less
+    than the number of items in the channel.
+    */
+    return channel->data[(channel->head + idx) & (channel->capacity - 1)];
+}
+
+long long* peekLLongChannel(LLongChannel* channel, size_t* numItems) {
+    /*
+    Peeks at the items at the front of the channel without copying or popping them, returning a pointer
+    to the first item and storing the number of items after it that can be read in `numItems`.
+
+    The items might wrap around the end of the ring buffer, in which case only the items up to the end are
+    returned. Drop them with `dropLLongChannel` and peek again to get the rest.
+    */
+    size_t start = channel->head & (channel->capacity - 1);
+    size_t count = countLLongChannel(channel);
+    *numItems = channel->capacity - start < count ? channel->capacity - start : count;
+
+    return channel->data + start;
+}
+
+void dropLLongChannel(LLongChannel* channel, size_t numItems) {
+    /*
+    Drops (up to) `numItems` items from the front of the channel, i.e., once they've been peeked at.
+    */
+    size_t count = countLLongChannel(channel);
+    channel->head += numItems < count ? numItems : count;
+}
+
+void copyLLongChannel(LLongChannel* channel, LLongChannel* copy) {
+    /*
+    Initializes `copy` as a copy of the channel, with the same capacity and items.
+    */
+    initLLongChannel(copy, channel->capacity);
+
+    size_t numItems = countLLongChannel(channel);
+    for (size_t idx = 0; idx < numItems; idx += 1) copy->data[idx] = getLLongChannel(channel, idx);
+    copy->tail = numItems;
+}
+
+void clearLLongChannel(LLongChannel* channel) {
+    channel->head = 0;
+    channel->tail = 0;
+}
+
+void printLLongChannel(LLongChannel* channel) {
+    size_t numItems = countLLongChannel(channel);
+
+    printf("[Capacity: %zu, Items: %zu] [", channel->capacity, numItems);
+    for (size_t idx = 0; idx < numItems; idx += 1) {
+        if (idx == numItems - 1) {
+            printf("%lld", getLLongChannel(channel, idx));
+        } else {
+            printf("%lld, ", getLLongChannel(channel, idx));
+        }
+    }
+    printf("]\n");
+}
+
+#endif
@@ -0,0 +1,447 @@
+/*
+Maps that can be shared between threads, for memoizing recursions whose top level is split across threads
+(like 2024/11's stones, or 2024/19's designs), while every thread reuses what the others have worked out.
+
+A concurrent map is split into shards, each of which is a regular map with it's own lock, and a key always
+goes in the shard picked by the top bits of it's hash. Threads only wait on each other when they want the
+same shard at the same time.
+
+Memo entries never change once they're worked out, so the maps only ever insert keys that aren't already
+there (the first thread to insert a key wins), and never update or delete them.
+
+Each thread inserts through it's own buffer, which holds on to the thread's new entries (where the thread
+can still find them) until there's enough of them to be worth flushing to the shared map, a shard (and a
+lock) at a time. Lookups check the buffer first, then the shared map.
+
+To share 2024/11's stone cache between threads:
+
+ConcurrentInt64Map cache;
+initConcurrentInt64Map(&cache);
+
+// In each thread:
+ConcurrentInt64Buffer buffer;
+initConcurrentInt64Buffer(&buffer, &cache);
+
+int64_t stones;
+if (!getConcurrentInt64Buffer(&buffer, key, &stones)) {
+    stones = ...;
+    insertConcurrentInt64Buffer(&buffer, key, stones);
+}
+
+freeConcurrentInt64Buffer(&buffer);  // Flushes what's left in the buffer.
+
+// Once the threads are done:
+freeConcurrentInt64Map(&cache);
+
+NOTE: This uses pthreads, so needs to be compiled with `-pthread`.
+*/
+
+#ifndef concurrent_map_c
+#define concurrent_map_c
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "map.c"
+
+// ================================ Constants ================================
+
+// The number of shards a concurrent map is split into, as a power of two.
+#define CONCURRENT_MAP_SHARD_BITS 6
+#define CONCURRENT_MAP_SHARDS (1 << CONCURRENT_MAP_SHARD_BITS)
+
+// The number of new entries a buffer holds on to before flushing them to the shared map.
+#define CONCURRENT_MAP_BUFFER_SIZE 256
+
+// Shards are kept on separate cache lines, so threads locking neighbouring shards don't slow each other down.
+#define CONCURRENT_MAP_CACHE_LINE 64
+
+// ================================ Structs ================================
+
+/*
+A shard of a concurrent map, only ever touched with it's lock held.
+*/
+typedef struct {
+    pthread_mutex_t lock;
+    LLongMap map;
+} __attribute__((aligned(CONCURRENT_MAP_CACHE_LINE))) ConcurrentLLongShard;
+
+typedef struct {
+    ConcurrentLLongShard shards[CONCURRENT_MAP_SHARDS];
+} ConcurrentLLongMap;
+
+/*
+A thread's entries that haven't been flushed to the shared map yet. Only the thread that owns the buffer
+ever touches it.
+*/
+typedef struct {
+    ConcurrentLLongMap* shared;
+    LLongMap pending;
+} ConcurrentLLongBuffer;
+
+typedef struct {
+    pthread_mutex_t lock;
+    Int64Map map;
+} __attribute__((aligned(CONCURRENT_MAP_CACHE_LINE))) ConcurrentInt64Shard;
+
+typedef struct {
+    ConcurrentInt64Shard shards[CONCURRENT_MAP_SHARDS];
+} ConcurrentInt64Map;
+
+typedef struct {
+    ConcurrentInt64Map* shared;
+    Int64Map pending;
+} ConcurrentInt64Buffer;
+
+// ================================ ConcurrentLLongMap ================================
+
+int concurrentLLongShard(const char* key, int keyLength) {
+    /*
+    Returns the shard the key belongs in. The shard maps use the low bits of the same hash to place keys, so
+    the shard comes from the top bits.
+    */
+    return hashString(key, keyLength) >> (32 - CONCURRENT_MAP_SHARD_BITS);
+}
+
+void initConcurrentLLongMap(ConcurrentLLongMap* map) {
+    for (int shardIdx = 0; shardIdx < CONCURRENT_MAP_SHARDS; shardIdx += 1) {
+        pthread_mutex_init(&map->shards[shardIdx].lock, NULL);
+        initLLongMap(&map->shards[shardIdx].map);
+    }
+}
+
+void freeConcurrentLLongMap(ConcurrentLLongMap* map) {
+    /*
+    Frees all memory associated with the map. No thread can be using the map (or have a buffer for it) anymore.
+    */
+    for (int shardIdx = 0; shardIdx < CONCURRENT_MAP_SHARDS; shardIdx += 1) {
+        pthread_mutex_destroy(&map->shards[shardIdx].lock);
+        freeLLongMap(&map->shards[shardIdx].map);
+    }
+}
+
+bool getConcurrentLLongMapWithLength(ConcurrentLLongMap* map, const char* key, int keyLength, long long* value) {
+    /*
+    Gets the value of the first `keyLength` characters of `key`, returning false if the key isn't in the map.
+    */
+    ConcurrentLLongShard* shard = &map->shards[concurrentLLongShard(key, keyLength)];
+
+    pthread_mutex_lock(&shard->lock);
+    bool found = getLLongMapWithLength(&shard->map, key, keyLength, value);
+    pthread_mutex_unlock(&shard->lock);
+
+    return found;
+}
+
+bool getConcurrentLLongMap(ConcurrentLLongMap* map, const char* key, long long* value) {
+    return getConcurrentLLongMapWithLength(map, key, strlen(key), value);
+}
+
+bool insertConcurrentLLongMapWithLength(ConcurrentLLongMap* map, const char* key, int keyLength, long long value) {
+    /*
+    Inserts the key with the value, unless the key's already in the map, in which case it's left as it is.
+    Returns true if the key was inserted.
+    */
+    ConcurrentLLongShard* shard = &map->shards[concurrentLLongShard(key, keyLength)];
+
+    pthread_mutex_lock(&shard->lock);
+    long long existing;
+    bool isNew = !getLLongMapWithLength(&shard->map, key, keyLength, &existing);
+    if (isNew) setLLongMapWithLength(&shard->map, key, keyLength, value);
+    pthread_mutex_unlock(&shard->lock);
+
+    return isNew;
+}
+
+bool insertConcurrentLLongMap(ConcurrentLLongMap* map, const char* key, long long value) {
+    return insertConcurrentLLongMapWithLength(map, key, strlen(key), value);
+}
+
+void getConcurrentLLongMapStats(ConcurrentLLongMap* map, MapStats* stats) {
+    /*
+    Gets the stats of all the shards added together, with the probe lengths of every key in every shard. Only
+    safe to call while no thread is using the map.
+    */
+    initMapStats(stats, 0, 0, 0, sizeof(ConcurrentLLongMap));
+
+    double totalProbeLength = 0;
+    for (int shardIdx = 0; shardIdx < CONCURRENT_MAP_SHARDS; shardIdx += 1) {
+        MapStats shardStats;
+        getLLongMapStats(&map->shards[shardIdx].map, &shardStats);
+
+        stats->numKeys += shardStats.numKeys;
+        stats->numTombstones += shardStats.numTombstones;
+        stats->capacity += shardStats.capacity;
+        stats->bytesUsed += shardStats.bytesUsed;
+
+        totalProbeLength += shardStats.meanProbeLength * shardStats.numKeys;
+        if (shardStats.maxProbeLength > stats->maxProbeLength) stats->maxProbeLength = shardStats.maxProbeLength;
+        for (int bucket = 0; bucket < MAP_STATS_HISTOGRAM_SIZE; bucket += 1) stats->probeHistogram[bucket] += shardStats.probeHistogram[bucket];
+    }
+
+    stats->loadFactor = stats->capacity > 0 ? (double)(stats->numKeys + stats->numTombstones) / stats->capacity : 0;
+    stats->meanProbeLength = stats->numKeys > 0 ? totalProbeLength / stats->numKeys : 0;
+}
+
+// ================================ ConcurrentLLongBuffer ================================
+
+void initConcurrentLLongBuffer(ConcurrentLLongBuffer* buffer, ConcurrentLLongMap* shared) {
+    buffer->shared = shared;
+    initLLongMap(&buffer->pending);
+}
+
+void flushConcurrentLLongBuffer(ConcurrentLLongBuffer* buffer) {
+    /*
+    Inserts the buffer's entries into the shared map, and empties the buffer.
+
+    The entries are sorted by shard first, so each shard only gets locked once.
+    */
+    int numPending = countLLongMap(&buffer->pending);
+    if (numPending == 0) return;
+
+    int shardCounts[CONCURRENT_MAP_SHARDS + 1] = {0};
+
+    int cursor = 0;
+    char* key;
+    int keyLength;
+    long long value;
+    while (nextLLongMapWithLength(&buffer->pending, &cursor, &key, &keyLength, &value)) shardCounts[concurrentLLongShard(key, keyLength) + 1] += 1;
+
+    // Counting sort, `shardCounts[shard]` ends up as the index the shard's entries start at.
+    for (int shardIdx = 0; shardIdx < CONCURRENT_MAP_SHARDS; shardIdx += 1) shardCounts[shardIdx + 1] += shardCounts[shardIdx];
+
+    char** keys = malloc(numPending * sizeof(char*));
+    int* keyLengths = malloc(numPending * sizeof(int));
+    long long* values = malloc(numPending * sizeof(long long));
+
+    int nextIdx[CONCURRENT_MAP_SHARDS];
+    memcpy(nextIdx, shardCounts, sizeof(nextIdx));
+
+    cursor = 0;
+    while (nextLLongMapWithLength(&buffer->pending, &cursor, &key, &keyLength, &value)) {
+        int entryIdx = nextIdx[concurrentLLongShard(key, keyLength)]++;
+        keys[entryIdx] = key;
+        keyLengths[entryIdx] = keyLength;
+        values[entryIdx] = value;
+    }
+
+    for (int shardIdx = 0; shardIdx < CONCURRENT_MAP_SHARDS; shardIdx += 1) {
+        if (shardCounts[shardIdx] == shardCounts[shardIdx + 1]) continue;
+
+        ConcurrentLLongShard* shard = &buffer->shared->shards[shardIdx];
+        pthread_mutex_lock(&shard->lock);
+        for (int entryIdx = shardCounts[shardIdx]; entryIdx < shardCounts[shardIdx + 1]; entryIdx += 1) {
+            long long existing;
+            if (getLLongMapWithLength(&shard->map, keys[entryIdx], keyLengths[entryIdx], &existing)) continue;
+            setLLongMapWithLength(&shard->map, keys[entryIdx], keyLengths[entryIdx], values[entryIdx]);
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+
+    free(keys);
+    free(keyLengths);
+    free(values);
+
+    // The keys were pointing into the pending map, so it can only be cleared once they're all inserted.
+    clearLLongMap(&buffer->pending);
+}
+
+void freeConcurrentLLongBuffer(ConcurrentLLongBuffer* buffer) {
+    /*
+    Flushes the entries still in the buffer to the shared map, then frees the buffer.
+    */
+    flushConcurrentLLongBuffer(buffer);
+    freeLLongMap(&buffer->pending);
+}
+
+bool getConcurrentLLongBufferWithLength(ConcurrentLLongBuffer* buffer, const char* key, int keyLength, long long* value) {
+    /*
+    Gets the value of the first `keyLength` characters of `key`, from the buffer if this thread inserted it
+    since the last flush, otherwise from the shared map. Returns false if the key isn't in either.
+    */
+    if (getLLongMapWithLength(&buffer->pending, key, keyLength, value)) return true;
+    return getConcurrentLLongMapWithLength(buffer->shared, key, keyLength, value);
+}
+
+bool getConcurrentLLongBuffer(ConcurrentLLongBuffer* buffer, const char* key, long long* value) {
+    return getConcurrentLLongBufferWithLength(buffer, key, strlen(key), value);
+}
+
+void insertConcurrentLLongBufferWithLength(ConcurrentLLongBuffer* buffer, const char* key, int keyLength, long long value) {
+    /*
+    Inserts the key with the value, unless it's already in the buffer. The entry gets to the shared map once
+    the buffer fills up (or is flushed), and if another thread beat it there, the other thread's value is kept.
+    */
+    long long existing;
+    if (getLLongMapWithLength(&buffer->pending, key, keyLength, &existing)) return;
+
+    setLLongMapWithLength(&buffer->pending, key, keyLength, value);
+    if (countLLongMap(&buffer->pending) >= CONCURRENT_MAP_BUFFER_SIZE) flushConcurrentLLongBuffer(buffer);
+}
+
+void insertConcurrentLLongBuffer(ConcurrentLLongBuffer* buffer, const char* key, long long value) {
+    insertConcurrentLLongBufferWithLength(buffer, key, strlen(key), value);
+}
+
+// ================================ ConcurrentInt64Map ================================
+
+int concurrentInt64Shard(int64_t key) {
+    /*
+    Returns the shard the key belongs in, from the top bits of it's hash (see `concurrentLLongShard`).
+    */
+    return hashInt64(key) >> (64 - CONCURRENT_MAP_SHARD_BITS);
+}
+
+void initConcurrentInt64Map(ConcurrentInt64Map* map) {
+    for (int shardIdx = 0; shardIdx < CONCURRENT_MAP_SHARDS; shardIdx += 1) {
+        pthread_mutex_init(&map->shards[shardIdx].lock, NULL);
+        initInt64Map(&map->shards[shardIdx].map);
+    }
+}
+
+void freeConcurrentInt64Map(ConcurrentInt64Map* map) {
+    /*
+    Frees all memory associated with the map. No thread can be using the map (or have a buffer for it) anymore.
+    */
+    for (int shardIdx = 0; shardIdx < CONCURRENT_MAP_SHARDS; shardIdx += 1) {
+        pthread_mutex_destroy(&map->shards[shardIdx].lock);
+        freeInt64Map(&map->shards[shardIdx].map);
+    }
+}
+
+bool getConcurrentInt64Map(ConcurrentInt64Map* map, int64_t key, int64_t* value) {
+    ConcurrentInt64Shard* shard = &map->shards[concurrentInt64Shard(key)];
+
+    pthread_mutex_lock(&shard->lock);
+    bool found = getInt64Map(&shard->map, key, value);
+    pthread_mutex_unlock(&shard->lock);
+
+    return found;
+}
+
+bool insertConcurrentInt64Map(ConcurrentInt64Map* map, int64_t key, int64_t value) {
+    /*
+    Inserts the key with the value, unless the key's already in the map, in which case it's left as it is.
+    Returns true if the key was inserted.
+    */
+    ConcurrentInt64Shard* shard = &map->shards[concurrentInt64Shard(key)];
+
+    pthread_mutex_lock(&shard->lock);
+    int64_t existing;
+    bool isNew = !getInt64Map(&shard->map, key, &existing);
+    if (isNew) setInt64Map(&shard->map, key, value);
+    pthread_mutex_unlock(&shard->lock);
+
+    return isNew;
+}
+
+void getConcurrentInt64MapStats(ConcurrentInt64Map* map, MapStats* stats) {
+    /*
+    Gets the stats of all the shards added together, see `getConcurrentLLongMapStats`.
+    */
+    initMapStats(stats, 0, 0, 0, sizeof(ConcurrentInt64Map));
+
+    double totalProbeLength = 0;
+    for (int shardIdx = 0; shardIdx < CONCURRENT_MAP_SHARDS; shardIdx += 1) {
+        MapStats shardStats;
+        getInt64MapStats(&map->shards[shardIdx].map, &shardStats);
+
+        stats->numKeys += shardStats.numKeys;
+        stats->capacity += shardStats.capacity;
+        stats->bytesUsed += shardStats.bytesUsed;
+
+        totalProbeLength += shardStats.meanProbeLength * shardStats.numKeys;
+        if (shardStats.maxProbeLength > stats->maxProbeLength) stats->maxProbeLength = shardStats.maxProbeLength;
+        for (int bucket = 0; bucket < MAP_STATS_HISTOGRAM_SIZE; bucket += 1) stats->probeHistogram[bucket] += shardStats.probeHistogram[bucket];
+    }
+
+    stats->loadFactor = stats->capacity > 0 ? (double)stats->numKeys / stats->capacity : 0;
+    stats->meanProbeLength = stats->numKeys > 0 ? totalProbeLength / stats->numKeys : 0;
+}
+
+// ================================ ConcurrentInt64Buffer ================================
+
+void initConcurrentInt64Buffer(ConcurrentInt64Buffer* buffer, ConcurrentInt64Map* shared) {
+    buffer->shared = shared;
+    initInt64Map(&buffer->pending);
+}
+
+void flushConcurrentInt64Buffer(ConcurrentInt64Buffer* buffer) {
+    /*
+    Inserts the buffer's entries into the shared map, a shard at a time, and empties the buffer (see
+    `flushConcurrentLLongBuffer`).
+    */
+    int numPending = buffer->pending.numKeys;
+    if (numPending == 0) return;
+
+    int shardCounts[CONCURRENT_MAP_SHARDS + 1] = {0};
+
+    int cursor = 0;
+    int64_t key, value;
+    while (nextInt64Map(&buffer->pending, &cursor, &key, &value)) shardCounts[concurrentInt64Shard(key) + 1] += 1;
+
+    // Counting sort, `shardCounts[shard]` ends up as the index the shard's entries start at.
+    for (int shardIdx = 0; shardIdx < CONCURRENT_MAP_SHARDS; shardIdx += 1) shardCounts[shardIdx + 1] += shardCounts[shardIdx];
+
+    int64_t* keys = malloc(numPending * sizeof(int64_t));
+    int64_t* values = malloc(numPending * sizeof(int64_t));
+
+    int nextIdx[CONCURRENT_MAP_SHARDS];
+    memcpy(nextIdx, shardCounts, sizeof(nextIdx));
+
+    cursor = 0;
+    while (nextInt64Map(&buffer->pending, &cursor, &key, &value)) {
+        int entryIdx = nextIdx[concurrentInt64Shard(key)]++;
+        keys[entryIdx] = key;
+        values[entryIdx] = value;
+    }
+
+    for (int shardIdx = 0; shardIdx < CONCURRENT_MAP_SHARDS; shardIdx += 1) {
+        if (shardCounts[shardIdx] == shardCounts[shardIdx + 1]) continue;
+
+        ConcurrentInt64Shard* shard = &buffer->shared->shards[shardIdx];
+        pthread_mutex_lock(&shard->lock);
+        for (int entryIdx = shardCounts[shardIdx]; entryIdx < shardCounts[shardIdx + 1]; entryIdx += 1) {
+            int64_t existing;
+            if (!getInt64Map(&shard->map, keys[entryIdx], &existing)) setInt64Map(&shard->map, keys[entryIdx], values[entryIdx]);
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+
+    free(keys);
+    free(values);
+    clearInt64Map(&buffer->pending);
+}
+
+void freeConcurrentInt64Buffer(ConcurrentInt64Buffer* buffer) {
+    /*
+    Flushes the entries still in the buffer to the shared map, then frees the buffer.
+    */
+    flushConcurrentInt64Buffer(buffer);
+    freeInt64Map(&buffer->pending);
+}
+
+bool getConcurrentInt64Buffer(ConcurrentInt64Buffer* buffer, int64_t key, int64_t* value) {
+    /*
+    Gets the key's value from the buffer if this thread inserted it since the last flush, otherwise from the
+    shared map. Returns false if the key isn't in either.
+    */
+    if (getInt64Map(&buffer->pending, key, value)) return true;
+    return getConcurrentInt64Map(buffer->shared, key, value);
+}
+
+void insertConcurrentInt64Buffer(ConcurrentInt64Buffer* buffer, int64_t key, int64_t value) {
+    /*
+    Inserts the key with the value, unless it's already in the buffer (see `insertConcurrentLLongBufferWithLength`).
+    */
+    int64_t existing;
+    if (getInt64Map(&buffer->pending, key, &existing)) return;
+
+    setInt64Map(&buffer->pending, key, value);
+    if (buffer->pending.numKeys >= CONCURRENT_MAP_BUFFER_SIZE) flushConcurrentInt64Buffer(buffer);
+}
+
+#endif
@@ -21,14 +21,24 @@ pushInput(&program, 1);
 intcodeRun(&program);
 
 // See any output.
-printLLongArray(&program.output);
+long long output;
+while (popOutput(&program, &output)) printf("%lld\n", output);
 
 */
 
+#ifndef intcode_c
+#define intcode_c
+
+#include <fcntl.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "array.c"
+#include "channel.c"
 #include "string.c"
 
 // ================================ Constants ================================
@@ -36,6 +46,21 @@ printLLongArray(&program.output);
 // The max number of parameters any opcode has.
 #define MAX_OPCODE_PARAMETERS 3
 
+// The number of words in a page of memory, which is the unit memory is shared between forked programs in.
+#define INTCODE_PAGE_SIZE 256
+// The number of bits to shift an address by to get it's page, and the mask to get it's offset in the page.
+#define INTCODE_PAGE_SHIFT 8
+#define INTCODE_PAGE_MASK (INTCODE_PAGE_SIZE - 1)
+
+// The max number of pages in a program's page table (16M words), memory above that is stored sparsely.
+#define INTCODE_MAX_DENSE_PAGES (1 << 16)
+
+// The number of words the input and output channels of a program hold.
+#define INTCODE_CHANNEL_CAPACITY 1024
+
+// The number of combinations of the 3 parameter modes an instruction can have.
+#define PARAMETER_MODE_COMBINATIONS 27
+
 // clang-format off
 // The lengths of each instruction's parameter list, not including the opcode itself.
 int INSTRUCTION_PARAMETER_LENGTHS[100] = {
@@ -66,6 +91,32 @@ int INSTRUCTION_OUTPUT_PARAMETER_INDEXES[100] = {
 };
 // clang-format on
 
+// The first handler of each opcode's block of handlers in the threaded engine, see `runThreadedEngine`.
+// Handlers are specialized per parameter mode combination, so each opcode gets one handler per valid
+// combination of it's parameter modes.
+#define DECODE_HANDLER 0
+#define GENERIC_HANDLER 1
+#define ADD_HANDLERS 2
+#define MULTIPLY_HANDLERS 20
+#define LESS_THAN_HANDLERS 38
+#define EQUALS_HANDLERS 56
+#define STORE_INPUT_HANDLERS 74
+#define OUTPUT_HANDLERS 76
+#define JUMP_IF_TRUE_HANDLERS 79
+#define JUMP_IF_FALSE_HANDLERS 88
+#define ADJUST_RELATIVE_BASE_HANDLERS 97
+#define EXIT_HANDLER 100
+// Fused instructions, see `fuseInstruction`. Each is specialized for the parameter modes of it's first
+// instruction, the same way as that instruction's own handlers.
+#define LESS_THAN_JUMP_IF_TRUE_HANDLERS 101
+#define LESS_THAN_JUMP_IF_FALSE_HANDLERS 119
+#define EQUALS_JUMP_IF_TRUE_HANDLERS 137
+#define EQUALS_JUMP_IF_FALSE_HANDLERS 155
+#define ADD_JUMP_HANDLERS 173
+
+// The most words a fused instruction covers, a 4 word instruction followed by a 3 word jump.
+#define MAX_FUSED_LENGTH 7
+
 // ================================ Data ================================
 
 typedef enum OpCode {
@@ -132,6 +183,143 @@ typedef enum ParameterMode {
     RELATIVE = 2,
 } ParameterMode;
 
+/*
+A single instruction, decoded out of memory ahead of time.
+
+Decoding an instruction means splitting the opcode from its parameter modes (a few `%` and `/`s), and
+looking up how many parameters it has. Intcode programs spend nearly all their time in a handful of
+loops, so rather than redoing that work every step, each instruction is decoded the first time it's
+run and the result is cached by address.
+
+A cached instruction must always match what's actually in memory, so any write that lands on a word
+of a decoded instruction (the opcode OR one of its parameters) invalidates it, and it gets decoded
+again the next time it's run. See `storeInMemory`.
+
+The operands are the raw parameter values as they appear in memory, they still need to be evaluated
+with their parameter mode (and the current relative base) when the instruction is run.
+
+The threaded engine's handler can also be a fused one, which runs the instruction AND the jump right
+after it in one go, see `fuseInstruction`. A fused instruction depends on the words of both, which is
+what `span` covers.
+*/
+typedef struct {
+    // The number of words the instruction takes up in memory, including the opcode itself. A length
+    // of 0 means the instruction hasn't been decoded (or has been invalidated).
+    unsigned char length;
+    // The number of words the cached instruction was decoded from, the same as the length unless it's
+    // fused with the instruction after it.
+    unsigned char span;
+    unsigned char opcode;
+    // The threaded engine's handler for the instruction, a zeroed out slot has the DECODE_HANDLER.
+    unsigned char handler;
+    unsigned char parameterModes[MAX_OPCODE_PARAMETERS];
+    long long operands[MAX_OPCODE_PARAMETERS];
+} DecodedInstruction;
+
+/*
+A page of a program's memory, along with the decoded instructions cached for it.
+
+Pages are reference counted so that forked programs can share them, see `forkIntCodeProgram`. A page
+that's shared is never written to, the first write to it copies it into a page of it's own for the
+program doing the writing ("copy-on-write").
+
+Only instructions that fit entirely inside the page are cached in it, since the page can't tell when
+the next page (which might not be the same page across the programs sharing this one) changes.
+*/
+typedef struct {
+    int refCount;
+    // If any instructions have been cached in the page. Most pages only ever hold data, and writing to
+    // those doesn't need to invalidate anything.
+    bool hasDecoded;
+    // A bit per word, set if the word has been part of a cached instruction. Programs keep their variables
+    // right next to their code, so writes to the words in between can skip invalidating anything. Bits
+    // are never unset until the page is cleared, so a set bit only means the word MIGHT be cached.
+    unsigned long long decodedWords[INTCODE_PAGE_SIZE / 64];
+    long long words[INTCODE_PAGE_SIZE];
+    DecodedInstruction decoded[INTCODE_PAGE_SIZE];
+} IntCodePage;
+
+/*
+The page every page of memory that's never been written to points at, all 0s. It's shared by every program,
+and never written to or freed, the first write to a page of it allocates a real page in it's place. It's
+reference count is always 0, so it's never mistaken for a page a program owns.
+*/
+IntCodePage ZERO_PAGE;
+
+/*
+A page of memory beyond the page table, see the Memory section of the IntCodeProgram docs. An empty slot has
+a NULL page.
+*/
+typedef struct {
+    size_t pageIdx;
+    IntCodePage* page;
+} IntCodeSparsePage;
+
+/*
+The engine that runs a program's instructions. Both engines behave exactly the same, they only differ
+in how fast they are.
+
+LOOP_ENGINE:
+Runs one instruction at a time, checking the opcode against each of the opcodes in turn.
+
+THREADED_ENGINE:
+Jumps straight from the end of one instruction to the handler of the next one (via GCC's labels as
+values), where each handler is specialized for the instruction's opcode and parameter modes. Falls back
+to the LOOP_ENGINE on compilers without labels as values.
+*/
+typedef enum IntCodeEngine {
+    LOOP_ENGINE = 0,
+    THREADED_ENGINE = 1,
+} IntCodeEngine;
+
+/*
+Counts of everything a program ran, see `profileIntCodeProgram`. Counting is only compiled in when
+INTCODE_PROFILE is defined, otherwise, the engines don't touch the profile at all.
+
+Totals:
+- numRuns: The number of times the program was run from the start.
+- numInstructions: The number of instructions run.
+- numDispatches: The number of times the engine dispatched an instruction, which is less than the number of
+  instructions when instructions are fused.
+- inputWaits: The number of times the program stopped to wait on input.
+- outputBlocks: The number of times the program stopped on a full output channel.
+
+Counts:
+- opcodeCounts: The number of times each opcode was run.
+- modeCounts: The number of times each opcode was run with each combination of parameter modes, at
+  `opcode * PARAMETER_MODE_COMBINATIONS + mode1 + mode2 * 3 + mode3 * 9`.
+- addressCounts: The number of times the instruction at each address was run, for the first `numAddresses`
+  addresses, with the opcode it last ran as in `addressOpcodes`.
+
+Instructions that stop the program (waiting on input, or on a full output) are counted every time they're
+tried, since the engine has to get all the way to them to find out.
+*/
+typedef struct {
+    long long numRuns;
+    long long numInstructions;
+    long long numDispatches;
+    long long inputWaits;
+    long long outputBlocks;
+
+    long long opcodeCounts[100];
+    long long modeCounts[100 * PARAMETER_MODE_COMBINATIONS];
+
+    size_t numAddresses;
+    long long* addressCounts;
+    unsigned char* addressOpcodes;
+} IntCodeProfile;
+
+/*
+A basic block of a profiled program, a run of instructions [start, end) that were always run one after
+the other, the same number of times (`count`).
+*/
+typedef struct {
+    size_t start;
+    size_t end;
+    int numInstructions;
+    long long count;
+} IntCodeBlock;
+
 /*
 An Intcode Program, holding the source code, the program's working memory, where the program is at
 in evaluation, I/O, and more.
@@ -143,37 +331,300 @@ program is run. Once the program is run, `instructionPointer` points to the next
 evaluated.
 
 If a program hits the EXIT opcode, it is marked as `halted`. There are times when the program stops
-running without fully halting, like when it's waiting on input.
+running without fully halting, like when it's waiting on input, or when it's output channel is full
+(`blockedOnOutput`). Either way, running it again picks up right where it left off.
+
+Programs are run with the THREADED_ENGINE by default, the `engine` can be swapped at any point between
+runs. The threaded engine also fuses common pairs of instructions into one, unless `fuseInstructions` is
+turned off.
 
 Memory:
 
-The program's memory is initialized to the values of the program itself. As the program is run, the memory
-is expanded as needed. When a new block of memory is allocated, all the values in it are initialized to
-0. Accessing memory outside of the current allocated memory triggers the resize.
+The program's memory is initialized to the values of the program itself, with every other address 0.
+Use `readMemory` and `storeInMemory` to access it by address, any address can be read or written.
+
+Memory is split into pages of INTCODE_PAGE_SIZE words. The low addresses (where the program itself, and
+usually all of it's data, lives) are in the `pages` table, covering `memorySize` words, which grows as
+needed. Pages that have never been written to all point at the shared ZERO_PAGE, so growing the table
+only costs a pointer per page, a real page is only allocated on the first write to it.
+
+Writes past INTCODE_MAX_DENSE_PAGES pages (like to a wild relative base) go into `sparsePages` instead, a
+hash table of pages by page index, so they only ever allocate the pages actually written to.
+
+`residentPages` is the number of real (not ZERO_PAGE) pages the program is using, and `peakResidentPages`
+is the most it's used since it was last reset (i.e., over the current run).
+
+Decoding:
+
+Each page has a slot per word in it's `decoded` cache, which caches the decoded instruction at that
+address once it's been run. Instructions that cross a page boundary are never cached, and are decoded
+every time they're run.
+
+Forking:
+
+A program can be forked (or snapshotted), giving a new program in the exact same state that can be run
+independently. Forks share the source code and all of the memory pages neither of them have written
+to since the fork, so they're cheap to make in bulk.
 
 I/O:
 
-The `input` and `output` buffers handle the program's I/O. The input stores all current input to the
-program, and the `inputPointer` points to the next input to consume (like for a STORE_INPUT instruction).
-The output stores all outputted, with the most recent output being the last element in the buffer.
+The `input` and `output` channels handle the program's I/O, both are first-in-first-out queues holding
+up to INTCODE_CHANNEL_CAPACITY words. A STORE_INPUT instruction pops the oldest input, and an OUTPUT
+instruction pushes to the back of the output. Since the channels are bounded, a program outputting more
+than the output channel can hold is suspended until some of it's output is popped, just like a program
+waiting on input.
+
+Profiling:
+
+When built with INTCODE_PROFILE defined, a program with a `profile` counts every instruction it runs, see
+`profileIntCodeProgram` and `printIntCodeProfile`.
 */
 typedef struct {
     size_t programSize;
     long long* program;
+    // The number of programs sharing the source code (forks of each other).
+    int* programRefCount;
+    // The memory mapped image the source code is in, if it was loaded from one (see
+    // `initIntCodeProgramFromImage`), otherwise, the source code is malloc'd.
+    void* image;
+    size_t imageSize;
 
     size_t memorySize;
-    long long* memory;
+    size_t numPages;
+    IntCodePage** pages;
+
+    size_t numSparsePages;
+    size_t sparsePagesSize;
+    IntCodeSparsePage* sparsePages;
+
+    size_t residentPages;
+    size_t peakResidentPages;
+
+    IntCodeEngine engine;
+    // If instructions are fused as they're decoded, see `fuseInstruction`. Forks share decoded instructions,
+    // so turning this off doesn't unfuse instructions already fused by the program (or a fork of it).
+    bool fuseInstructions;
 
     size_t instructionPointer;
     // If the program is halted, i.e. hit opcode 99 or has not yet been run, or not.
     bool halted;
     size_t relativeBase;
 
-    size_t inputPointer;
-    LLongArray input;
-    LLongArray output;
+    LLongChannel input;
+    LLongChannel output;
+    // If the program stopped running because the output channel was full.
+    bool blockedOnOutput;
+
+    // What the program ran, only set while it's being profiled.
+    IntCodeProfile* profile;
 } IntCodeProgram;
 
+// ================================ Memory ================================
+
+IntCodePage* allocatePage() {
+    /*
+    Allocates a new, unshared page, with all it's words set to 0 and nothing decoded.
+    */
+    IntCodePage* page = calloc(1, sizeof(IntCodePage));
+    page->refCount = 1;
+
+    return page;
+}
+
+void releasePage(IntCodePage* page) {
+    /*
+    Releases a program's reference to the page, freeing it if no other program is using it.
+    */
+    if (page == &ZERO_PAGE) return;
+
+    page->refCount -= 1;
+    if (page->refCount == 0) free(page);
+}
+
+void retainPage(IntCodePage* page) {
+    /*
+    Adds a program's reference to the page, i.e., when forking.
+    */
+    if (page != &ZERO_PAGE) page->refCount += 1;
+}
+
+size_t hashPageIdx(size_t pageIdx, size_t tableSize) {
+    // Fibonacci hashing, spreads out runs of consecutive page indexes. The table size is a power of two.
+    return (pageIdx * 11400714819323198485ull) & (tableSize - 1);
+}
+
+IntCodePage* findSparsePage(IntCodeProgram* program, size_t pageIdx) {
+    /*
+    Finds the sparse page with the given page index, returning NULL if it's never been written to.
+    */
+    if (program->numSparsePages == 0) return NULL;
+
+    size_t slotIdx = hashPageIdx(pageIdx, program->sparsePagesSize);
+    while (program->sparsePages[slotIdx].page != NULL) {
+        if (program->sparsePages[slotIdx].pageIdx == pageIdx) return program->sparsePages[slotIdx].page;
+        slotIdx = (slotIdx + 1) & (program->sparsePagesSize - 1);
+    }
+
+    return NULL;
+}
+
+IntCodePage** findSparsePageSlot(IntCodeProgram* program, size_t pageIdx) {
+    /*
+    Finds the slot of the sparse page with the given page index, adding it (as a ZERO_PAGE) if it isn't
+    there yet. The slot is only valid until the next page is added.
+    */
+    // Keep the table at most half full, growing it (and re-inserting every page) when it gets there.
+    if ((program->numSparsePages + 1) * 2 > program->sparsePagesSize) {
+        size_t oldSize = program->sparsePagesSize;
+        IntCodeSparsePage* oldPages = program->sparsePages;
+
+        program->sparsePagesSize = oldSize == 0 ? 16 : oldSize * 2;
+        program->sparsePages = calloc(program->sparsePagesSize, sizeof(IntCodeSparsePage));
+        for (size_t idx = 0; idx < oldSize; idx += 1) {
+            if (oldPages[idx].page == NULL) continue;
+
+            size_t slotIdx = hashPageIdx(oldPages[idx].pageIdx, program->sparsePagesSize);
+            while (program->sparsePages[slotIdx].page != NULL) slotIdx = (slotIdx + 1) & (program->sparsePagesSize - 1);
+            program->sparsePages[slotIdx] = oldPages[idx];
+        }
+        free(oldPages);
+    }
+
+    size_t slotIdx = hashPageIdx(pageIdx, program->sparsePagesSize);
+    while (program->sparsePages[slotIdx].page != NULL) {
+        if (program->sparsePages[slotIdx].pageIdx == pageIdx) return &program->sparsePages[slotIdx].page;
+        slotIdx = (slotIdx + 1) & (program->sparsePagesSize - 1);
+    }
+
+    program->sparsePages[slotIdx].pageIdx = pageIdx;
+    program->sparsePages[slotIdx].page = &ZERO_PAGE;
+    program->numSparsePages += 1;
+    return &program->sparsePages[slotIdx].page;
+}
+
+long long readMemory(IntCodeProgram* program, size_t idx) {
+    /*
+    Reads the value in program memory at the given idx, any address that's never been written to is 0.
+    */
+    if (idx < program->memorySize) return program->pages[idx >> INTCODE_PAGE_SHIFT]->words[idx & INTCODE_PAGE_MASK];
+
+    IntCodePage* page = findSparsePage(program, idx >> INTCODE_PAGE_SHIFT);
+    return page == NULL ? 0 : page->words[idx & INTCODE_PAGE_MASK];
+}
+
+IntCodePage* unsharePage(IntCodeProgram* program, IntCodePage** slot) {
+    /*
+    Gets the page in the given slot of the program's pages for writing to. If the page is shared with any
+    other programs (or is the ZERO_PAGE), it's copied, and the program switches over to using the copy.
+    */
+    IntCodePage* page = *slot;
+    if (page->refCount == 1) return page;
+
+    IntCodePage* copy;
+    if (page == &ZERO_PAGE) {
+        copy = allocatePage();
+
+        program->residentPages += 1;
+        if (program->residentPages > program->peakResidentPages) program->peakResidentPages = program->residentPages;
+    } else {
+        copy = malloc(sizeof(IntCodePage));
+        memcpy(copy, page, sizeof(IntCodePage));
+        copy->refCount = 1;
+    }
+
+    releasePage(page);
+    *slot = copy;
+
+    return copy;
+}
+
+bool isDecodedWord(IntCodePage* page, size_t offset) {
+    // If the word at the offset might be part of a cached instruction.
+    return (page->decodedWords[offset >> 6] >> (offset & 63)) & 1;
+}
+
+void invalidateDecodedInstructions(IntCodePage* page, size_t offset) {
+    /*
+    Invalidates any cached instruction in the page that the word at the given offset is a part of, as
+    either the opcode or one of it's parameters (or one of the words of a jump it's fused with).
+    */
+
+    // The word could belong to a fused instruction starting up to MAX_FUSED_LENGTH - 1 words before it.
+    for (size_t distance = 0; distance < MAX_FUSED_LENGTH && distance <= offset; distance += 1) {
+        DecodedInstruction* instruction = &page->decoded[offset - distance];
+        if (instruction->span > distance) {
+            instruction->length = 0;
+            instruction->span = 0;
+            instruction->handler = DECODE_HANDLER;
+        }
+    }
+}
+
+void storeInMemory(IntCodeProgram* program, size_t idx, long long value) {
+    /*
+    Stores the value in program memory at the given idx, allocating more memory if needed.
+
+    If the given idx is past the page table, the table doubles until it's large enough (up to
+    INTCODE_MAX_DENSE_PAGES pages), with the new pages all pointing at the ZERO_PAGE. Past that, the value
+    is stored in a sparse page. Either way, only the page being written to is actually allocated.
+
+    If the value lands on a cached instruction (and actually changes it), that instruction is
+    invalidated. If it lands on a page shared with a fork (and actually changes it), the page is
+    copied first.
+    */
+    size_t pageIdx = idx >> INTCODE_PAGE_SHIFT;
+    size_t offset = idx & INTCODE_PAGE_MASK;
+
+    IntCodePage** slot;
+    if (pageIdx < program->numPages) {
+        slot = &program->pages[pageIdx];
+    } else if (pageIdx < INTCODE_MAX_DENSE_PAGES) {
+        size_t originalNumPages = program->numPages;
+        // Grow the page table, doubling it until it's greater than the necessary idx.
+        while (program->numPages <= pageIdx) program->numPages *= 2;
+        if (program->numPages > INTCODE_MAX_DENSE_PAGES) program->numPages = INTCODE_MAX_DENSE_PAGES;
+        program->pages = realloc(program->pages, program->numPages * sizeof(IntCodePage*));
+
+        for (size_t pIdx = originalNumPages; pIdx < program->numPages; pIdx += 1) program->pages[pIdx] = &ZERO_PAGE;
+        program->memorySize = program->numPages * INTCODE_PAGE_SIZE;
+
+        slot = &program->pages[pageIdx];
+    } else {
+        // Storing a 0 to a sparse page that doesn't exist yet doesn't change anything.
+        if (value == 0 && findSparsePage(program, pageIdx) == NULL) return;
+        slot = findSparsePageSlot(program, pageIdx);
+    }
+
+    if ((*slot)->words[offset] == value) return;
+
+    IntCodePage* page = unsharePage(program, slot);
+    if (isDecodedWord(page, offset)) invalidateDecodedInstructions(page, offset);
+    page->words[offset] = value;
+}
+
+void clearPage(IntCodeProgram* program, IntCodePage** slot) {
+    /*
+    Clears the page in the given slot to all 0s. A page of the program's own is zeroed in place, so it can be
+    reused without allocating, a shared page is swapped for the ZERO_PAGE.
+    */
+    IntCodePage* page = *slot;
+    if (page == &ZERO_PAGE) return;
+
+    if (page->refCount == 1) {
+        memset(page->words, 0, sizeof(page->words));
+        if (page->hasDecoded) {
+            memset(page->decoded, 0, sizeof(page->decoded));
+            memset(page->decodedWords, 0, sizeof(page->decodedWords));
+        }
+        page->hasDecoded = false;
+        return;
+    }
+
+    releasePage(page);
+    *slot = &ZERO_PAGE;
+    program->residentPages -= 1;
+}
+
 // ================================ Utilities ================================
 
 void printIntCodeProgram(IntCodeProgram* program) {
@@ -181,6 +632,7 @@ void printIntCodeProgram(IntCodeProgram* program) {
     Nicely displays an intcode program and it's memory.
     */
     printf("[Size=%zu, Instruction Pointer=%zu, Halted=%d, Relative Base=%zu]\n", program->programSize, program->instructionPointer, program->halted, program->relativeBase);
+    printf("[Resident Pages=%zu, Peak Resident Pages=%zu, Sparse Pages=%zu]\n", program->residentPages, program->peakResidentPages, program->numSparsePages);
     printf("Program: [");
     for (size_t idx = 0; idx < program->programSize; idx += 1) {
         if (idx == program->programSize - 1)
@@ -193,32 +645,48 @@ void printIntCodeProgram(IntCodeProgram* program) {
     for (size_t idx = 0; idx < program->memorySize; idx += 1) {
         if (idx == program->instructionPointer) printf("->");
         if (idx == program->memorySize - 1)
-            printf("%lld", program->memory[idx]);
+            printf("%lld", readMemory(program, idx));
         else
-            printf("%lld, ", program->memory[idx]);
+            printf("%lld, ", readMemory(program, idx));
     }
     printf("]\n");
 
     printf("Input: ");
-    printLLongArray(&program->input);
+    printLLongChannel(&program->input);
 
     printf("Output: ");
-    printLLongArray(&program->output);
+    printLLongChannel(&program->output);
     printf("\n");
 }
 
-void initIntCodeProgramFromLLongArray(IntCodeProgram* program, LLongArray* array) {
+void initIntCodeProgramState(IntCodeProgram* program) {
     /*
-    Initializes an intcode program from the given integer array.
+    Initializes everything about a program but it's source code, which has to already be set, loading the
+    source code into memory.
     */
-    program->programSize = array->numItems;
-    program->program = malloc(program->programSize * sizeof(long long));
-    for (size_t idx = 0; idx < array->numItems; idx += 1) program->program[idx] = array->data[idx];
+    program->programRefCount = malloc(sizeof(int));
+    *program->programRefCount = 1;
 
-    // Allocate twice as much memory as the original program takes to start. More gets allocated when
-    // need as the program runs.
-    program->memorySize = array->numItems * 2;
-    program->memory = malloc(program->memorySize * sizeof(long long));
+    // Start the page table off with (at least) twice as much memory as the original program takes. The
+    // table grows as needed while the program runs, and pages are only allocated once they're written to.
+    program->numPages = (program->programSize * 2 + INTCODE_PAGE_SIZE - 1) / INTCODE_PAGE_SIZE;
+    if (program->numPages == 0) program->numPages = 1;
+    program->memorySize = program->numPages * INTCODE_PAGE_SIZE;
+    program->pages = malloc(program->numPages * sizeof(IntCodePage*));
+    for (size_t pageIdx = 0; pageIdx < program->numPages; pageIdx += 1) program->pages[pageIdx] = &ZERO_PAGE;
+
+    program->numSparsePages = 0;
+    program->sparsePagesSize = 0;
+    program->sparsePages = NULL;
+
+    program->residentPages = 0;
+    program->peakResidentPages = 0;
+
+    // Load the program into memory up front, so forks made before it's first run share the pages it's in.
+    for (size_t idx = 0; idx < program->programSize; idx += 1) storeInMemory(program, idx, program->program[idx]);
+
+    program->engine = THREADED_ENGINE;
+    program->fuseInstructions = true;
 
     program->instructionPointer = 0;
     // A never-before-run program starts off as halted, until it's run for the first time.
@@ -226,10 +694,24 @@ void initIntCodeProgramFromLLongArray(IntCodeProgram* program, LLongArray* array
     // Relative mode starts at a base of 0 until adjusted by the ADJUST_RELATIVE_BASE instruction.
     program->relativeBase = 0;
 
-    initLLongArray(&program->input, 1024);
-    initLLongArray(&program->output, 1024);
+    initLLongChannel(&program->input, INTCODE_CHANNEL_CAPACITY);
+    initLLongChannel(&program->output, INTCODE_CHANNEL_CAPACITY);
+    program->blockedOnOutput = false;
+
+    program->profile = NULL;
+}
+
+void initIntCodeProgramFromLLongArray(IntCodeProgram* program, LLongArray* array) {
+    /*
+    Initializes an intcode program from the given integer array.
+    */
+    program->programSize = array->numItems;
+    program->program = malloc(program->programSize * sizeof(long long));
+    for (size_t idx = 0; idx < array->numItems; idx += 1) program->program[idx] = array->data[idx];
+    program->image = NULL;
+    program->imageSize = 0;
 
-    program->inputPointer = 0;
+    initIntCodeProgramState(program);
 }
 
 void initIntCodeProgramFromFile(IntCodeProgram* program, char* inputFilePath) {
@@ -258,32 +740,413 @@ void freeIntCodeProgram(IntCodeProgram* program) {
     /*
     Frees all memory associated with the program.
     */
-    free(program->program);
+    // Forks share the source code, only free it once no fork is using it.
+    *program->programRefCount -= 1;
+    if (*program->programRefCount == 0) {
+        if (program->image != NULL) {
+            munmap(program->image, program->imageSize);
+        } else {
+            free(program->program);
+        }
+        free(program->programRefCount);
+    }
     program->program = NULL;
-    free(program->memory);
-    program->memory = NULL;
+    program->programRefCount = NULL;
+
+    for (size_t pageIdx = 0; pageIdx < program->numPages; pageIdx += 1) releasePage(program->pages[pageIdx]);
+    free(program->pages);
+    program->pages = NULL;
+
+    for (size_t slotIdx = 0; slotIdx < program->sparsePagesSize; slotIdx += 1) {
+        if (program->sparsePages[slotIdx].page != NULL) releasePage(program->sparsePages[slotIdx].page);
+    }
+    free(program->sparsePages);
+    program->sparsePages = NULL;
+    program->numSparsePages = 0;
+    program->sparsePagesSize = 0;
 
     program->programSize = 0;
     program->memorySize = 0;
+    program->numPages = 0;
+    program->residentPages = 0;
     program->instructionPointer = 0;
 
-    freeLLongArray(&program->input);
-    freeLLongArray(&program->output);
-    program->inputPointer = 0;
+    freeLLongChannel(&program->input);
+    freeLLongChannel(&program->output);
+
+    if (program->profile != NULL) {
+        free(program->profile->addressCounts);
+        free(program->profile->addressOpcodes);
+        free(program->profile);
+        program->profile = NULL;
+    }
+}
+
+// ================================ Forking ================================
+
+void forkIntCodeProgram(IntCodeProgram* program, IntCodeProgram* fork) {
+    /*
+    Initializes `fork` as an exact copy of the program, in the middle of whatever it was doing. Both
+    programs can then be run (and freed) independently of each other.
+
+    The fork shares the program's source code and memory pages, a page is only copied once either of
+    them writes to it. The I/O channels are copied outright.
+
+    NOTE: Since the source code is shared, changing `program` after forking changes it for every fork.
+    */
+    *fork = *program;
+
+    *program->programRefCount += 1;
+
+    fork->pages = malloc(program->numPages * sizeof(IntCodePage*));
+    for (size_t pageIdx = 0; pageIdx < program->numPages; pageIdx += 1) {
+        fork->pages[pageIdx] = program->pages[pageIdx];
+        retainPage(fork->pages[pageIdx]);
+    }
+
+    if (program->sparsePagesSize > 0) {
+        fork->sparsePages = malloc(program->sparsePagesSize * sizeof(IntCodeSparsePage));
+        memcpy(fork->sparsePages, program->sparsePages, program->sparsePagesSize * sizeof(IntCodeSparsePage));
+        for (size_t slotIdx = 0; slotIdx < program->sparsePagesSize; slotIdx += 1) {
+            if (fork->sparsePages[slotIdx].page != NULL) retainPage(fork->sparsePages[slotIdx].page);
+        }
+    }
+
+    copyLLongChannel(&program->input, &fork->input);
+    copyLLongChannel(&program->output, &fork->output);
+
+    // Profiles belong to a single program, forks start off without one.
+    fork->profile = NULL;
+}
+
+void snapshotIntCodeProgram(IntCodeProgram* program, IntCodeProgram* snapshot) {
+    /*
+    Takes a snapshot of the program's current state, which can be restored with `restoreIntCodeProgram`
+    as many times as needed. A snapshot is a fork that's kept around instead of being run, so it's just
+    as cheap to take.
+    */
+    forkIntCodeProgram(program, snapshot);
+}
+
+void restoreIntCodeProgram(IntCodeProgram* program, IntCodeProgram* snapshot) {
+    /*
+    Restores the program back to the state the snapshot was taken in, throwing away it's current state.
+    The snapshot is untouched, so it can be restored again later.
+
+    The program keeps it's profile (if it has one), so a profile covers everything run across restores.
+    */
+    IntCodeProfile* profile = program->profile;
+    program->profile = NULL;
+
+    freeIntCodeProgram(program);
+    forkIntCodeProgram(snapshot, program);
+
+    program->profile = profile;
+}
+
+unsigned long long hashIntCodeWord(size_t address, long long value) {
+    /*
+    Mixes a word of memory and it's address into a well-spread hash (the splitmix64 finalizer).
+    */
+    unsigned long long hash = (address * 0x9E3779B97F4A7C15ull) ^ (unsigned long long)value;
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+    return hash ^ (hash >> 31);
+}
+
+unsigned long long hashIntCodeProgram(IntCodeProgram* program) {
+    /*
+    Hashes the program's state, it's memory and where it's at in it, so programs in the exact same state
+    (like forks that ended up in the same place by different routes) hash the same, no matter how their
+    pages are laid out.
+
+    Only words that aren't 0 count towards the hash, so pages that were never written to are skipped.
+    */
+    unsigned long long hash = hashIntCodeWord(program->instructionPointer, program->relativeBase);
+
+    for (size_t pageIdx = 0; pageIdx < program->numPages; pageIdx += 1) {
+        IntCodePage* page = program->pages[pageIdx];
+        if (page == &ZERO_PAGE) continue;
+
+        for (size_t offset = 0; offset < INTCODE_PAGE_SIZE; offset += 1) {
+            if (page->words[offset] != 0) hash += hashIntCodeWord((pageIdx << INTCODE_PAGE_SHIFT) + offset, page->words[offset]);
+        }
+    }
+
+    for (size_t slotIdx = 0; slotIdx < program->sparsePagesSize; slotIdx += 1) {
+        IntCodePage* page = program->sparsePages[slotIdx].page;
+        if (page == NULL || page == &ZERO_PAGE) continue;
+
+        size_t pageIdx = program->sparsePages[slotIdx].pageIdx;
+        for (size_t offset = 0; offset < INTCODE_PAGE_SIZE; offset += 1) {
+            if (page->words[offset] != 0) hash += hashIntCodeWord((pageIdx << INTCODE_PAGE_SHIFT) + offset, page->words[offset]);
+        }
+    }
+
+    return hash;
+}
+
+// ================================ Profiling ================================
+
+#ifdef INTCODE_PROFILE
+// Counts the instruction at the address, which is about to run, if the program is being profiled.
+#define PROFILE_INSTRUCTION(program, address, instruction)                                          \
+    do {                                                                                            \
+        if ((program)->profile != NULL) recordInstruction((program)->profile, (address), (instruction), true); \
+    } while (0)
+// Counts the program stopping to wait on input (or on a full output, if `onInput` is false).
+#define PROFILE_BLOCKED(program, onInput)                                                           \
+    do {                                                                                            \
+        if ((program)->profile != NULL) {                                                           \
+            if (onInput) (program)->profile->inputWaits += 1;                                       \
+            else (program)->profile->outputBlocks += 1;                                             \
+        }                                                                                           \
+    } while (0)
+// Counts the program being run from the start.
+#define PROFILE_RUN(program)                                                                        \
+    do {                                                                                            \
+        if ((program)->profile != NULL) (program)->profile->numRuns += 1;                           \
+    } while (0)
+#else
+#define PROFILE_INSTRUCTION(program, address, instruction) \
+    do {                                                   \
+    } while (0)
+#define PROFILE_BLOCKED(program, onInput) \
+    do {                                  \
+    } while (0)
+#define PROFILE_RUN(program) \
+    do {                     \
+    } while (0)
+#endif
+
+void clearIntCodeProfile(IntCodeProfile* profile) {
+    /*
+    Resets every count in the profile to 0.
+    */
+    profile->numRuns = 0;
+    profile->numInstructions = 0;
+    profile->numDispatches = 0;
+    profile->inputWaits = 0;
+    profile->outputBlocks = 0;
+
+    memset(profile->opcodeCounts, 0, sizeof(profile->opcodeCounts));
+    memset(profile->modeCounts, 0, sizeof(profile->modeCounts));
+    memset(profile->addressCounts, 0, profile->numAddresses * sizeof(long long));
+    memset(profile->addressOpcodes, 0, profile->numAddresses * sizeof(unsigned char));
+}
+
+void profileIntCodeProgram(IntCodeProgram* program) {
+    /*
+    Starts profiling the program, counting everything it runs from here on, across any number of runs.
+    Profiling a program that's already being profiled starts it's profile over.
+
+    NOTE: Nothing is counted unless this is built with INTCODE_PROFILE defined (i.e., `-DINTCODE_PROFILE`).
+    */
+#ifndef INTCODE_PROFILE
+    printf("NOTE: Intcode profiling isn't compiled in, build with -DINTCODE_PROFILE to count anything.\n");
+#endif
+
+    if (program->profile == NULL) {
+        program->profile = malloc(sizeof(IntCodeProfile));
+        program->profile->numAddresses = 0;
+        program->profile->addressCounts = NULL;
+        program->profile->addressOpcodes = NULL;
+    }
+
+    clearIntCodeProfile(program->profile);
+}
+
+void recordInstruction(IntCodeProfile* profile, size_t address, DecodedInstruction* instruction, bool dispatched) {
+    /*
+    Counts a run of the decoded instruction at the address, which was `dispatched` on it's own, rather than
+    as part of a fused instruction.
+    */
+    profile->numInstructions += 1;
+    if (dispatched) profile->numDispatches += 1;
+    if (instruction->opcode >= 100) return;
+
+    profile->opcodeCounts[instruction->opcode] += 1;
+
+    unsigned char* modes = instruction->parameterModes;
+    if (modes[0] <= RELATIVE && modes[1] <= RELATIVE && modes[2] <= RELATIVE) {
+        profile->modeCounts[instruction->opcode * PARAMETER_MODE_COMBINATIONS + modes[0] + modes[1] * 3 + modes[2] * 9] += 1;
+    }
+
+    // Only addresses in the range the page table can cover get counted, anything past that is a wild jump.
+    if (address >= profile->numAddresses) {
+        if (address >= (size_t)INTCODE_MAX_DENSE_PAGES * INTCODE_PAGE_SIZE) return;
+
+        size_t numAddresses = profile->numAddresses == 0 ? 1024 : profile->numAddresses;
+        while (numAddresses <= address) numAddresses *= 2;
+
+        profile->addressCounts = realloc(profile->addressCounts, numAddresses * sizeof(long long));
+        profile->addressOpcodes = realloc(profile->addressOpcodes, numAddresses * sizeof(unsigned char));
+        memset(profile->addressCounts + profile->numAddresses, 0, (numAddresses - profile->numAddresses) * sizeof(long long));
+        memset(profile->addressOpcodes + profile->numAddresses, 0, (numAddresses - profile->numAddresses) * sizeof(unsigned char));
+        profile->numAddresses = numAddresses;
+    }
+
+    profile->addressCounts[address] += 1;
+    profile->addressOpcodes[address] = instruction->opcode;
+}
+
+char* getOpcodeName(int opcode) {
+    /*
+    Gets the name of the opcode, for reports.
+    */
+    if (opcode == ADD) return "ADD";
+    if (opcode == MULTIPLY) return "MULTIPLY";
+    if (opcode == STORE_INPUT) return "STORE_INPUT";
+    if (opcode == OUTPUT) return "OUTPUT";
+    if (opcode == JUMP_IF_TRUE) return "JUMP_IF_TRUE";
+    if (opcode == JUMP_IF_FALSE) return "JUMP_IF_FALSE";
+    if (opcode == LESS_THAN) return "LESS_THAN";
+    if (opcode == EQUALS) return "EQUALS";
+    if (opcode == ADJUST_RELATIVE_BASE) return "ADJUST_RELATIVE_BASE";
+    if (opcode == EXIT) return "EXIT";
+
+    return "UNKNOWN";
+}
+
+int compareIntCodeBlocks(const void* a, const void* b) {
+    // Sorts blocks by the number of instructions run in them, most first.
+    const IntCodeBlock* blockA = a;
+    const IntCodeBlock* blockB = b;
+    long long totalA = blockA->count * blockA->numInstructions;
+    long long totalB = blockB->count * blockB->numInstructions;
+
+    if (totalA != totalB) return totalA > totalB ? -1 : 1;
+    return blockA->start < blockB->start ? -1 : 1;
+}
+
+size_t findIntCodeBlocks(IntCodeProfile* profile, IntCodeBlock** blocksDest) {
+    /*
+    Splits the instructions the profiled program ran into basic blocks, storing an array of them (which
+    the caller has to free) in `blocksDest`, in order of address.
+
+    The profile doesn't know where jumps landed, so a block is a run of back to back instructions that were
+    all run the same number of times, ending at the first jump (or EXIT). That splits blocks at every jump
+    target that's also fallen into from the instruction before it, unless the counts happen to line up.
+
+    Returns the number of blocks.
+    */
+    size_t numBlocks = 0;
+    size_t blocksSize = 64;
+    IntCodeBlock* blocks = malloc(blocksSize * sizeof(IntCodeBlock));
+
+    bool blockEnded = true;
+    size_t address = 0;
+    while (address < profile->numAddresses) {
+        long long count = profile->addressCounts[address];
+        if (count == 0) {
+            address += 1;
+            continue;
+        }
+
+        int opcode = profile->addressOpcodes[address];
+        IntCodeBlock* block = numBlocks > 0 ? &blocks[numBlocks - 1] : NULL;
+
+        if (blockEnded || block->end != address || block->count != count) {
+            if (numBlocks == blocksSize) {
+                blocksSize *= 2;
+                blocks = realloc(blocks, blocksSize * sizeof(IntCodeBlock));
+            }
+
+            block = &blocks[numBlocks];
+            block->start = address;
+            block->numInstructions = 0;
+            block->count = count;
+            numBlocks += 1;
+        }
+
+        address += INSTRUCTION_PARAMETER_LENGTHS[opcode] + 1;
+        block->end = address;
+        block->numInstructions += 1;
+        blockEnded = opcode == JUMP_IF_TRUE || opcode == JUMP_IF_FALSE || opcode == EXIT;
+    }
+
+    *blocksDest = blocks;
+    return numBlocks;
+}
+
+void printIntCodeProfile(IntCodeProgram* program, int maxRows) {
+    /*
+    Prints a report of the program's profile: how often each opcode ran, the hottest `maxRows` combinations
+    of opcodes and parameter modes, and the hottest `maxRows` basic blocks, along with the instructions in
+    each one as they're currently in memory.
+
+        [    14,     26)   3 instructions x 100000 = 300000 (42.86%): 1001 1007 1005
+    */
+    IntCodeProfile* profile = program->profile;
+    if (profile == NULL) {
+        printf("Profile: The program isn't being profiled.\n");
+        return;
+    }
+
+    long long numInstructions = profile->numInstructions > 0 ? profile->numInstructions : 1;
+
+    printf("Profile: %lld instructions (%lld dispatches) over %lld runs, %lld input waits, %lld output blocks\n", profile->numInstructions, profile->numDispatches, profile->numRuns, profile->inputWaits, profile->outputBlocks);
+
+    printf("Opcodes:\n");
+    for (int opcode = 0; opcode < 100; opcode += 1) {
+        long long count = profile->opcodeCounts[opcode];
+        if (count == 0) continue;
+
+        printf("    %-20s %12lld (%6.2f%%)\n", getOpcodeName(opcode), count, 100.0 * count / numInstructions);
+    }
+
+    // Print the mode combinations hottest first, as the instruction they'd be in memory (i.e., 1002).
+    printf("Parameter Modes:\n");
+    long long modeCounts[100 * PARAMETER_MODE_COMBINATIONS];
+    memcpy(modeCounts, profile->modeCounts, sizeof(modeCounts));
+    for (int row = 0; row < maxRows; row += 1) {
+        int hottest = 0;
+        for (int idx = 1; idx < 100 * PARAMETER_MODE_COMBINATIONS; idx += 1) {
+            if (modeCounts[idx] > modeCounts[hottest]) hottest = idx;
+        }
+        if (modeCounts[hottest] == 0) break;
+
+        int opcode = hottest / PARAMETER_MODE_COMBINATIONS;
+        int modes = hottest % PARAMETER_MODE_COMBINATIONS;
+        int instruction = opcode + (modes % 3) * 100 + (modes / 3 % 3) * 1000 + (modes / 9) * 10000;
+
+        printf("    %5d %-20s %12lld (%6.2f%%)\n", instruction, getOpcodeName(opcode), modeCounts[hottest], 100.0 * modeCounts[hottest] / numInstructions);
+        modeCounts[hottest] = 0;
+    }
+
+    IntCodeBlock* blocks;
+    size_t numBlocks = findIntCodeBlocks(profile, &blocks);
+    qsort(blocks, numBlocks, sizeof(IntCodeBlock), compareIntCodeBlocks);
+
+    printf("Hottest Blocks:\n");
+    for (size_t idx = 0; idx < numBlocks && idx < (size_t)maxRows; idx += 1) {
+        IntCodeBlock* block = &blocks[idx];
+        long long total = block->count * block->numInstructions;
+
+        printf("    [%6zu, %6zu) %3d instructions x %lld = %lld (%.2f%%):", block->start, block->end, block->numInstructions, block->count, total, 100.0 * total / numInstructions);
+        size_t address = block->start;
+        while (address < block->end) {
+            printf(" %lld", readMemory(program, address));
+            address += INSTRUCTION_PARAMETER_LENGTHS[profile->addressOpcodes[address]] + 1;
+        }
+        printf("\n");
+    }
+
+    free(blocks);
 }
 
 // ================================ Running Programs ================================
 
-int getOpcode(IntCodeProgram* program, ParameterMode* parameterModes) {
+int getOpcode(IntCodeProgram* program, size_t address, ParameterMode* parameterModes) {
     /*
-    Gets the opcode at the current instruction pointer of the program, storing the instruction's parameter
-    modes in the given array at the same time.
+    Gets the opcode at the given address of the program, storing the instruction's parameter modes in the
+    given array at the same time.
 
         [1, 0, 0, 1, ->2102, ...] -> opcode=2, parameterModes=[1, 2, 0]
 
-    The instruction pointer MUST be pointing at an opcode.
+    The address MUST be pointing at an opcode.
     */
-    long long instruction = program->memory[program->instructionPointer];
+    long long instruction = readMemory(program, address);
 
     // If the instruction is only one or two digits, the opcode is the instruction and the parameter
     // modes are the implicit POSITION mode.
@@ -311,6 +1174,145 @@ int getOpcode(IntCodeProgram* program, ParameterMode* parameterModes) {
     return opcode;
 }
 
+int getInstructionHandler(int opcode, ParameterMode* parameterModes) {
+    /*
+    Gets the threaded engine's handler for the opcode with the given parameter modes.
+
+    Output parameters are only ever POSITION or RELATIVE (IMMEDIATE is treated as POSITION), so they
+    only get two handlers each. Unknown opcodes and parameter modes are left to the GENERIC_HANDLER.
+    */
+    for (int idx = 0; idx < INSTRUCTION_PARAMETER_LENGTHS[opcode]; idx += 1) {
+        if (parameterModes[idx] > RELATIVE) return GENERIC_HANDLER;
+    }
+
+    int outputIdx = INSTRUCTION_OUTPUT_PARAMETER_INDEXES[opcode];
+    int outputMode = outputIdx != -1 && parameterModes[outputIdx] == RELATIVE;
+    int threeParameterModes = parameterModes[0] * 6 + parameterModes[1] * 2 + outputMode;
+    int twoParameterModes = parameterModes[0] * 3 + parameterModes[1];
+
+    if (opcode == ADD) return ADD_HANDLERS + threeParameterModes;
+    if (opcode == MULTIPLY) return MULTIPLY_HANDLERS + threeParameterModes;
+    if (opcode == LESS_THAN) return LESS_THAN_HANDLERS + threeParameterModes;
+    if (opcode == EQUALS) return EQUALS_HANDLERS + threeParameterModes;
+    if (opcode == STORE_INPUT) return STORE_INPUT_HANDLERS + outputMode;
+    if (opcode == OUTPUT) return OUTPUT_HANDLERS + parameterModes[0];
+    if (opcode == JUMP_IF_TRUE) return JUMP_IF_TRUE_HANDLERS + twoParameterModes;
+    if (opcode == JUMP_IF_FALSE) return JUMP_IF_FALSE_HANDLERS + twoParameterModes;
+    if (opcode == ADJUST_RELATIVE_BASE) return ADJUST_RELATIVE_BASE_HANDLERS + parameterModes[0];
+    if (opcode == EXIT) return EXIT_HANDLER;
+
+    return GENERIC_HANDLER;
+}
+
+void decodeInstruction(IntCodeProgram* program, size_t address, DecodedInstruction* instruction) {
+    /*
+    Decodes the instruction at the given address into the given instruction, without evaluating any of
+    it's parameters.
+
+        [1, 0, 0, 1, ->2102, 3, 4, 5, ...] -> opcode=2, length=4, parameterModes=[1, 2, 0], operands=[3, 4, 5]
+
+    The address MUST be pointing at an opcode.
+    */
+    ParameterMode parameterModes[MAX_OPCODE_PARAMETERS];
+    int opcode = getOpcode(program, address, parameterModes);
+
+    instruction->opcode = opcode;
+    instruction->length = INSTRUCTION_PARAMETER_LENGTHS[opcode] + 1;
+    instruction->span = instruction->length;
+    instruction->handler = getInstructionHandler(opcode, parameterModes);
+    for (int idx = 0; idx < MAX_OPCODE_PARAMETERS; idx += 1) {
+        instruction->parameterModes[idx] = parameterModes[idx];
+        instruction->operands[idx] = idx < INSTRUCTION_PARAMETER_LENGTHS[opcode] ? readMemory(program, address + 1 + idx) : 0;
+    }
+}
+
+void fuseInstruction(IntCodeProgram* program, size_t address, DecodedInstruction* instruction, size_t maxSpan) {
+    /*
+    Fuses the decoded instruction at the address with the jump right after it, if they're one of the idioms
+    the threaded engine has a fused handler for ("superinstructions"):
+
+    - LESS_THAN or EQUALS, followed by a JUMP_IF_TRUE or JUMP_IF_FALSE on the result, to an IMMEDIATE target.
+      This is how every Intcode `if` and loop condition is compiled:
+
+        [->1007, 100, 5, 101, 1005, 101, 42] -> if memory[100] < 5, jump to 42
+
+    - ADD, followed by an unconditional jump (an IMMEDIATE test that always passes) to an IMMEDIATE target,
+      i.e., the increment at the end of a loop jumping back to the top of it.
+
+    Fusing only swaps the handler, the rest of the decoded instruction is still the first instruction on
+    it's own (which is all the loop engine looks at). Both instructions still run in full, the jump just
+    doesn't have to be dispatched on it's own. The `span` of the instruction grows to cover the jump, so a
+    write to either of them invalidates the fused instruction. Instructions are only fused if their span
+    would be at most `maxSpan` words.
+    */
+    if (instruction->handler <= GENERIC_HANDLER) return;
+
+    int opcode = instruction->opcode;
+    if (opcode != LESS_THAN && opcode != EQUALS && opcode != ADD) return;
+
+    DecodedInstruction jump;
+    decodeInstruction(program, address + instruction->length, &jump);
+    if (jump.opcode != JUMP_IF_TRUE && jump.opcode != JUMP_IF_FALSE) return;
+    if (jump.parameterModes[1] != IMMEDIATE || instruction->length + jump.length > maxSpan) return;
+
+    if (opcode == ADD) {
+        // The jump has to always be taken, so it doesn't depend on the sum at all.
+        if (jump.parameterModes[0] != IMMEDIATE || (jump.operands[0] != 0) != (jump.opcode == JUMP_IF_TRUE)) return;
+
+        instruction->handler = ADD_JUMP_HANDLERS + (instruction->handler - ADD_HANDLERS);
+    } else {
+        // The jump has to test the exact word the comparison stores it's result in.
+        bool storesRelative = instruction->parameterModes[2] == RELATIVE;
+        if (jump.parameterModes[0] == IMMEDIATE || (jump.parameterModes[0] == RELATIVE) != storesRelative) return;
+        if (jump.operands[0] != instruction->operands[2]) return;
+
+        int modes = instruction->handler - (opcode == LESS_THAN ? LESS_THAN_HANDLERS : EQUALS_HANDLERS);
+        if (opcode == LESS_THAN) {
+            instruction->handler = (jump.opcode == JUMP_IF_TRUE ? LESS_THAN_JUMP_IF_TRUE_HANDLERS : LESS_THAN_JUMP_IF_FALSE_HANDLERS) + modes;
+        } else {
+            instruction->handler = (jump.opcode == JUMP_IF_TRUE ? EQUALS_JUMP_IF_TRUE_HANDLERS : EQUALS_JUMP_IF_FALSE_HANDLERS) + modes;
+        }
+    }
+
+    instruction->span = instruction->length + jump.length;
+}
+
+DecodedInstruction* fetchInstruction(IntCodeProgram* program, DecodedInstruction* scratch) {
+    /*
+    Gets the decoded instruction the pointer is currently on, decoding it first if it isn't cached yet.
+
+    Instructions that cross a page boundary (or are outside of the allocated memory) aren't cached, those
+    get decoded into the given scratch instruction, which is what's returned.
+
+    The instruction pointer MUST be pointing at an opcode.
+    */
+    size_t offset = program->instructionPointer & INTCODE_PAGE_MASK;
+
+    if (program->instructionPointer >= program->memorySize) {
+        decodeInstruction(program, program->instructionPointer, scratch);
+        return scratch;
+    }
+
+    // Filling in the cache of a shared page is fine, every program sharing the page would decode the
+    // exact same instruction from it. The exception is the ZERO_PAGE, which is never written to, since it's
+    // shared by every program (on any thread).
+    IntCodePage* page = program->pages[program->instructionPointer >> INTCODE_PAGE_SHIFT];
+    DecodedInstruction* instruction = &page->decoded[offset];
+    if (instruction->length > 0) return instruction;
+
+    decodeInstruction(program, program->instructionPointer, scratch);
+    if (offset + scratch->length > INTCODE_PAGE_SIZE || page == &ZERO_PAGE) return scratch;
+
+    // Fused instructions are only cached, since they rely on being invalidated when the jump changes. They
+    // have to fit in the page too, otherwise the instruction is cached on it's own.
+    if (program->fuseInstructions) fuseInstruction(program, program->instructionPointer, scratch, INTCODE_PAGE_SIZE - offset);
+
+    page->hasDecoded = true;
+    for (size_t idx = offset; idx < offset + scratch->span; idx += 1) page->decodedWords[idx >> 6] |= 1ull << (idx & 63);
+    *instruction = *scratch;
+    return instruction;
+}
+
 int resolveNextInstruction(IntCodeProgram* program, ParameterMode* parameterModes, long long* parameters) {
     /*
     Resolves the instruction the pointer is currently on, getting the opcode and storing the mode-evaluated
@@ -321,51 +1323,391 @@ int resolveNextInstruction(IntCodeProgram* program, ParameterMode* parameterMode
 
     The instruction pointer MUST be pointing at an opcode to start.
     */
-    int opcode = getOpcode(program, parameterModes);
-    program->instructionPointer += 1;
+    DecodedInstruction scratch;
+    DecodedInstruction* instruction = fetchInstruction(program, &scratch);
+    int opcode = instruction->opcode;
+    PROFILE_INSTRUCTION(program, program->instructionPointer, instruction);
 
     for (int idx = 0; idx < INSTRUCTION_PARAMETER_LENGTHS[opcode]; idx += 1) {
+        parameterModes[idx] = instruction->parameterModes[idx];
+
         if (INSTRUCTION_OUTPUT_PARAMETER_INDEXES[opcode] == idx) {
             // Return the actual output index, since the opcode handles storing it.
             if (parameterModes[idx] == RELATIVE) {
-                parameters[idx] = program->relativeBase + program->memory[program->instructionPointer];
+                parameters[idx] = program->relativeBase + instruction->operands[idx];
             } else {
-                parameters[idx] = program->memory[program->instructionPointer];
+                parameters[idx] = instruction->operands[idx];
             }
 
         } else if (parameterModes[idx] == POSITION) {
-            parameters[idx] = program->memory[program->memory[program->instructionPointer]];
+            parameters[idx] = readMemory(program, instruction->operands[idx]);
         } else if (parameterModes[idx] == IMMEDIATE) {
-            parameters[idx] = program->memory[program->instructionPointer];
+            parameters[idx] = instruction->operands[idx];
         } else if (parameterModes[idx] == RELATIVE) {
-            parameters[idx] = program->memory[program->relativeBase + program->memory[program->instructionPointer]];
+            parameters[idx] = readMemory(program, program->relativeBase + instruction->operands[idx]);
         }
-
-        program->instructionPointer += 1;
     }
 
+    program->instructionPointer += instruction->length;
+
     return opcode;
 }
 
-// TODO: Make a sister getFromMemory function, which returns 0 if indexing outside of the currently
-// allocated memory.
-void storeInMemory(IntCodeProgram* program, size_t idx, long long value) {
+bool executeInstruction(IntCodeProgram* program) {
     /*
-    Stores the value in program memory at the given idx, allocating more memory if needed.
+    Executes the instruction the pointer is currently on, advancing the pointer to the next instruction
+    to run.
 
-    If the given idx is outside of the currently allocated memory, the memory space will double
-    until it's sufficiently large. All new memory is initialized to 0.
+    Returns false if the program stopped running, either because it halted, it's waiting on input, or
+    it's output channel is full, otherwise, returns true.
     */
-    if (idx >= program->memorySize) {
-        size_t originalMemorySize = program->memorySize;
-        // Allocate more memory, doubling it until it's greater than the necessary idx.
-        while (program->memorySize <= idx) program->memorySize *= 2;
-        program->memory = realloc(program->memory, program->memorySize * sizeof(long long));
 
-        for (size_t mIdx = originalMemorySize; mIdx < program->memorySize; mIdx += 1) program->memory[mIdx] = 0;
+    // Potential opcode parameters and the modes they were evaluated in.
+    ParameterMode parameterModes[MAX_OPCODE_PARAMETERS];
+    long long parameters[MAX_OPCODE_PARAMETERS];
+
+    // Resolve the next instruction - getting the opcode, storing the parameter values already evaluated
+    // as per their mode, and advancing the instruction pointer to the start of the next instruction.
+    int opcode = resolveNextInstruction(program, parameterModes, parameters);
+
+    if (opcode == ADD) {
+        storeInMemory(program, parameters[2], parameters[0] + parameters[1]);
+    } else if (opcode == MULTIPLY) {
+        storeInMemory(program, parameters[2], parameters[0] * parameters[1]);
+    } else if (opcode == STORE_INPUT) {
+        long long input;
+        if (!popLLongChannel(&program->input, &input)) {
+            // Waiting on input. Reset the pointer to the start of this instruction and return early. The
+            // next time the program is run it will resume from this instruction, potentially with new input.
+            program->instructionPointer -= 2;
+            PROFILE_BLOCKED(program, true);
+            return false;
+        }
+
+        storeInMemory(program, parameters[0], input);
+    } else if (opcode == OUTPUT) {
+        if (!pushLLongChannel(&program->output, parameters[0])) {
+            // The output is full, same as waiting on input, the program resumes from this instruction.
+            program->instructionPointer -= 2;
+            program->blockedOnOutput = true;
+            PROFILE_BLOCKED(program, false);
+            return false;
+        }
+    } else if (opcode == JUMP_IF_TRUE) {
+        if (parameters[0] != 0) program->instructionPointer = parameters[1];
+    } else if (opcode == JUMP_IF_FALSE) {
+        if (parameters[0] == 0) program->instructionPointer = parameters[1];
+    } else if (opcode == LESS_THAN) {
+        storeInMemory(program, parameters[2], parameters[0] < parameters[1] ? 1 : 0);
+    } else if (opcode == EQUALS) {
+        storeInMemory(program, parameters[2], parameters[0] == parameters[1] ? 1 : 0);
+    } else if (opcode == ADJUST_RELATIVE_BASE) {
+        program->relativeBase += parameters[0];
+    } else if (opcode == EXIT) {
+        // Immediately halt the program, and mark it as halted.
+        program->halted = true;
+        return false;
     }
 
-    program->memory[idx] = value;
+    return true;
+}
+
+void runLoopEngine(IntCodeProgram* program) {
+    /*
+    Runs the program one instruction at a time until it halts or waits on I/O.
+    */
+    while (executeInstruction(program));
+}
+
+#if defined(__GNUC__)
+
+// Reads memory straight out of the page table for the threaded engine, anything past it goes through
+// `readMemory`.
+#define READ_MEMORY(address)                                                                         \
+    ((size_t)(address) < memorySize ? pages[(size_t)(address) >> INTCODE_PAGE_SHIFT]->words[(size_t)(address) & INTCODE_PAGE_MASK] \
+                                    : readMemory(program, (address)))
+// Evaluates a parameter in the given mode, for the threaded engine.
+#define READ_PARAMETER(mode, operand) ((mode) == POSITION ? READ_MEMORY(operand) : (mode) == IMMEDIATE ? (operand) : READ_MEMORY(relativeBase + (operand)))
+// Evaluates an output parameter in the given mode (POSITION or RELATIVE) to the address to store to.
+#define WRITE_ADDRESS(mode, operand) ((mode) == RELATIVE ? relativeBase + (operand) : (operand))
+// Stores straight into the page when it's the program's own and the word isn't part of a cached
+// instruction (like a variable sitting right next to the code), otherwise lets `storeInMemory` handle it.
+// Storing can reallocate (or copy) pages, so the engine's view of memory has to be refreshed after.
+#define STORE(address, value)                                                                   \
+    do {                                                                                        \
+        size_t storeAddress = (address);                                                        \
+        IntCodePage* storePage = storeAddress < memorySize ? pages[storeAddress >> INTCODE_PAGE_SHIFT] : NULL; \
+        if (storePage != NULL && storePage->refCount == 1 && !isDecodedWord(storePage, storeAddress & INTCODE_PAGE_MASK)) { \
+            storePage->words[storeAddress & INTCODE_PAGE_MASK] = (value);                       \
+        } else {                                                                                \
+            storeInMemory(program, storeAddress, value);                                        \
+            pages = program->pages;                                                             \
+            memorySize = program->memorySize;                                                   \
+        }                                                                                       \
+    } while (0)
+// Reads a word straight out of it's page, for addresses known to be in the page table.
+#define READ_PAGE_WORD(address) (pages[(address) >> INTCODE_PAGE_SHIFT]->words[(address) & INTCODE_PAGE_MASK])
+// The cached instruction at an address, which might not be decoded yet.
+#define READ_DECODED(address) (pages[(address) >> INTCODE_PAGE_SHIFT]->decoded[(address) & INTCODE_PAGE_MASK])
+// Jumps straight to the handler of the instruction the pointer is on.
+#define DISPATCH()                                                                 \
+    do {                                                                           \
+        if (instructionPointer >= memorySize) goto decode;                         \
+        instruction = &READ_DECODED(instructionPointer);                           \
+        PROFILE_HANDLER();                                                         \
+        goto* handlers[instruction->handler];                                      \
+    } while (0)
+// Counts the instruction about to run when profiling. Instructions that still need decoding are counted
+// once they're decoded, and generic ones are counted by `executeInstruction`.
+#define PROFILE_HANDLER()                                                          \
+    do {                                                                           \
+        if (instruction->handler > GENERIC_HANDLER) PROFILE_INSTRUCTION(program, instructionPointer, instruction); \
+    } while (0)
+// Counts the jump at the address when profiling, which ran as part of a fused instruction.
+#ifdef INTCODE_PROFILE
+#define PROFILE_FUSED(address)                                                     \
+    do {                                                                           \
+        if (program->profile != NULL) {                                            \
+            DecodedInstruction fused;                                              \
+            decodeInstruction(program, (address), &fused);                         \
+            recordInstruction(program->profile, (address), &fused, false);         \
+        }                                                                          \
+    } while (0)
+#else
+#define PROFILE_FUSED(address) \
+    do {                       \
+    } while (0)
+#endif
+// Hands the engine's state back to the program, for when it stops running or runs a generic instruction.
+#define SAVE_STATE()                                          \
+    do {                                                      \
+        program->instructionPointer = instructionPointer;     \
+        program->relativeBase = relativeBase;                 \
+    } while (0)
+
+// clang-format off
+// The valid parameter mode combinations for each kind of instruction, only POSITION and RELATIVE for
+// output parameters.
+#define THREE_PARAMETER_MODES(X, NAME, EXPRESSION)                                              \
+    X(NAME, EXPRESSION, 0, 0, 0) X(NAME, EXPRESSION, 0, 0, 2) X(NAME, EXPRESSION, 0, 1, 0)      \
+    X(NAME, EXPRESSION, 0, 1, 2) X(NAME, EXPRESSION, 0, 2, 0) X(NAME, EXPRESSION, 0, 2, 2)      \
+    X(NAME, EXPRESSION, 1, 0, 0) X(NAME, EXPRESSION, 1, 0, 2) X(NAME, EXPRESSION, 1, 1, 0)      \
+    X(NAME, EXPRESSION, 1, 1, 2) X(NAME, EXPRESSION, 1, 2, 0) X(NAME, EXPRESSION, 1, 2, 2)      \
+    X(NAME, EXPRESSION, 2, 0, 0) X(NAME, EXPRESSION, 2, 0, 2) X(NAME, EXPRESSION, 2, 1, 0)      \
+    X(NAME, EXPRESSION, 2, 1, 2) X(NAME, EXPRESSION, 2, 2, 0) X(NAME, EXPRESSION, 2, 2, 2)
+#define TWO_PARAMETER_MODES(X, NAME, EXPRESSION)                                                \
+    X(NAME, EXPRESSION, 0, 0) X(NAME, EXPRESSION, 0, 1) X(NAME, EXPRESSION, 0, 2)               \
+    X(NAME, EXPRESSION, 1, 0) X(NAME, EXPRESSION, 1, 1) X(NAME, EXPRESSION, 1, 2)               \
+    X(NAME, EXPRESSION, 2, 0) X(NAME, EXPRESSION, 2, 1) X(NAME, EXPRESSION, 2, 2)
+#define ONE_PARAMETER_MODES(X, NAME, EXPRESSION)                                                \
+    X(NAME, EXPRESSION, 0) X(NAME, EXPRESSION, 1) X(NAME, EXPRESSION, 2)
+#define OUTPUT_PARAMETER_MODES(X, NAME, EXPRESSION)                                             \
+    X(NAME, EXPRESSION, 0) X(NAME, EXPRESSION, 2)
+// clang-format on
+
+// The addresses of the handlers, in the same order as the modes above.
+#define THREE_PARAMETER_LABEL(NAME, EXPRESSION, A, B, C) &&NAME##_##A##B##C,
+#define TWO_PARAMETER_LABEL(NAME, EXPRESSION, A, B) &&NAME##_##A##B,
+#define ONE_PARAMETER_LABEL(NAME, EXPRESSION, A) &&NAME##_##A,
+
+// ADD, MULTIPLY, LESS_THAN and EQUALS, storing the EXPRESSION of their first two parameters (`a` and `b`).
+#define STORE_EXPRESSION_HANDLER(NAME, EXPRESSION, A, B, C)                         \
+    NAME##_##A##B##C : {                                                            \
+        long long a = READ_PARAMETER(A, instruction->operands[0]);                  \
+        long long b = READ_PARAMETER(B, instruction->operands[1]);                  \
+        instructionPointer += 4;                                                    \
+        STORE(WRITE_ADDRESS(C, instruction->operands[2]), EXPRESSION);              \
+        DISPATCH();                                                                 \
+    }
+
+// JUMP_IF_TRUE and JUMP_IF_FALSE, jumping if the EXPRESSION of their first parameter (`a`) is true.
+#define JUMP_HANDLER(NAME, EXPRESSION, A, B)                                        \
+    NAME##_##A##B : {                                                               \
+        long long a = READ_PARAMETER(A, instruction->operands[0]);                  \
+        if (EXPRESSION)                                                             \
+            instructionPointer = READ_PARAMETER(B, instruction->operands[1]);       \
+        else                                                                        \
+            instructionPointer += 3;                                                \
+        DISPATCH();                                                                 \
+    }
+
+#define STORE_INPUT_HANDLER(NAME, EXPRESSION, A)                                    \
+    NAME##_##A : {                                                                  \
+        long long a;                                                                \
+        if (!popLLongChannel(&program->input, &a)) {                                \
+            /* Waiting on input, the program resumes from this instruction. */      \
+            SAVE_STATE();                                                           \
+            PROFILE_BLOCKED(program, true);                                         \
+            return;                                                                 \
+        }                                                                           \
+        instructionPointer += 2;                                                    \
+        STORE(WRITE_ADDRESS(A, instruction->operands[0]), a);                       \
+        DISPATCH();                                                                 \
+    }
+
+#define OUTPUT_HANDLER(NAME, EXPRESSION, A)                                         \
+    NAME##_##A : {                                                                  \
+        if (!pushLLongChannel(&program->output, READ_PARAMETER(A, instruction->operands[0]))) { \
+            /* The output is full, the program resumes from this instruction. */    \
+            SAVE_STATE();                                                           \
+            program->blockedOnOutput = true;                                        \
+            PROFILE_BLOCKED(program, false);                                        \
+            return;                                                                 \
+        }                                                                           \
+        instructionPointer += 2;                                                    \
+        DISPATCH();                                                                 \
+    }
+
+// Fused instructions (see `fuseInstruction`), storing the EXPRESSION of their first two parameters and then
+// jumping to the jump's target if the CONDITION on the `result` is true. Fused instructions are always in
+// the same cached page, so the target can be read straight out of it. If the store lands on the
+// instructions themselves, the jump might have changed, so it's left to run on it's own.
+#define STORE_JUMP_HANDLER(NAME, EXPRESSION, A, B, C, CONDITION)                    \
+    NAME##_##A##B##C : {                                                            \
+        long long a = READ_PARAMETER(A, instruction->operands[0]);                  \
+        long long b = READ_PARAMETER(B, instruction->operands[1]);                  \
+        long long result = EXPRESSION;                                              \
+        size_t resultAddress = WRITE_ADDRESS(C, instruction->operands[2]);          \
+        STORE(resultAddress, result);                                               \
+        if (resultAddress - instructionPointer < MAX_FUSED_LENGTH) {                \
+            instructionPointer += 4;                                                \
+            DISPATCH();                                                             \
+        }                                                                           \
+        PROFILE_FUSED(instructionPointer + 4);                                      \
+        if (CONDITION)                                                              \
+            instructionPointer = READ_PAGE_WORD(instructionPointer + 6);            \
+        else                                                                        \
+            instructionPointer += 7;                                                \
+        DISPATCH();                                                                 \
+    }
+#define STORE_JUMP_IF_TRUE_HANDLER(NAME, EXPRESSION, A, B, C) STORE_JUMP_HANDLER(NAME, EXPRESSION, A, B, C, result != 0)
+#define STORE_JUMP_IF_FALSE_HANDLER(NAME, EXPRESSION, A, B, C) STORE_JUMP_HANDLER(NAME, EXPRESSION, A, B, C, result == 0)
+#define STORE_JUMP_ALWAYS_HANDLER(NAME, EXPRESSION, A, B, C) STORE_JUMP_HANDLER(NAME, EXPRESSION, A, B, C, true)
+
+#define ADJUST_RELATIVE_BASE_HANDLER(NAME, EXPRESSION, A)                           \
+    NAME##_##A : {                                                                  \
+        relativeBase += READ_PARAMETER(A, instruction->operands[0]);                \
+        instructionPointer += 2;                                                    \
+        DISPATCH();                                                                 \
+    }
+
+void runThreadedEngine(IntCodeProgram* program) {
+    /*
+    Runs the program until it halts or waits on I/O, jumping directly from one instruction's handler
+    to the next's (a "threaded" interpreter).
+
+    Each handler is specialized for an opcode and a combination of parameter modes, so there's no
+    checking of opcodes or modes while running, just the one indirect jump per instruction. Since the
+    CPU predicts each of those jumps separately, common sequences of instructions get predicted well.
+
+    The handler of each instruction comes from the decoded instruction cache, instructions that aren't
+    cached (yet) go through the `decode` handler first. Anything unusual, like an unknown opcode, is
+    handed off to the loop engine's `executeInstruction` one instruction at a time.
+    */
+    static void* handlers[] = {
+        &&decode,
+        &&generic,
+        THREE_PARAMETER_MODES(THREE_PARAMETER_LABEL, add, _)
+        THREE_PARAMETER_MODES(THREE_PARAMETER_LABEL, multiply, _)
+        THREE_PARAMETER_MODES(THREE_PARAMETER_LABEL, lessThan, _)
+        THREE_PARAMETER_MODES(THREE_PARAMETER_LABEL, equals, _)
+        OUTPUT_PARAMETER_MODES(ONE_PARAMETER_LABEL, storeInput, _)
+        ONE_PARAMETER_MODES(ONE_PARAMETER_LABEL, output, _)
+        TWO_PARAMETER_MODES(TWO_PARAMETER_LABEL, jumpIfTrue, _)
+        TWO_PARAMETER_MODES(TWO_PARAMETER_LABEL, jumpIfFalse, _)
+        ONE_PARAMETER_MODES(ONE_PARAMETER_LABEL, adjustRelativeBase, _)
+        &&exit,
+        THREE_PARAMETER_MODES(THREE_PARAMETER_LABEL, lessThanJumpIfTrue, _)
+        THREE_PARAMETER_MODES(THREE_PARAMETER_LABEL, lessThanJumpIfFalse, _)
+        THREE_PARAMETER_MODES(THREE_PARAMETER_LABEL, equalsJumpIfTrue, _)
+        THREE_PARAMETER_MODES(THREE_PARAMETER_LABEL, equalsJumpIfFalse, _)
+        THREE_PARAMETER_MODES(THREE_PARAMETER_LABEL, addJump, _)
+    };
+
+    // The engine's working state, kept in locals so the compiler can keep them in registers.
+    size_t instructionPointer = program->instructionPointer;
+    size_t relativeBase = program->relativeBase;
+    size_t memorySize = program->memorySize;
+    IntCodePage** pages = program->pages;
+
+    DecodedInstruction scratch;
+    DecodedInstruction* instruction;
+
+    DISPATCH();
+
+decode:
+    // The instruction isn't cached, decode it (caching it if possible) and run it.
+    program->instructionPointer = instructionPointer;
+    instruction = fetchInstruction(program, &scratch);
+    PROFILE_HANDLER();
+    goto* handlers[instruction->handler];
+
+generic:
+    SAVE_STATE();
+    if (!executeInstruction(program)) return;
+    instructionPointer = program->instructionPointer;
+    relativeBase = program->relativeBase;
+    pages = program->pages;
+    memorySize = program->memorySize;
+    DISPATCH();
+
+    THREE_PARAMETER_MODES(STORE_EXPRESSION_HANDLER, add, a + b)
+    THREE_PARAMETER_MODES(STORE_EXPRESSION_HANDLER, multiply, a * b)
+    THREE_PARAMETER_MODES(STORE_EXPRESSION_HANDLER, lessThan, a < b ? 1 : 0)
+    THREE_PARAMETER_MODES(STORE_EXPRESSION_HANDLER, equals, a == b ? 1 : 0)
+    OUTPUT_PARAMETER_MODES(STORE_INPUT_HANDLER, storeInput, _)
+    ONE_PARAMETER_MODES(OUTPUT_HANDLER, output, _)
+    TWO_PARAMETER_MODES(JUMP_HANDLER, jumpIfTrue, a != 0)
+    TWO_PARAMETER_MODES(JUMP_HANDLER, jumpIfFalse, a == 0)
+    ONE_PARAMETER_MODES(ADJUST_RELATIVE_BASE_HANDLER, adjustRelativeBase, _)
+    THREE_PARAMETER_MODES(STORE_JUMP_IF_TRUE_HANDLER, lessThanJumpIfTrue, a < b ? 1 : 0)
+    THREE_PARAMETER_MODES(STORE_JUMP_IF_FALSE_HANDLER, lessThanJumpIfFalse, a < b ? 1 : 0)
+    THREE_PARAMETER_MODES(STORE_JUMP_IF_TRUE_HANDLER, equalsJumpIfTrue, a == b ? 1 : 0)
+    THREE_PARAMETER_MODES(STORE_JUMP_IF_FALSE_HANDLER, equalsJumpIfFalse, a == b ? 1 : 0)
+    THREE_PARAMETER_MODES(STORE_JUMP_ALWAYS_HANDLER, addJump, a + b)
+
+exit:
+    // Immediately halt the program, and mark it as halted.
+    instructionPointer += 1;
+    SAVE_STATE();
+    program->halted = true;
+}
+
+#endif
+
+void resetIntCodeProgram(IntCodeProgram* program) {
+    /*
+    Resets the program to run from the beginning, copying the program into memory and overriding any
+    previous memory the program may have. The input buffer is left alone.
+    */
+    // Copy the program into memory. Storing only touches words that actually change, so cached
+    // instructions are kept across runs unless the (possibly modified) source code changed them.
+    for (size_t idx = 0; idx < program->programSize; idx += 1) storeInMemory(program, idx, program->program[idx]);
+
+    // Reset the remaining memory to 0, the rest of the page the program ends in word by word, and then
+    // whole pages at a time.
+    size_t firstClearPage = (program->programSize + INTCODE_PAGE_SIZE - 1) >> INTCODE_PAGE_SHIFT;
+    size_t firstClearIdx = firstClearPage << INTCODE_PAGE_SHIFT;
+    for (size_t idx = program->programSize; idx < firstClearIdx && idx < program->memorySize; idx += 1) storeInMemory(program, idx, 0);
+    for (size_t pageIdx = firstClearPage; pageIdx < program->numPages; pageIdx += 1) clearPage(program, &program->pages[pageIdx]);
+
+    // Sparse pages are rare, drop them entirely.
+    for (size_t slotIdx = 0; slotIdx < program->sparsePagesSize; slotIdx += 1) {
+        IntCodePage* page = program->sparsePages[slotIdx].page;
+        if (page == NULL) continue;
+
+        if (page != &ZERO_PAGE) program->residentPages -= 1;
+        releasePage(page);
+        program->sparsePages[slotIdx].page = NULL;
+    }
+    program->numSparsePages = 0;
+    program->peakResidentPages = program->residentPages;
+
+    // Reset pointers and output.
+    clearLLongChannel(&program->output);
+    program->instructionPointer = 0;
+    program->halted = false;
+    program->relativeBase = 0;
 }
 
 void intcodeRun(IntCodeProgram* program) {
@@ -379,111 +1721,286 @@ void intcodeRun(IntCodeProgram* program) {
     // If the program to run has halted, reset it to run from the beginning, otherwise, the program
     // will be run from the instruction pointer it left off at.
     if (program->halted) {
-        // Copy the program into memory.
-        for (size_t idx = 0; idx < program->programSize; idx += 1) program->memory[idx] = program->program[idx];
-        // Reset the remaining memory to 0.
-        for (size_t idx = program->programSize; idx < program->memorySize; idx += 1) program->memory[idx] = 0;
+        resetIntCodeProgram(program);
+        PROFILE_RUN(program);
+    }
+    program->blockedOnOutput = false;
 
-        // Reset pointers and output.
-        program->output.numItems = 0;
-        program->instructionPointer = 0;
-        program->halted = false;
-        program->relativeBase = 0;
+#if defined(__GNUC__)
+    if (program->engine == THREADED_ENGINE) {
+        runThreadedEngine(program);
+        return;
     }
+#endif
 
-    // The opcode being processed.
-    int opcode;
-    // Potential opcode parameters and the modes they were evaluated in.
-    ParameterMode parameterModes[MAX_OPCODE_PARAMETERS];
-    long long parameters[MAX_OPCODE_PARAMETERS];
-    // The instructionPointer should never be negative for a valid intcode program. This may as well be `while(true)`.
-    while (program->instructionPointer >= 0) {
-        // Resolve the next instruction - getting the opcode, storing the parameter values already evaluated
-        // as per their mode, and advancing the instruction pointer to the start of the next instruction.
-        opcode = resolveNextInstruction(program, parameterModes, parameters);
-
-        if (opcode == ADD) {
-            storeInMemory(program, parameters[2], parameters[0] + parameters[1]);
-        } else if (opcode == MULTIPLY) {
-            storeInMemory(program, parameters[2], parameters[0] * parameters[1]);
-        } else if (opcode == STORE_INPUT) {
-            if (program->inputPointer >= program->input.numItems) {
-                // Waiting on input. Reset the pointer to the start of this instruction and return early. The
-                // next time the program is run it will resume from this instruction, potentially with new input.
-                program->instructionPointer -= 2;
-                return;
+    runLoopEngine(program);
+}
+
+// ================================ Images ================================
+
+/*
+Intcode programs can be converted into binary images, which load without any parsing, and are memory mapped
+rather than copied, so every program loaded from the same image shares the one copy of the source code.
+
+The image is all little-endian:
+
+    Offset  Size                  Contents
+    0       4                     INTCODE_IMAGE_MAGIC
+    4       4                     INTCODE_IMAGE_VERSION
+    8       8                     The number of words in the program, N.
+    16      8                     The number of pre-decoded instructions, M (0 if there's none).
+    24      8 * N                 The words of the program.
+    24+8*N  8 * M                 The addresses of the pre-decoded instructions.
+
+The pre-decoded instructions are the instructions found ahead of time by `findIntCodeInstructions`, which
+get decoded (and cached) as soon as the image is loaded, instead of on their first run.
+*/
+#define INTCODE_IMAGE_MAGIC "INTC"
+#define INTCODE_IMAGE_VERSION 1
+#define INTCODE_IMAGE_HEADER_SIZE 24
+
+bool isLittleEndian() {
+    // If this machine stores numbers little-endian, the same as images.
+    uint16_t one = 1;
+    return *(uint8_t*)&one == 1;
+}
+
+uint64_t readLittleEndian64(unsigned char* bytes) {
+    uint64_t value = 0;
+    for (int idx = 7; idx >= 0; idx -= 1) value = (value << 8) | bytes[idx];
+    return value;
+}
+
+void writeLittleEndian64(FILE* file, uint64_t value) {
+    unsigned char bytes[8];
+    for (int idx = 0; idx < 8; idx += 1) bytes[idx] = (value >> (idx * 8)) & 0xFF;
+    fwrite(bytes, 1, 8, file);
+}
+
+void findIntCodeInstructions(IntCodeProgram* program, LLongArray* addresses) {
+    /*
+    Finds the addresses of the instructions in the program that are definitely reachable from the start,
+    following every branch that can be taken (in order of address).
+
+    Only jumps to IMMEDIATE targets can be followed, so code only reached through computed jumps (like
+    returning from a function) isn't found. Either way, those are decoded when they're first run.
+    */
+    bool* seen = calloc(program->programSize, sizeof(bool));
+    LLongArray toVisit;
+    initLLongArray(&toVisit, 64);
+    insertLLongArray(&toVisit, 0);
+
+    DecodedInstruction instruction;
+    while (toVisit.numItems > 0) {
+        size_t address = toVisit.data[toVisit.numItems - 1];
+        toVisit.numItems -= 1;
+
+        // Keep walking straight through the code until it ends, or runs into code that's been seen already.
+        while (address < program->programSize && !seen[address]) {
+            decodeInstruction(program, address, &instruction);
+            if (instruction.handler <= GENERIC_HANDLER || address + instruction.length > program->programSize) break;
+            seen[address] = true;
+
+            int opcode = instruction.opcode;
+            if (opcode == EXIT) break;
+
+            if (opcode == JUMP_IF_TRUE || opcode == JUMP_IF_FALSE) {
+                if (instruction.parameterModes[1] == IMMEDIATE) insertLLongArray(&toVisit, instruction.operands[1]);
+
+                // A jump with an IMMEDIATE test either always jumps, or never does.
+                bool alwaysJumps = instruction.parameterModes[0] == IMMEDIATE && (instruction.operands[0] != 0) == (opcode == JUMP_IF_TRUE);
+                if (alwaysJumps) break;
             }
 
-            storeInMemory(program, parameters[0], program->input.data[program->inputPointer]);
-            program->inputPointer += 1;
-        } else if (opcode == OUTPUT) {
-            insertLLongArray(&program->output, parameters[0]);
-        } else if (opcode == JUMP_IF_TRUE) {
-            if (parameters[0] != 0) program->instructionPointer = parameters[1];
-        } else if (opcode == JUMP_IF_FALSE) {
-            if (parameters[0] == 0) program->instructionPointer = parameters[1];
-        } else if (opcode == LESS_THAN) {
-            storeInMemory(program, parameters[2], parameters[0] < parameters[1] ? 1 : 0);
-        } else if (opcode == EQUALS) {
-            storeInMemory(program, parameters[2], parameters[0] == parameters[1] ? 1 : 0);
-        } else if (opcode == ADJUST_RELATIVE_BASE) {
-            program->relativeBase += parameters[0];
-        } else if (opcode == EXIT) {
-            // Immediately halt the program, and mark it as halted.
-            program->halted = true;
-            return;
+            address += instruction.length;
         }
     }
+
+    for (size_t address = 0; address < program->programSize; address += 1) {
+        if (seen[address]) insertLLongArray(addresses, address);
+    }
+
+    freeLLongArray(&toVisit);
+    free(seen);
+}
+
+bool writeIntCodeImage(IntCodeProgram* program, char* imagePath, bool preDecode) {
+    /*
+    Writes the program's source code to a binary image at the given path, along with the instructions to
+    pre-decode when it's loaded, if `preDecode` is set.
+
+    Returns false if the image couldn't be written, otherwise, returns true.
+    */
+    FILE* imageFile = fopen(imagePath, "wb");
+    if (imageFile == NULL) return false;
+
+    LLongArray instructions;
+    initLLongArray(&instructions, 64);
+    if (preDecode) findIntCodeInstructions(program, &instructions);
+
+    fwrite(INTCODE_IMAGE_MAGIC, 1, 4, imageFile);
+    unsigned char version[4] = {INTCODE_IMAGE_VERSION, 0, 0, 0};
+    fwrite(version, 1, 4, imageFile);
+    writeLittleEndian64(imageFile, program->programSize);
+    writeLittleEndian64(imageFile, instructions.numItems);
+
+    for (size_t idx = 0; idx < program->programSize; idx += 1) writeLittleEndian64(imageFile, program->program[idx]);
+    for (size_t idx = 0; idx < instructions.numItems; idx += 1) writeLittleEndian64(imageFile, instructions.data[idx]);
+
+    freeLLongArray(&instructions);
+    return fclose(imageFile) == 0;
+}
+
+bool initIntCodeProgramFromImage(IntCodeProgram* program, char* imagePath) {
+    /*
+    Initializes an intcode program from a binary image written by `writeIntCodeImage`. The image is memory
+    mapped, and the program's source code points straight into it, so it's shared (by the OS) with every
+    other program loaded from the same image, even in other processes.
+
+    The mapping is private, so changing the source code (i.e., `program->program[0] = 2`) only changes it
+    for this program and it's forks, same as usual.
+
+    Returns false (and leaves the program uninitialized) if the image couldn't be read or isn't a valid
+    image, otherwise, returns true.
+    */
+    int imageFd = open(imagePath, O_RDONLY);
+    if (imageFd == -1) return false;
+
+    struct stat imageStat;
+    if (fstat(imageFd, &imageStat) == -1 || imageStat.st_size < INTCODE_IMAGE_HEADER_SIZE) {
+        close(imageFd);
+        return false;
+    }
+
+    size_t imageSize = imageStat.st_size;
+    unsigned char* image = mmap(NULL, imageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, imageFd, 0);
+    // The mapping stays valid once the file is closed.
+    close(imageFd);
+    if (image == MAP_FAILED) return false;
+
+    uint64_t numWords = readLittleEndian64(image + 8);
+    uint64_t numInstructions = readLittleEndian64(image + 16);
+    bool valid = memcmp(image, INTCODE_IMAGE_MAGIC, 4) == 0 && image[4] == INTCODE_IMAGE_VERSION;
+    valid = valid && numWords <= (imageSize - INTCODE_IMAGE_HEADER_SIZE) / 8;
+    valid = valid && numInstructions <= (imageSize - INTCODE_IMAGE_HEADER_SIZE) / 8 - numWords;
+    if (!valid) {
+        munmap(image, imageSize);
+        return false;
+    }
+
+    program->programSize = numWords;
+    unsigned char* instructions = image + INTCODE_IMAGE_HEADER_SIZE + numWords * 8;
+
+    if (isLittleEndian()) {
+        program->program = (long long*)(image + INTCODE_IMAGE_HEADER_SIZE);
+        program->image = image;
+        program->imageSize = imageSize;
+    } else {
+        // The words have to be byte swapped, so there's no sharing them.
+        program->program = malloc(numWords * sizeof(long long));
+        for (size_t idx = 0; idx < numWords; idx += 1) program->program[idx] = readLittleEndian64(image + INTCODE_IMAGE_HEADER_SIZE + idx * 8);
+        program->image = NULL;
+        program->imageSize = 0;
+    }
+
+    initIntCodeProgramState(program);
+
+    // Decode the instructions found ahead of time into the cache. The program was just loaded into memory,
+    // so the pages are the program's own.
+    DecodedInstruction scratch;
+    for (uint64_t idx = 0; idx < numInstructions; idx += 1) {
+        program->instructionPointer = readLittleEndian64(instructions + idx * 8);
+        if (program->instructionPointer < program->programSize) fetchInstruction(program, &scratch);
+    }
+    program->instructionPointer = 0;
+
+    if (program->image == NULL) munmap(image, imageSize);
+    return true;
 }
 
 // ================================ I/O ================================
 
-void pushInput(IntCodeProgram* program, long long input) {
+bool pushInput(IntCodeProgram* program, long long input) {
     /*
-    Pushes the given input to the top of the input buffer.
+    Pushes the given input to the back of the input channel.
+
+    Returns false if the input channel is full, otherwise, returns true.
     */
-    insertLLongArray(&program->input, input);
+    return pushLLongChannel(&program->input, input);
 }
 
-void pushInputASCII(IntCodeProgram* program, char* asciiInput) {
+size_t pushInputs(IntCodeProgram* program, long long* inputs, size_t numInputs) {
+    /*
+    Pushes the inputs to the back of the input channel, in order, returning the number that fit.
+    */
+    return pushManyLLongChannel(&program->input, inputs, numInputs);
+}
+
+bool pushInputASCII(IntCodeProgram* program, char* asciiInput) {
     /*
     Pushes the string output as int ASCII codes to the program, ended with
     the newline code.
+
+    Returns false if the input channel filled up before the whole string was pushed, otherwise, returns true.
     */
     while (*asciiInput) {
-        pushInput(program, (int)asciiInput[0]);
+        if (!pushInput(program, (int)asciiInput[0])) return false;
         asciiInput += 1;
     }
 
-    pushInput(program, (int)'\n');
+    return pushInput(program, (int)'\n');
 }
 
 bool popOutput(IntCodeProgram* program, long long* outputDest) {
     /*
-    Pops the output from the buffer (in effect removing it), storing it in the
+    Pops the oldest output from the output channel (in effect removing it), storing it in the
     output destination.
 
     Returns false if there's no output, otherwise, returns true.
     */
-    if (program->output.numItems == 0) return false;
+    return popLLongChannel(&program->output, outputDest);
+}
+
+size_t popOutputs(IntCodeProgram* program, long long* outputDest, size_t maxOutputs) {
+    /*
+    Pops up to `maxOutputs` of the oldest outputs into the output destination, in order, returning the
+    number popped.
+    */
+    return popManyLLongChannel(&program->output, outputDest, maxOutputs);
+}
 
-    *outputDest = program->output.data[program->output.numItems - 1];
+long long* peekOutput(IntCodeProgram* program, size_t* numOutputs) {
+    /*
+    Peeks at the oldest outputs without copying or popping them, see `peekLLongChannel`. Use `dropOutput`
+    once done with them.
+    */
+    return peekLLongChannel(&program->output, numOutputs);
+}
 
-    program->output.numItems -= 1;
-    return true;
+void dropOutput(IntCodeProgram* program, size_t numOutputs) {
+    /*
+    Drops the oldest outputs, i.e., after peeking at them.
+    */
+    dropLLongChannel(&program->output, numOutputs);
+}
+
+size_t countOutput(IntCodeProgram* program) {
+    // The number of outputs waiting to be popped.
+    return countLLongChannel(&program->output);
 }
 
 void clearInput(IntCodeProgram* program) {
     /*
-    Clears the input buffer.
+    Clears the input channel.
     */
-    program->input.numItems = 0;
-    program->inputPointer = 0;
+    clearLLongChannel(&program->input);
 }
 
 void clearOutput(IntCodeProgram* program) {
     /*
-    Clears the output buffer.
+    Clears the output channel.
     */
-    program->output.numItems = 0;
+    clearLLongChannel(&program->output);
 }
+
+#endif
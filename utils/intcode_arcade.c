@@ -0,0 +1,273 @@
+/*
+A headless runner for the arcade cabinet (2019/13), an Intcode program that draws a breakout game.
+
+The cabinet draws by outputting tiles as (x, y, tile id) triples, or the score as (-1, 0, score). After the
+first frame, it only draws the tiles that changed. Those deltas are applied to a compact grid of tiles (a
+byte per tile), and the ball, paddle, score and number of blocks left are kept up to date as they're drawn,
+so nothing ever has to scan the grid. A frame ends whenever the cabinet waits on the joystick.
+
+Every `checkpointInterval` frames, the whole cabinet (program and screen) is checkpointed, replacing the
+last checkpoint, so it can be rewound to it with `restoreIntCodeArcade`. Memory stays bounded no matter
+how long the game runs: the grid, a single checkpoint, and the program's (copy-on-write) pages.
+
+To play the game to the end, following the ball with the paddle:
+
+IntCodeArcade arcade;
+initIntCodeArcade(&arcade, &program, ARCADE_CHECKPOINT_INTERVAL);
+
+while (runIntCodeArcadeFrame(&arcade)) moveIntCodeJoystick(&arcade, followBall(&arcade));
+
+printf("%lld\n", arcade.screen.score);
+freeIntCodeArcade(&arcade);
+*/
+
+#ifndef intcode_arcade_c
+#define intcode_arcade_c
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "intcode.c"
+
+// ================================ Constants ================================
+
+#define ARCADE_EMPTY 0
+#define ARCADE_WALL 1
+#define ARCADE_BLOCK 2
+#define ARCADE_PADDLE 3
+#define ARCADE_BALL 4
+
+// The default number of frames between checkpoints.
+#define ARCADE_CHECKPOINT_INTERVAL 1024
+
+// ================================ Structs ================================
+
+/*
+What's on the cabinet's screen.
+
+- tiles: The tile id of every tile, a row at a time, `capacityWidth` tiles wide and `capacityHeight` tiles
+  tall. The grid grows by doubling, so it's usually bigger than what's been drawn.
+- width, height: The size of the screen as drawn, up to the furthest tile drawn in each direction.
+- ballX, ballY, paddleX, paddleY: Where the ball and paddle were last drawn.
+- score: The last score drawn.
+- numBlocks: The number of block tiles on the screen.
+- numFrames: The number of frames drawn so far.
+*/
+typedef struct {
+    unsigned char* tiles;
+    int capacityWidth;
+    int capacityHeight;
+    int width;
+    int height;
+
+    int ballX;
+    int ballY;
+    int paddleX;
+    int paddleY;
+
+    long long score;
+    int numBlocks;
+    size_t numFrames;
+} ArcadeScreen;
+
+/*
+An arcade cabinet, running the program (which is still owned by the caller).
+
+- checkpointInterval: The number of frames between checkpoints, 0 for none.
+- checkpoint, checkpointScreen: The program and screen at the last checkpoint, if `hasCheckpoint` is set.
+*/
+typedef struct {
+    IntCodeProgram* program;
+    ArcadeScreen screen;
+
+    size_t checkpointInterval;
+    bool hasCheckpoint;
+    IntCodeProgram checkpoint;
+    ArcadeScreen checkpointScreen;
+} IntCodeArcade;
+
+// ================================ Utilities ================================
+
+void initArcadeScreen(ArcadeScreen* screen) {
+    screen->tiles = NULL;
+    screen->capacityWidth = 0;
+    screen->capacityHeight = 0;
+    screen->width = 0;
+    screen->height = 0;
+
+    screen->ballX = 0;
+    screen->ballY = 0;
+    screen->paddleX = 0;
+    screen->paddleY = 0;
+
+    screen->score = 0;
+    screen->numBlocks = 0;
+    screen->numFrames = 0;
+}
+
+void copyArcadeScreen(ArcadeScreen* screen, ArcadeScreen* copy) {
+    /*
+    Copies the screen over the copy, reusing the copy's tiles if they're the same size.
+    */
+    int numTiles = screen->capacityWidth * screen->capacityHeight;
+    unsigned char* tiles = copy->tiles;
+    if (tiles == NULL || copy->capacityWidth != screen->capacityWidth || copy->capacityHeight != screen->capacityHeight) {
+        free(tiles);
+        tiles = malloc(numTiles > 0 ? numTiles : 1);
+    }
+
+    *copy = *screen;
+    copy->tiles = tiles;
+    memcpy(copy->tiles, screen->tiles, numTiles);
+}
+
+void initIntCodeArcade(IntCodeArcade* arcade, IntCodeProgram* program, size_t checkpointInterval) {
+    arcade->program = program;
+    initArcadeScreen(&arcade->screen);
+
+    arcade->checkpointInterval = checkpointInterval;
+    arcade->hasCheckpoint = false;
+    initArcadeScreen(&arcade->checkpointScreen);
+}
+
+void freeIntCodeArcade(IntCodeArcade* arcade) {
+    /*
+    Frees the screen and checkpoint, but not the program.
+    */
+    free(arcade->screen.tiles);
+    initArcadeScreen(&arcade->screen);
+
+    if (arcade->hasCheckpoint) freeIntCodeProgram(&arcade->checkpoint);
+    arcade->hasCheckpoint = false;
+    free(arcade->checkpointScreen.tiles);
+    initArcadeScreen(&arcade->checkpointScreen);
+}
+
+// ================================ Drawing ================================
+
+void growArcadeScreen(ArcadeScreen* screen, int width, int height) {
+    /*
+    Grows the screen to fit at least `width` x `height` tiles, at least doubling it so it doesn't have to
+    grow often. New tiles are empty.
+    */
+    int newWidth = screen->capacityWidth, newHeight = screen->capacityHeight;
+    if (width > newWidth) newWidth = width > newWidth * 2 ? width : newWidth * 2;
+    if (height > newHeight) newHeight = height > newHeight * 2 ? height : newHeight * 2;
+
+    unsigned char* tiles = calloc(newWidth * newHeight, 1);
+    for (int y = 0; y < screen->capacityHeight; y += 1) {
+        memcpy(tiles + y * newWidth, screen->tiles + y * screen->capacityWidth, screen->capacityWidth);
+    }
+
+    free(screen->tiles);
+    screen->tiles = tiles;
+    screen->capacityWidth = newWidth;
+    screen->capacityHeight = newHeight;
+}
+
+unsigned char getArcadeTile(ArcadeScreen* screen, int x, int y) {
+    /*
+    Returns the tile id at (x, y), which has to be on the screen as drawn.
+    */
+    return screen->tiles[y * screen->capacityWidth + x];
+}
+
+void drawArcadeTile(ArcadeScreen* screen, long long x, long long y, long long tile) {
+    /*
+    Applies a single drawn tile (or score) to the screen.
+    */
+    if (x == -1 && y == 0) {
+        screen->score = tile;
+        return;
+    }
+    if (x < 0 || y < 0) return;
+
+    if (x >= screen->capacityWidth || y >= screen->capacityHeight) growArcadeScreen(screen, x + 1, y + 1);
+    if (x >= screen->width) screen->width = x + 1;
+    if (y >= screen->height) screen->height = y + 1;
+
+    unsigned char* current = &screen->tiles[y * screen->capacityWidth + x];
+    if (*current == ARCADE_BLOCK) screen->numBlocks -= 1;
+    if (tile == ARCADE_BLOCK) screen->numBlocks += 1;
+    *current = (unsigned char)tile;
+
+    if (tile == ARCADE_BALL) {
+        screen->ballX = x;
+        screen->ballY = y;
+    } else if (tile == ARCADE_PADDLE) {
+        screen->paddleX = x;
+        screen->paddleY = y;
+    }
+}
+
+// ================================ Running ================================
+
+void checkpointIntCodeArcade(IntCodeArcade* arcade) {
+    /*
+    Checkpoints the program and screen, replacing the last checkpoint.
+    */
+    if (arcade->hasCheckpoint) freeIntCodeProgram(&arcade->checkpoint);
+    snapshotIntCodeProgram(arcade->program, &arcade->checkpoint);
+    copyArcadeScreen(&arcade->screen, &arcade->checkpointScreen);
+    arcade->hasCheckpoint = true;
+}
+
+bool restoreIntCodeArcade(IntCodeArcade* arcade) {
+    /*
+    Rewinds the cabinet back to the last checkpoint. Returns false if there isn't one, otherwise, returns
+    true.
+    */
+    if (!arcade->hasCheckpoint) return false;
+
+    restoreIntCodeProgram(arcade->program, &arcade->checkpoint);
+    copyArcadeScreen(&arcade->checkpointScreen, &arcade->screen);
+    return true;
+}
+
+bool runIntCodeArcadeFrame(IntCodeArcade* arcade) {
+    /*
+    Runs the cabinet until it's done drawing the next frame, and is waiting on the joystick, applying
+    everything it draws to the screen as it goes. Checkpoints the cabinet after every `checkpointInterval`
+    frames.
+
+    Returns false if the game's over (the program halted), otherwise, returns true.
+    */
+    IntCodeProgram* program = arcade->program;
+    ArcadeScreen* screen = &arcade->screen;
+
+    // Keep running while the output fills up, a tile that's only partially drawn is left for the next run.
+    long long tile[3];
+    do {
+        intcodeRun(program);
+        while (countOutput(program) >= 3) {
+            popOutputs(program, tile, 3);
+            drawArcadeTile(screen, tile[0], tile[1], tile[2]);
+        }
+    } while (program->blockedOnOutput);
+
+    if (program->halted) return false;
+
+    screen->numFrames += 1;
+    if (arcade->checkpointInterval > 0 && screen->numFrames % arcade->checkpointInterval == 0) checkpointIntCodeArcade(arcade);
+    return true;
+}
+
+void moveIntCodeJoystick(IntCodeArcade* arcade, int direction) {
+    /*
+    Tilts the joystick for the next frame, -1 for left, 0 for neutral, and 1 for right.
+    */
+    pushInput(arcade->program, direction);
+}
+
+int followBall(IntCodeArcade* arcade) {
+    /*
+    Returns the joystick direction that moves the paddle towards the ball.
+    */
+    ArcadeScreen* screen = &arcade->screen;
+    if (screen->ballX > screen->paddleX) return 1;
+    if (screen->ballX < screen->paddleX) return -1;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,263 @@
+/*
+Line-by-line ASCII I/O for Intcode programs that talk in text (like 2019/17, 2019/21 and 2019/25).
+
+Output is read a line at a time into a char buffer that's reused for every line, straight out of the
+program's output channel, running the program whenever it needs more. Input is written a line at a time,
+and is held onto until the program has room for it in it's input channel, so any amount of input can be
+written up front. Neither side grows with how long the program runs, only with the longest line.
+
+Any output that isn't ASCII (like the answer at the end of a springdroid run) is kept in `value`.
+
+To write a couple of lines, and print every line the program outputs:
+
+IntCodeASCII ascii;
+initIntCodeASCII(&ascii, &program);
+
+writeIntCodeLine(&ascii, "NOT A J");
+writeIntCodeLine(&ascii, "WALK");
+
+char* line;
+while (readIntCodeLine(&ascii, &line)) printf("%s\n", line);
+
+if (ascii.hasValue) printf("%lld\n", ascii.value);
+freeIntCodeASCII(&ascii);
+
+Or set `onLine` and call `runIntCodeASCII`, to handle every line as it comes in.
+*/
+
+#ifndef intcode_ascii_c
+#define intcode_ascii_c
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "intcode.c"
+
+// ================================ Structs ================================
+
+typedef struct IntCodeASCII IntCodeASCII;
+
+/*
+Called with every complete line the program outputs (without the newline). The line is only valid until
+the next line is read.
+*/
+typedef void (*IntCodeLineHandler)(IntCodeASCII* ascii, char* line);
+
+/*
+A text interface to an Intcode program.
+
+Output:
+- line: The line being read, reused for every line. It's `lineLength` chars long, and always null
+  terminated. `lineComplete` is set once the whole line has been read.
+- value: The last output that wasn't ASCII, if `hasValue` is set.
+- onLine: Called for every line by `runIntCodeASCII`.
+- context: Anything the line handler needs to keep track of.
+
+Input:
+- input: Lines written that haven't fit in the program's input channel yet, from `inputStart` to
+  `inputLength`.
+
+Running:
+- waiting: True when the program is waiting on input, false before it's first run.
+- finished: True once the program has halted. Programs start off halted before they're first run, so the
+  program's own flag can't tell the two apart.
+*/
+struct IntCodeASCII {
+    IntCodeProgram* program;
+
+    char* line;
+    size_t lineLength;
+    size_t lineSize;
+    bool lineComplete;
+
+    long long value;
+    bool hasValue;
+
+    IntCodeLineHandler onLine;
+    void* context;
+
+    char* input;
+    size_t inputStart;
+    size_t inputLength;
+    size_t inputSize;
+
+    bool waiting;
+    bool finished;
+};
+
+// ================================ Utilities ================================
+
+void initIntCodeASCII(IntCodeASCII* ascii, IntCodeProgram* program) {
+    /*
+    Initializes a text interface to the program. The program is still owned (and should be freed) by the
+    caller.
+    */
+    ascii->program = program;
+
+    ascii->lineSize = 128;
+    ascii->line = malloc(ascii->lineSize);
+    ascii->line[0] = '\0';
+    ascii->lineLength = 0;
+    ascii->lineComplete = false;
+
+    ascii->value = 0;
+    ascii->hasValue = false;
+
+    ascii->onLine = NULL;
+    ascii->context = NULL;
+
+    ascii->inputSize = 128;
+    ascii->input = malloc(ascii->inputSize);
+    ascii->inputStart = 0;
+    ascii->inputLength = 0;
+
+    ascii->waiting = false;
+    ascii->finished = false;
+}
+
+void freeIntCodeASCII(IntCodeASCII* ascii) {
+    /*
+    Frees all memory associated with the interface, but not the program.
+    */
+    free(ascii->line);
+    ascii->line = NULL;
+    ascii->lineLength = 0;
+    ascii->lineSize = 0;
+
+    free(ascii->input);
+    ascii->input = NULL;
+    ascii->inputLength = 0;
+    ascii->inputSize = 0;
+}
+
+void writeIntCodeLine(IntCodeASCII* ascii, char* line) {
+    /*
+    Writes the line to the program's input, followed by a newline. It's sent to the program as it makes room
+    for it, the next time the program's run.
+    */
+    size_t length = strlen(line);
+
+    // Slide any input still waiting back to the start of the buffer before growing it.
+    if (ascii->inputStart > 0) {
+        memmove(ascii->input, ascii->input + ascii->inputStart, ascii->inputLength - ascii->inputStart);
+        ascii->inputLength -= ascii->inputStart;
+        ascii->inputStart = 0;
+    }
+
+    while (ascii->inputLength + length + 1 > ascii->inputSize) {
+        ascii->inputSize *= 2;
+        ascii->input = realloc(ascii->input, ascii->inputSize);
+    }
+
+    memcpy(ascii->input + ascii->inputLength, line, length);
+    ascii->input[ascii->inputLength + length] = '\n';
+    ascii->inputLength += length + 1;
+}
+
+// ================================ Running ================================
+
+void sendIntCodeInput(IntCodeASCII* ascii) {
+    /*
+    Sends as much of the written input to the program as fits in it's input channel.
+    */
+    while (ascii->inputStart < ascii->inputLength && pushInput(ascii->program, ascii->input[ascii->inputStart])) ascii->inputStart += 1;
+
+    if (ascii->inputStart == ascii->inputLength) {
+        ascii->inputStart = 0;
+        ascii->inputLength = 0;
+    }
+}
+
+bool readIntCodeOutput(IntCodeASCII* ascii) {
+    /*
+    Reads the program's output into the line until the end of the line, without running the program.
+
+    Returns true if a whole line was read, otherwise, returns false (leaving what there is of the line so
+    far in `line`).
+    */
+    IntCodeProgram* program = ascii->program;
+
+    while (countOutput(program) > 0) {
+        size_t numOutputs;
+        long long* outputs = peekOutput(program, &numOutputs);
+
+        for (size_t idx = 0; idx < numOutputs; idx += 1) {
+            long long output = outputs[idx];
+
+            if (output < 0 || output > 127) {
+                ascii->value = output;
+                ascii->hasValue = true;
+            } else if (output == '\n') {
+                dropOutput(program, idx + 1);
+                return true;
+            } else {
+                // Leave room for the null terminator.
+                if (ascii->lineLength + 2 > ascii->lineSize) {
+                    ascii->lineSize *= 2;
+                    ascii->line = realloc(ascii->line, ascii->lineSize);
+                }
+
+                ascii->line[ascii->lineLength] = (char)output;
+                ascii->lineLength += 1;
+                ascii->line[ascii->lineLength] = '\0';
+            }
+        }
+
+        dropOutput(program, numOutputs);
+    }
+
+    return false;
+}
+
+bool readIntCodeLine(IntCodeASCII* ascii, char** lineDest) {
+    /*
+    Reads the next line of the program's output (without the newline) into the interface's `line`, storing
+    it in the line destination. The program is run as needed to get the line, with any input written so far.
+
+    When the program halts, whatever's left of the last line is read as a line of it's own.
+
+    Returns false if there's no line to read, because the program has halted or is waiting on more input,
+    otherwise, returns true.
+    */
+    IntCodeProgram* program = ascii->program;
+
+    // The last line read is done with, start on the next one.
+    if (ascii->lineComplete) {
+        ascii->line[0] = '\0';
+        ascii->lineLength = 0;
+        ascii->lineComplete = false;
+    }
+
+    while (!readIntCodeOutput(ascii)) {
+        bool hasInput = ascii->inputStart < ascii->inputLength || countLLongChannel(&program->input) > 0;
+        if (ascii->finished || (ascii->waiting && !hasInput)) {
+            // The program's done, hand back the end of the last line if there's any of it.
+            if (!ascii->finished || ascii->lineLength == 0) return false;
+            break;
+        }
+
+        sendIntCodeInput(ascii);
+        intcodeRun(program);
+
+        ascii->finished = program->halted;
+        ascii->waiting = !program->halted && !program->blockedOnOutput;
+    }
+
+    ascii->lineComplete = true;
+    *lineDest = ascii->line;
+    return true;
+}
+
+void runIntCodeASCII(IntCodeASCII* ascii) {
+    /*
+    Runs the program until it halts or waits on more input than has been written, calling `onLine` with
+    every line it outputs.
+    */
+    char* line;
+    while (readIntCodeLine(ascii, &line)) {
+        if (ascii->onLine != NULL) ascii->onLine(ascii, line);
+    }
+}
+
+#endif
@@ -0,0 +1,355 @@
+/*
+Runs batches of independent Intcode program runs across multiple threads.
+
+A batch is made up of jobs, each of which is a run of the same program from the start, with it's own
+input, and optionally with some words of the program patched (like 2019/02's noun and verb). Jobs are
+split evenly across the worker threads, and a worker that runs out of jobs steals half of the remaining
+jobs from another worker. Once the batch is done, each job has the output of it's run, in the order the
+jobs were added in.
+
+Every worker runs it's jobs on it's own private copy of the program, which is reset between jobs instead
+of being re-allocated, and collects the outputs in it's own buffer. After the first few jobs, a worker
+doesn't allocate anything, so the workers never end up waiting on each other in `malloc`.
+
+To check a grid of coordinates with the 2019/19 drone program:
+
+IntCodeBatch batch;
+initIntCodeBatch(&batch, &program, 0);
+
+for (int y = 0; y < 50; y += 1) {
+    for (int x = 0; x < 50; x += 1) {
+        long long input[2] = {x, y};
+        addIntCodeJob(&batch, input, 2);
+    }
+}
+
+runIntCodeBatch(&batch);
+// batch.jobs[y * 50 + x].result is the last output of the run for x, y.
+
+freeIntCodeBatch(&batch);
+
+NOTE: This uses pthreads, so needs to be compiled with `-pthread`.
+*/
+
+#ifndef intcode_batch_c
+#define intcode_batch_c
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "intcode.c"
+
+// ================================ Constants ================================
+
+// The max number of words a job can patch in the program.
+#define MAX_JOB_PATCHES 4
+
+// ================================ Structs ================================
+
+/*
+A word of the program to override before running a job.
+*/
+typedef struct {
+    size_t address;
+    long long value;
+} IntCodePatch;
+
+/*
+A single run of the batch's program.
+
+Running:
+- inputStart: The index of the job's first input in the batch's `inputs`.
+- inputSize: The number of inputs the job has.
+- patches: The words of the program to override before running.
+
+Results (set once the batch has run):
+- output: The outputs of the run. Owned by the batch, and valid until it's freed.
+- outputSize: The number of outputs.
+- result: The batch's `collect` function applied to the program after the run. If the batch doesn't have one,
+  the last output of the run (or 0, if there wasn't any output).
+- halted: If the program halted, or stopped early waiting on more input.
+*/
+typedef struct {
+    size_t inputStart;
+    size_t inputSize;
+
+    IntCodePatch patches[MAX_JOB_PATCHES];
+    int numPatches;
+
+    long long* output;
+    size_t outputSize;
+    long long result;
+    bool halted;
+
+    // The worker that ran the job, and where it's output starts in the worker's output buffer.
+    int worker;
+    size_t outputStart;
+} IntCodeJob;
+
+/*
+A batch of jobs to run on the same program.
+
+- program: The program to run. It's only read while the batch runs, never modified.
+- numThreads: The number of worker threads to run the jobs on.
+- collect: Optional, picks the result of a job from the program after it's run, i.e., reading some memory.
+  This is called from the worker threads, so it should only look at the program it's given.
+- inputs: The inputs of every job, back to back.
+- outputs: The output buffer of every worker, once the batch has run.
+*/
+typedef struct {
+    IntCodeProgram* program;
+    int numThreads;
+    long long (*collect)(IntCodeProgram* program);
+
+    IntCodeJob* jobs;
+    size_t numJobs;
+    size_t jobsSize;
+
+    LLongArray inputs;
+    LLongArray* outputs;
+} IntCodeBatch;
+
+/*
+A worker thread, along with the range of jobs it has left to run, [nextJob, endJob). The range is only ever
+touched with the lock held, since other workers can steal from the end of it.
+*/
+typedef struct {
+    IntCodeBatch* batch;
+    int id;
+    pthread_t thread;
+
+    pthread_mutex_t lock;
+    size_t nextJob;
+    size_t endJob;
+
+    IntCodeProgram program;
+    LLongArray output;
+} IntCodeWorker;
+
+// ================================ Utilities ================================
+
+void initIntCodeBatch(IntCodeBatch* batch, IntCodeProgram* program, int numThreads) {
+    /*
+    Initializes an empty batch of jobs for the program, run with `numThreads` worker threads. If
+    `numThreads` is 0 (or less), there's a worker for each processor.
+    */
+    if (numThreads <= 0) numThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (numThreads <= 0) numThreads = 1;
+
+    batch->program = program;
+    batch->numThreads = numThreads;
+    batch->collect = NULL;
+
+    batch->jobsSize = 64;
+    batch->jobs = malloc(batch->jobsSize * sizeof(IntCodeJob));
+    batch->numJobs = 0;
+
+    initLLongArray(&batch->inputs, 256);
+    batch->outputs = NULL;
+}
+
+void freeIntCodeBatch(IntCodeBatch* batch) {
+    /*
+    Frees all memory associated with the batch, including the job outputs. The program isn't freed.
+    */
+    free(batch->jobs);
+    batch->jobs = NULL;
+    batch->numJobs = 0;
+    batch->jobsSize = 0;
+
+    freeLLongArray(&batch->inputs);
+
+    if (batch->outputs != NULL) {
+        for (int worker = 0; worker < batch->numThreads; worker += 1) freeLLongArray(&batch->outputs[worker]);
+        free(batch->outputs);
+        batch->outputs = NULL;
+    }
+}
+
+size_t addIntCodeJob(IntCodeBatch* batch, long long* input, size_t inputSize) {
+    /*
+    Adds a job to the batch, running the program with the given input, which is copied. The input has to
+    fit in the program's input channel (INTCODE_CHANNEL_CAPACITY words).
+
+    Returns the index of the job.
+    */
+    if (batch->numJobs == batch->jobsSize) {
+        batch->jobsSize *= 2;
+        batch->jobs = realloc(batch->jobs, batch->jobsSize * sizeof(IntCodeJob));
+    }
+
+    IntCodeJob* job = &batch->jobs[batch->numJobs];
+    job->inputStart = batch->inputs.numItems;
+    job->inputSize = inputSize;
+    for (size_t idx = 0; idx < inputSize; idx += 1) insertLLongArray(&batch->inputs, input[idx]);
+
+    job->numPatches = 0;
+    job->output = NULL;
+    job->outputSize = 0;
+    job->result = 0;
+    job->halted = false;
+
+    batch->numJobs += 1;
+    return batch->numJobs - 1;
+}
+
+void patchIntCodeJob(IntCodeBatch* batch, size_t jobIdx, size_t address, long long value) {
+    /*
+    Overrides the word at the address of the program for the job's run only.
+    */
+    IntCodeJob* job = &batch->jobs[jobIdx];
+    if (job->numPatches == MAX_JOB_PATCHES) {
+        printf("Too many patches for job %zu, max is %d\n", jobIdx, MAX_JOB_PATCHES);
+        exit(1);
+    }
+
+    job->patches[job->numPatches].address = address;
+    job->patches[job->numPatches].value = value;
+    job->numPatches += 1;
+}
+
+// ================================ Running Batches ================================
+
+bool takeIntCodeJob(IntCodeWorker* workers, IntCodeWorker* worker, size_t* jobIdx) {
+    /*
+    Takes the worker's next job, storing it in `jobIdx`. If the worker has no jobs left, steals the back half
+    of the jobs of the first worker that still has some.
+
+    Returns false if there's no jobs left anywhere, otherwise, returns true.
+    */
+    IntCodeBatch* batch = worker->batch;
+
+    while (true) {
+        pthread_mutex_lock(&worker->lock);
+        if (worker->nextJob < worker->endJob) {
+            *jobIdx = worker->nextJob;
+            worker->nextJob += 1;
+            pthread_mutex_unlock(&worker->lock);
+            return true;
+        }
+        pthread_mutex_unlock(&worker->lock);
+
+        // Out of jobs, find someone to steal from, starting with the next worker over so thieves spread out.
+        bool stole = false;
+        for (int offset = 1; offset < batch->numThreads && !stole; offset += 1) {
+            IntCodeWorker* victim = &workers[(worker->id + offset) % batch->numThreads];
+
+            pthread_mutex_lock(&victim->lock);
+            size_t remaining = victim->endJob - victim->nextJob;
+            if (remaining > 0) {
+                size_t numStolen = (remaining + 1) / 2;
+                size_t end = victim->endJob;
+                victim->endJob -= numStolen;
+                pthread_mutex_unlock(&victim->lock);
+
+                // Nobody steals from a worker with no jobs, so the range can't have changed since it was empty.
+                pthread_mutex_lock(&worker->lock);
+                worker->nextJob = end - numStolen;
+                worker->endJob = end;
+                pthread_mutex_unlock(&worker->lock);
+
+                stole = true;
+            } else {
+                pthread_mutex_unlock(&victim->lock);
+            }
+        }
+
+        // Jobs never add more jobs, so once every worker is out, the batch is done.
+        if (!stole) return false;
+    }
+}
+
+void runIntCodeJob(IntCodeWorker* worker, IntCodeJob* job) {
+    /*
+    Runs the job on the worker's program, appending it's output to the worker's output buffer.
+    */
+    IntCodeBatch* batch = worker->batch;
+    IntCodeProgram* program = &worker->program;
+
+    resetIntCodeProgram(program);
+    for (int idx = 0; idx < job->numPatches; idx += 1) storeInMemory(program, job->patches[idx].address, job->patches[idx].value);
+
+    clearInput(program);
+    pushInputs(program, batch->inputs.data + job->inputStart, job->inputSize);
+
+    job->worker = worker->id;
+    job->outputStart = worker->output.numItems;
+
+    // Keep the program running while it's output fills up, moving the output over as it goes.
+    long long output;
+    do {
+        intcodeRun(program);
+        while (popOutput(program, &output)) insertLLongArray(&worker->output, output);
+    } while (program->blockedOnOutput);
+
+    job->outputSize = worker->output.numItems - job->outputStart;
+
+    job->halted = program->halted;
+    if (batch->collect != NULL) job->result = batch->collect(program);
+    else job->result = job->outputSize > 0 ? worker->output.data[worker->output.numItems - 1] : 0;
+}
+
+void* runIntCodeWorker(void* arg) {
+    /*
+    The worker thread, which runs jobs until there's none left.
+    */
+    IntCodeWorker* worker = arg;
+    IntCodeWorker* workers = worker - worker->id;
+
+    size_t jobIdx;
+    while (takeIntCodeJob(workers, worker, &jobIdx)) runIntCodeJob(worker, &worker->batch->jobs[jobIdx]);
+
+    return NULL;
+}
+
+void runIntCodeBatch(IntCodeBatch* batch) {
+    /*
+    Runs all the jobs in the batch, returning once they're all done. The batch can be run again (i.e., after
+    adding more jobs), which re-runs every job.
+    */
+    if (batch->outputs != NULL) {
+        for (int worker = 0; worker < batch->numThreads; worker += 1) freeLLongArray(&batch->outputs[worker]);
+        free(batch->outputs);
+    }
+
+    // Every worker gets it's own copy of the program (rather than a fork) made up front, since forks share
+    // reference counts that aren't safe to touch from multiple threads.
+    LLongArray source = {.data = batch->program->program, .numItems = batch->program->programSize, .size = batch->program->programSize};
+
+    IntCodeWorker* workers = malloc(batch->numThreads * sizeof(IntCodeWorker));
+    for (int id = 0; id < batch->numThreads; id += 1) {
+        IntCodeWorker* worker = &workers[id];
+        worker->batch = batch;
+        worker->id = id;
+
+        pthread_mutex_init(&worker->lock, NULL);
+        worker->nextJob = batch->numJobs * id / batch->numThreads;
+        worker->endJob = batch->numJobs * (id + 1) / batch->numThreads;
+
+        initIntCodeProgramFromLLongArray(&worker->program, &source);
+        worker->program.engine = batch->program->engine;
+        initLLongArray(&worker->output, 1024);
+    }
+
+    for (int id = 0; id < batch->numThreads; id += 1) pthread_create(&workers[id].thread, NULL, runIntCodeWorker, &workers[id]);
+    for (int id = 0; id < batch->numThreads; id += 1) pthread_join(workers[id].thread, NULL);
+
+    // Hold on to the output buffers, since the jobs point into them.
+    batch->outputs = malloc(batch->numThreads * sizeof(LLongArray));
+    for (int id = 0; id < batch->numThreads; id += 1) {
+        batch->outputs[id] = workers[id].output;
+
+        pthread_mutex_destroy(&workers[id].lock);
+        freeIntCodeProgram(&workers[id].program);
+    }
+    free(workers);
+
+    for (size_t jobIdx = 0; jobIdx < batch->numJobs; jobIdx += 1) {
+        IntCodeJob* job = &batch->jobs[jobIdx];
+        job->output = batch->outputs[job->worker].data + job->outputStart;
+    }
+}
+
+#endif
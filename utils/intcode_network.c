@@ -0,0 +1,291 @@
+/*
+A cooperative scheduler for running networks of Intcode programs that talk to each other.
+
+Each program in the network is a node. The scheduler takes turns running the nodes, and after every run,
+chops the node's output up into messages and routes each one to the input channel of another node. A node
+is only run when it has input, so nodes sitting idle waiting on input don't burn any time.
+
+Input channels are bounded, if a message doesn't fit, the sending node isn't run again until it's been
+delivered.
+
+To chain 5 programs together in a loop, feeding each program's output into the next one:
+
+IntCodeProgram program;
+initIntCodeProgramFromFile(&program, filePath);
+
+IntCodeNetwork network;
+initIntCodeNetwork(&network, &program, 5);
+
+// Kick off the first program, and run the network until every program halts.
+long long signal = 0;
+sendToIntCodeNode(&network, 0, &signal, 1);
+runIntCodeNetwork(&network);
+
+freeIntCodeNetwork(&network);
+
+For packet-switched networks (like 2019/23), set `messageSize` and `headerSize` so the address at the start
+of each message is routed on but not delivered, give it a `route` function to read the address, and set
+`idleInput` for nodes polling for input to get when they have none. When the whole network goes idle,
+`onIdle` gets a chance to kick it off again.
+*/
+
+#ifndef intcode_network_c
+#define intcode_network_c
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "intcode.c"
+
+// ================================ Constants ================================
+
+// Returned from a route function to drop a message, instead of delivering it to a node.
+#define DROP_MESSAGE -1
+
+// The max number of words in a message.
+#define MAX_MESSAGE_SIZE 16
+
+// ================================ Structs ================================
+
+typedef struct IntCodeNetwork IntCodeNetwork;
+
+/*
+Decides which node a message from `node` goes to, returning the node's index (or DROP_MESSAGE). The message
+is `messageSize` words long.
+
+NOTE: The function can be called more than once for the same message, if the destination's input was full
+the first time.
+*/
+typedef int (*IntCodeRouter)(IntCodeNetwork* network, int node, long long* message);
+
+/*
+Called when the network is idle (no node has any input to run on). Returns true if the network should keep
+running (i.e., something was sent to a node), otherwise, returns false to stop the network.
+*/
+typedef bool (*IntCodeIdleHandler)(IntCodeNetwork* network);
+
+/*
+A node in the network, which is a program and the state the scheduler keeps about it.
+
+State:
+- waiting: True when the program is waiting on input, false before it's first run.
+- finished: True once the program has halted. Programs start off halted before they're first run, so the
+  program's own flag can't tell the two apart.
+- idle: True when the program was given the network's idle input, and hasn't sent or received anything since.
+  An idle node isn't polled again until it's sent some input.
+*/
+typedef struct {
+    IntCodeProgram program;
+
+    bool waiting;
+    bool finished;
+    bool idle;
+} IntCodeNode;
+
+/*
+A network of Intcode programs, along with the rules for routing messages between them.
+
+Routing:
+- messageSize: The number of output words in a message (up to MAX_MESSAGE_SIZE), messages are only routed
+  once they're complete.
+- headerSize: The number of words at the start of a message that are only used for routing, the rest of the
+  message is delivered.
+- route: The function deciding where each message goes. Defaults to the next node in the network, with the
+  last node feeding back into the first.
+
+Idling:
+- hasIdleInput: Whether nodes waiting on input with none to read are polled with `idleInput`.
+- idleInput: The input given to polled nodes (i.e., -1 for "no packets").
+- onIdle: Called when the network is idle, see IntCodeIdleHandler. If not set, the network stops when idle.
+
+Running:
+- context: Anything the route and idle functions need to keep track of.
+- stopped: Set by `stopIntCodeNetwork` to stop the network as soon as the running node finishes.
+- numRuns: The number of times a program in the network has been run.
+*/
+struct IntCodeNetwork {
+    int numNodes;
+    IntCodeNode* nodes;
+
+    int messageSize;
+    int headerSize;
+    IntCodeRouter route;
+
+    bool hasIdleInput;
+    long long idleInput;
+    IntCodeIdleHandler onIdle;
+
+    void* context;
+    bool stopped;
+    long long numRuns;
+};
+
+// ================================ Utilities ================================
+
+int routeToNextNode(IntCodeNetwork* network, int node, long long* message) {
+    /*
+    The default route function, sending every message to the next node in the network.
+    */
+    return (node + 1) % network->numNodes;
+}
+
+void initIntCodeNetwork(IntCodeNetwork* network, IntCodeProgram* program, int numNodes) {
+    /*
+    Initializes a network of `numNodes` forks of the program. Messages are a single word, sent on to the
+    next node in the network.
+
+    The program is untouched and should still be freed by the caller.
+    */
+    network->numNodes = numNodes;
+    network->nodes = malloc(numNodes * sizeof(IntCodeNode));
+    for (int node = 0; node < numNodes; node += 1) {
+        forkIntCodeProgram(program, &network->nodes[node].program);
+
+        network->nodes[node].waiting = false;
+        network->nodes[node].finished = false;
+        network->nodes[node].idle = false;
+    }
+
+    network->messageSize = 1;
+    network->headerSize = 0;
+    network->route = routeToNextNode;
+
+    network->hasIdleInput = false;
+    network->idleInput = 0;
+    network->onIdle = NULL;
+
+    network->context = NULL;
+    network->stopped = false;
+    network->numRuns = 0;
+}
+
+void freeIntCodeNetwork(IntCodeNetwork* network) {
+    /*
+    Frees all memory associated with the network.
+    */
+    for (int node = 0; node < network->numNodes; node += 1) freeIntCodeProgram(&network->nodes[node].program);
+
+    free(network->nodes);
+    network->nodes = NULL;
+    network->numNodes = 0;
+}
+
+bool sendToIntCodeNode(IntCodeNetwork* network, int node, long long* words, size_t numWords) {
+    /*
+    Sends the words to the node's input, all at once.
+
+    Returns false (and doesn't send anything) if there isn't enough room in the input, otherwise, returns true.
+    */
+    IntCodeProgram* program = &network->nodes[node].program;
+    if (spaceLLongChannel(&program->input) < numWords) return false;
+
+    pushInputs(program, words, numWords);
+    return true;
+}
+
+void stopIntCodeNetwork(IntCodeNetwork* network) {
+    /*
+    Stops the network, which can be called from the route and idle functions. The network stops right after
+    the node currently running, and `runIntCodeNetwork` can be called again to pick up where it left off.
+    */
+    network->stopped = true;
+}
+
+// ================================ Running Networks ================================
+
+bool routeNodeOutput(IntCodeNetwork* network, int node, bool* delivered) {
+    /*
+    Routes all the complete messages in the node's output, in order, setting `delivered` if any messages
+    were routed. A partial message at the end is left in the output until the rest of it comes along.
+
+    Returns false if a message couldn't be delivered because the destination's input was full (in which case,
+    it and the messages after it are left in the output to try again later), otherwise, returns true.
+    */
+    IntCodeProgram* program = &network->nodes[node].program;
+
+    long long message[MAX_MESSAGE_SIZE];
+    while (countOutput(program) >= network->messageSize) {
+        // Messages can wrap around the end of the output channel, so copy them out to route them.
+        for (int idx = 0; idx < network->messageSize; idx += 1) message[idx] = getLLongChannel(&program->output, idx);
+
+        int destination = network->route(network, node, message);
+        if (destination != DROP_MESSAGE) {
+            long long* body = message + network->headerSize;
+            if (!sendToIntCodeNode(network, destination, body, network->messageSize - network->headerSize)) return false;
+        }
+
+        dropOutput(program, network->messageSize);
+        *delivered = true;
+    }
+
+    return true;
+}
+
+bool stepIntCodeNode(IntCodeNetwork* network, int node) {
+    /*
+    Gives the node a turn, which is:
+    1. Routing any of it's leftover output. If that can't be done, the node doesn't run this turn.
+    2. Running the program, if it has any input. If it doesn't, the node is only run if it's never been run,
+       it stopped on a full output, or it hasn't been polled with the idle input yet.
+    3. Routing it's output.
+
+    Returns true if the node made any progress (ran or routed anything), otherwise, returns false.
+    */
+    IntCodeNode* current = &network->nodes[node];
+    IntCodeProgram* program = &current->program;
+
+    bool progress = false;
+    if (!routeNodeOutput(network, node, &progress) || network->stopped) return progress;
+
+    // Halted programs are done for good, running them again would restart them.
+    if (current->finished) return progress;
+
+    if (countLLongChannel(&program->input) > 0) {
+        current->idle = false;
+    } else if (current->waiting && !program->blockedOnOutput) {
+        if (!network->hasIdleInput || current->idle) return progress;
+
+        pushInput(program, network->idleInput);
+        current->idle = true;
+    }
+
+    intcodeRun(program);
+    network->numRuns += 1;
+    current->waiting = !program->halted;
+    current->finished = program->halted;
+
+    // A node that sent something isn't idle, it could have more to send.
+    if (countOutput(program) > 0) current->idle = false;
+
+    routeNodeOutput(network, node, &progress);
+    return true;
+}
+
+void runIntCodeNetwork(IntCodeNetwork* network) {
+    /*
+    Runs the network until it's stopped, every program in it halts, or it goes idle without an idle function
+    to kick it off again (or the idle function decides to stop).
+
+    The network is idle when a full pass over the nodes doesn't run or route anything.
+    */
+    network->stopped = false;
+
+    while (true) {
+        bool progress = false;
+        bool running = false;
+
+        for (int node = 0; node < network->numNodes; node += 1) {
+            if (stepIntCodeNode(network, node)) progress = true;
+            if (network->stopped) return;
+
+            if (!network->nodes[node].finished) running = true;
+        }
+
+        if (progress) continue;
+        if (!running) return;
+        if (network->onIdle == NULL || !network->onIdle(network)) return;
+        if (network->stopped) return;
+    }
+}
+
+#endif
@@ -0,0 +1,522 @@
+/*
+Records traces of Intcode program runs, and replays them to look at the program at any step of the run.
+
+A trace is a compact binary log of every instruction the program ran (a "step"): where the instruction
+pointer ended up, and what the instruction did - the word it wrote, the input it read, the output it
+wrote, or how it moved the relative base. Most steps take a byte or two.
+
+Every `checkpointInterval` steps, the trace also takes a snapshot of the program (a checkpoint), which
+only costs the pages written since the last one. Replaying a trace starts from the closest checkpoint
+before the step being looked at and applies the steps after it, so seeking anywhere in the trace costs at
+most `checkpointInterval` steps, and nothing is ever re-run.
+
+To record a run, and look at the program right before the 1000th instruction:
+
+IntCodeTrace trace;
+initIntCodeTrace(&trace, 0);
+
+pushInput(&program, 1);
+traceIntCodeRun(&trace, &program);
+
+IntCodeReplay replay;
+initIntCodeReplay(&replay, &trace);
+seekIntCodeReplay(&replay, 999);
+
+// replay.program is the program as it was after 999 steps, step through the next few.
+while (replay.step < 1010 && stepIntCodeReplay(&replay)) printIntCodeTraceStep(&replay.lastStep);
+
+freeIntCodeReplay(&replay);
+freeIntCodeTrace(&trace);
+
+NOTE: Traced runs go one instruction at a time (like the LOOP_ENGINE), whatever the program's `engine` is.
+*/
+
+#ifndef intcode_trace_c
+#define intcode_trace_c
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "intcode.c"
+
+// ================================ Constants ================================
+
+// The number of steps between checkpoints, unless the trace is given it's own.
+#define INTCODE_TRACE_CHECKPOINT_INTERVAL 16384
+
+// The number of bits of a step's header taken up by it's event.
+#define INTCODE_TRACE_EVENT_BITS 3
+
+// ================================ Structs ================================
+
+/*
+What a step did, besides moving the instruction pointer.
+
+STEP_EVENT: Nothing else, i.e. a jump.
+WRITE_EVENT: Wrote `value` to `address` (ADD, MULTIPLY, LESS_THAN and EQUALS).
+INPUT_EVENT: Read `value` from the input, and wrote it to `address`.
+OUTPUT_EVENT: Wrote `value` to the output.
+RELATIVE_BASE_EVENT: Moved the relative base by `value`.
+HALT_EVENT: Halted the program.
+*/
+typedef enum IntCodeTraceEvent {
+    STEP_EVENT = 0,
+    WRITE_EVENT = 1,
+    INPUT_EVENT = 2,
+    OUTPUT_EVENT = 3,
+    RELATIVE_BASE_EVENT = 4,
+    HALT_EVENT = 5,
+} IntCodeTraceEvent;
+
+/*
+A single step of a trace, decoded.
+
+- step: The index of the step in the trace, starting at 0.
+- instructionPointer: The address of the instruction that ran.
+- nextInstructionPointer: Where the instruction pointer was after it ran.
+- event: What else the instruction did, with the `address` and `value` it did it with (see
+  IntCodeTraceEvent).
+*/
+typedef struct {
+    size_t step;
+    size_t instructionPointer;
+    size_t nextInstructionPointer;
+    IntCodeTraceEvent event;
+    size_t address;
+    long long value;
+} IntCodeTraceStep;
+
+/*
+A snapshot of the program taken after `step` steps, where the step after it starts `offset` bytes into
+the trace.
+*/
+typedef struct {
+    size_t step;
+    size_t offset;
+    IntCodeProgram snapshot;
+} IntCodeCheckpoint;
+
+/*
+A trace of a single run of a program.
+
+Steps are encoded back to back in `data`, each one starting with a header of the step's event (in the low
+INTCODE_TRACE_EVENT_BITS bits) and how far the instruction pointer moved from where the last step left it.
+The event's address and value (if it has them) come right after. Everything is stored as variable-length
+integers (7 bits a byte), with signed numbers zigzag encoded so small negative numbers stay small.
+
+- numSteps: The number of steps in the trace.
+- checkpointInterval: The number of steps between checkpoints. The first checkpoint is the program right
+  before the first step.
+- instructionPointer: Where the instruction pointer was after the last step.
+*/
+typedef struct {
+    unsigned char* data;
+    size_t numBytes;
+    size_t dataSize;
+
+    size_t numSteps;
+    size_t instructionPointer;
+
+    size_t checkpointInterval;
+    IntCodeCheckpoint* checkpoints;
+    size_t numCheckpoints;
+    size_t checkpointsSize;
+} IntCodeTrace;
+
+/*
+A replay of a trace, holding the program as it was after `step` steps.
+
+Only the program's memory, `instructionPointer`, `relativeBase` and `halted` are replayed, it's I/O channels
+are left as they were at the last checkpoint. The I/O of the last step replayed is in `lastStep`.
+*/
+typedef struct {
+    IntCodeTrace* trace;
+    IntCodeProgram program;
+
+    size_t step;
+    // Where the next step starts in the trace's data.
+    size_t offset;
+    IntCodeTraceStep lastStep;
+} IntCodeReplay;
+
+// ================================ Encoding ================================
+
+void writeTraceVarint(IntCodeTrace* trace, unsigned long long value) {
+    /*
+    Appends the value to the trace, 7 bits at a time from the lowest bits up, with the high bit of each byte
+    set if there's more to come. The trace has to have room for it (up to 10 bytes).
+    */
+    unsigned char* data = trace->data + trace->numBytes;
+    while (value >= 0x80) {
+        *data = (value & 0x7F) | 0x80;
+        data += 1;
+        value >>= 7;
+    }
+    *data = value;
+    trace->numBytes = data + 1 - trace->data;
+}
+
+unsigned long long readTraceVarint(IntCodeTrace* trace, size_t* offset) {
+    /*
+    Reads the variable-length integer at the offset into the trace, advancing the offset past it.
+    */
+    unsigned long long value = 0;
+    int shift = 0;
+
+    unsigned char byte;
+    do {
+        byte = trace->data[*offset];
+        *offset += 1;
+        value |= (unsigned long long)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    return value;
+}
+
+unsigned long long zigzagEncode(long long value) {
+    // Interleaves positive and negative numbers: 0, -1, 1, -2, 2, ... -> 0, 1, 2, 3, 4, ...
+    return ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63);
+}
+
+long long zigzagDecode(unsigned long long value) {
+    return (long long)(value >> 1) ^ -(long long)(value & 1);
+}
+
+// ================================ Utilities ================================
+
+void initIntCodeTrace(IntCodeTrace* trace, size_t checkpointInterval) {
+    /*
+    Initializes an empty trace, taking a checkpoint every `checkpointInterval` steps. If it's 0, there's a
+    checkpoint every INTCODE_TRACE_CHECKPOINT_INTERVAL steps.
+    */
+    trace->dataSize = 4096;
+    trace->data = malloc(trace->dataSize);
+    trace->numBytes = 0;
+
+    trace->numSteps = 0;
+    trace->instructionPointer = 0;
+
+    trace->checkpointInterval = checkpointInterval > 0 ? checkpointInterval : INTCODE_TRACE_CHECKPOINT_INTERVAL;
+    trace->checkpointsSize = 16;
+    trace->checkpoints = malloc(trace->checkpointsSize * sizeof(IntCodeCheckpoint));
+    trace->numCheckpoints = 0;
+}
+
+void clearIntCodeTrace(IntCodeTrace* trace) {
+    /*
+    Throws away every step and checkpoint in the trace, so it can record a new run.
+    */
+    for (size_t idx = 0; idx < trace->numCheckpoints; idx += 1) freeIntCodeProgram(&trace->checkpoints[idx].snapshot);
+    trace->numCheckpoints = 0;
+
+    trace->numBytes = 0;
+    trace->numSteps = 0;
+    trace->instructionPointer = 0;
+}
+
+void freeIntCodeTrace(IntCodeTrace* trace) {
+    /*
+    Frees all memory associated with the trace. Any replays of it have to be freed first.
+    */
+    clearIntCodeTrace(trace);
+
+    free(trace->data);
+    trace->data = NULL;
+    trace->dataSize = 0;
+
+    free(trace->checkpoints);
+    trace->checkpoints = NULL;
+    trace->checkpointsSize = 0;
+}
+
+void addIntCodeCheckpoint(IntCodeTrace* trace, IntCodeProgram* program) {
+    /*
+    Snapshots the program as it is after the trace's last step.
+    */
+    if (trace->numCheckpoints == trace->checkpointsSize) {
+        trace->checkpointsSize *= 2;
+        trace->checkpoints = realloc(trace->checkpoints, trace->checkpointsSize * sizeof(IntCodeCheckpoint));
+    }
+
+    IntCodeCheckpoint* checkpoint = &trace->checkpoints[trace->numCheckpoints];
+    checkpoint->step = trace->numSteps;
+    checkpoint->offset = trace->numBytes;
+    snapshotIntCodeProgram(program, &checkpoint->snapshot);
+
+    trace->numCheckpoints += 1;
+}
+
+void printIntCodeTraceStep(IntCodeTraceStep* step) {
+    /*
+    Prints the step on it's own line, like:
+
+        Step 1234: 56 -> 60, wrote 7 to 100
+    */
+    printf("Step %zu: %zu -> %zu", step->step, step->instructionPointer, step->nextInstructionPointer);
+
+    if (step->event == WRITE_EVENT) printf(", wrote %lld to %zu", step->value, step->address);
+    else if (step->event == INPUT_EVENT) printf(", read input %lld into %zu", step->value, step->address);
+    else if (step->event == OUTPUT_EVENT) printf(", output %lld", step->value);
+    else if (step->event == RELATIVE_BASE_EVENT) printf(", moved the relative base by %lld", step->value);
+    else if (step->event == HALT_EVENT) printf(", halted");
+
+    printf("\n");
+}
+
+// ================================ Recording ================================
+
+void recordIntCodeStep(IntCodeTrace* trace, IntCodeProgram* program, IntCodeTraceEvent event, size_t address, long long value) {
+    /*
+    Appends a step the program just ran to the trace, taking a checkpoint after it if it's time for one.
+    */
+    // Make room for the biggest possible step, a header, an address and a value of 10 bytes each.
+    if (trace->numBytes + 30 > trace->dataSize) {
+        trace->dataSize *= 2;
+        trace->data = realloc(trace->data, trace->dataSize);
+    }
+
+    long long moved = (long long)(program->instructionPointer - trace->instructionPointer);
+    writeTraceVarint(trace, zigzagEncode(moved) << INTCODE_TRACE_EVENT_BITS | event);
+
+    if (event == WRITE_EVENT || event == INPUT_EVENT) writeTraceVarint(trace, address);
+    if (event != STEP_EVENT && event != HALT_EVENT) writeTraceVarint(trace, zigzagEncode(value));
+
+    trace->instructionPointer = program->instructionPointer;
+    trace->numSteps += 1;
+
+    if (trace->numSteps % trace->checkpointInterval == 0) addIntCodeCheckpoint(trace, program);
+}
+
+long long readIntCodeParameter(IntCodeProgram* program, ParameterMode mode, long long operand) {
+    // Evaluates a (non-output) parameter in the given mode.
+    if (mode == IMMEDIATE) return operand;
+    if (mode == RELATIVE) return readMemory(program, program->relativeBase + operand);
+    return readMemory(program, operand);
+}
+
+bool traceGenericInstruction(IntCodeTrace* trace, IntCodeProgram* program) {
+    /*
+    Executes an unusual instruction (one without a threaded engine handler, like an IMMEDIATE output
+    parameter) with `executeInstruction`, working out what it did from the program afterwards, and
+    recording it in the trace.
+
+    Returns the same as `traceIntCodeInstruction`.
+    */
+    // Copy the instruction, since running it can overwrite (and invalidate) it's cached decoding.
+    DecodedInstruction scratch;
+    DecodedInstruction instruction = *fetchInstruction(program, &scratch);
+    size_t relativeBase = program->relativeBase;
+
+    bool running = executeInstruction(program);
+    if (!running && !program->halted) return false;
+
+    int opcode = instruction.opcode;
+    if (opcode == ADD || opcode == MULTIPLY || opcode == LESS_THAN || opcode == EQUALS || opcode == STORE_INPUT) {
+        int outputIdx = INSTRUCTION_OUTPUT_PARAMETER_INDEXES[opcode];
+        size_t address = instruction.operands[outputIdx];
+        if (instruction.parameterModes[outputIdx] == RELATIVE) address += relativeBase;
+
+        IntCodeTraceEvent event = opcode == STORE_INPUT ? INPUT_EVENT : WRITE_EVENT;
+        recordIntCodeStep(trace, program, event, address, readMemory(program, address));
+    } else if (opcode == OUTPUT) {
+        long long output = getLLongChannel(&program->output, countLLongChannel(&program->output) - 1);
+        recordIntCodeStep(trace, program, OUTPUT_EVENT, 0, output);
+    } else if (opcode == ADJUST_RELATIVE_BASE) {
+        recordIntCodeStep(trace, program, RELATIVE_BASE_EVENT, 0, (long long)(program->relativeBase - relativeBase));
+    } else if (opcode == EXIT) {
+        recordIntCodeStep(trace, program, HALT_EVENT, 0, 0);
+    } else {
+        recordIntCodeStep(trace, program, STEP_EVENT, 0, 0);
+    }
+
+    return running;
+}
+
+bool traceIntCodeInstruction(IntCodeTrace* trace, IntCodeProgram* program) {
+    /*
+    Executes the instruction the pointer is currently on, the same as `executeInstruction`, recording it in
+    the trace as it goes.
+
+    Returns false if the program stopped running, either because it halted, it's waiting on input, or
+    it's output channel is full, otherwise, returns true. Instructions that stop to wait on I/O didn't run,
+    so they aren't recorded.
+    */
+    DecodedInstruction scratch;
+    DecodedInstruction* instruction = fetchInstruction(program, &scratch);
+    if (instruction->handler <= GENERIC_HANDLER) return traceGenericInstruction(trace, program);
+    PROFILE_INSTRUCTION(program, program->instructionPointer, instruction);
+
+    // Storing can invalidate the cached instruction, so everything needed from it is read up front.
+    int opcode = instruction->opcode;
+    ParameterMode modes[MAX_OPCODE_PARAMETERS];
+    long long operands[MAX_OPCODE_PARAMETERS];
+    for (int idx = 0; idx < MAX_OPCODE_PARAMETERS; idx += 1) {
+        modes[idx] = instruction->parameterModes[idx];
+        operands[idx] = instruction->operands[idx];
+    }
+
+    if (opcode == ADD || opcode == MULTIPLY || opcode == LESS_THAN || opcode == EQUALS) {
+        long long a = readIntCodeParameter(program, modes[0], operands[0]);
+        long long b = readIntCodeParameter(program, modes[1], operands[1]);
+        size_t address = modes[2] == RELATIVE ? program->relativeBase + operands[2] : (size_t)operands[2];
+
+        long long value;
+        if (opcode == ADD) value = a + b;
+        else if (opcode == MULTIPLY) value = a * b;
+        else if (opcode == LESS_THAN) value = a < b ? 1 : 0;
+        else value = a == b ? 1 : 0;
+
+        program->instructionPointer += 4;
+        storeInMemory(program, address, value);
+        recordIntCodeStep(trace, program, WRITE_EVENT, address, value);
+    } else if (opcode == STORE_INPUT) {
+        long long input;
+        if (!popLLongChannel(&program->input, &input)) {
+            PROFILE_BLOCKED(program, true);
+            return false;
+        }
+
+        size_t address = modes[0] == RELATIVE ? program->relativeBase + operands[0] : (size_t)operands[0];
+        program->instructionPointer += 2;
+        storeInMemory(program, address, input);
+        recordIntCodeStep(trace, program, INPUT_EVENT, address, input);
+    } else if (opcode == OUTPUT) {
+        long long output = readIntCodeParameter(program, modes[0], operands[0]);
+        if (!pushLLongChannel(&program->output, output)) {
+            program->blockedOnOutput = true;
+            PROFILE_BLOCKED(program, false);
+            return false;
+        }
+
+        program->instructionPointer += 2;
+        recordIntCodeStep(trace, program, OUTPUT_EVENT, 0, output);
+    } else if (opcode == JUMP_IF_TRUE || opcode == JUMP_IF_FALSE) {
+        long long a = readIntCodeParameter(program, modes[0], operands[0]);
+        if ((a != 0) == (opcode == JUMP_IF_TRUE)) program->instructionPointer = readIntCodeParameter(program, modes[1], operands[1]);
+        else program->instructionPointer += 3;
+        recordIntCodeStep(trace, program, STEP_EVENT, 0, 0);
+    } else if (opcode == ADJUST_RELATIVE_BASE) {
+        long long adjustment = readIntCodeParameter(program, modes[0], operands[0]);
+        program->relativeBase += adjustment;
+        program->instructionPointer += 2;
+        recordIntCodeStep(trace, program, RELATIVE_BASE_EVENT, 0, adjustment);
+    } else {
+        // EXIT, the only other instruction with a handler.
+        program->instructionPointer += 1;
+        program->halted = true;
+        recordIntCodeStep(trace, program, HALT_EVENT, 0, 0);
+        return false;
+    }
+
+    return true;
+}
+
+void traceIntCodeRun(IntCodeTrace* trace, IntCodeProgram* program) {
+    /*
+    Runs the program (see `intcodeRun`), recording every instruction it runs in the trace. Running it again
+    after it stops on I/O carries on with the same trace.
+
+    A trace only covers a single run. If the program has halted (so it starts over), the trace does too.
+
+    NOTE: Anything done to the program's memory between runs (like `storeInMemory`) isn't recorded, so
+    replays won't see it.
+    */
+    if (program->halted) {
+        resetIntCodeProgram(program);
+        clearIntCodeTrace(trace);
+    }
+    program->blockedOnOutput = false;
+
+    // The first checkpoint is the program before any of the run, so every step can be replayed.
+    if (trace->numCheckpoints == 0) {
+        trace->instructionPointer = program->instructionPointer;
+        addIntCodeCheckpoint(trace, program);
+    }
+
+    while (traceIntCodeInstruction(trace, program));
+}
+
+// ================================ Replaying ================================
+
+void initIntCodeReplay(IntCodeReplay* replay, IntCodeTrace* trace) {
+    /*
+    Initializes a replay of the trace, at the start of it (before the first step). The trace has to have
+    been run at least once, and can keep recording while it's replayed.
+    */
+    replay->trace = trace;
+    forkIntCodeProgram(&trace->checkpoints[0].snapshot, &replay->program);
+
+    replay->step = 0;
+    replay->offset = 0;
+    replay->lastStep = (IntCodeTraceStep){.event = STEP_EVENT};
+}
+
+void freeIntCodeReplay(IntCodeReplay* replay) {
+    /*
+    Frees all memory associated with the replay, the trace isn't freed.
+    */
+    freeIntCodeProgram(&replay->program);
+    replay->trace = NULL;
+}
+
+bool stepIntCodeReplay(IntCodeReplay* replay) {
+    /*
+    Replays the next step of the trace, applying it to the replay's program and storing it in `lastStep`.
+
+    Returns false if the replay is already at the end of the trace, otherwise, returns true.
+    */
+    IntCodeTrace* trace = replay->trace;
+    if (replay->step >= trace->numSteps) return false;
+
+    IntCodeProgram* program = &replay->program;
+    IntCodeTraceStep* step = &replay->lastStep;
+
+    unsigned long long header = readTraceVarint(trace, &replay->offset);
+    step->step = replay->step;
+    step->event = header & ((1 << INTCODE_TRACE_EVENT_BITS) - 1);
+    step->instructionPointer = program->instructionPointer;
+    step->nextInstructionPointer = program->instructionPointer + zigzagDecode(header >> INTCODE_TRACE_EVENT_BITS);
+    step->address = 0;
+    step->value = 0;
+
+    if (step->event == WRITE_EVENT || step->event == INPUT_EVENT) step->address = readTraceVarint(trace, &replay->offset);
+    if (step->event != STEP_EVENT && step->event != HALT_EVENT) step->value = zigzagDecode(readTraceVarint(trace, &replay->offset));
+
+    if (step->event == WRITE_EVENT || step->event == INPUT_EVENT) storeInMemory(program, step->address, step->value);
+    else if (step->event == RELATIVE_BASE_EVENT) program->relativeBase += step->value;
+    else if (step->event == HALT_EVENT) program->halted = true;
+
+    program->instructionPointer = step->nextInstructionPointer;
+    replay->step += 1;
+    return true;
+}
+
+void seekIntCodeReplay(IntCodeReplay* replay, size_t step) {
+    /*
+    Moves the replay to right after `step` steps of the trace (or to the end of the trace, if it's shorter
+    than that), going forwards or backwards.
+
+    The replay jumps to the last checkpoint before the step, unless it's already between the two, and
+    replays the steps from there, so `lastStep` is always the step that was just seeked to.
+    */
+    IntCodeTrace* trace = replay->trace;
+    if (step > trace->numSteps) step = trace->numSteps;
+
+    // Checkpoints are taken every `checkpointInterval` steps, starting at step 0.
+    size_t checkpointIdx = step > 0 ? (step - 1) / trace->checkpointInterval : 0;
+    if (checkpointIdx >= trace->numCheckpoints) checkpointIdx = trace->numCheckpoints - 1;
+
+    IntCodeCheckpoint* checkpoint = &trace->checkpoints[checkpointIdx];
+    if (step < replay->step || checkpoint->step > replay->step) {
+        restoreIntCodeProgram(&replay->program, &checkpoint->snapshot);
+        replay->step = checkpoint->step;
+        replay->offset = checkpoint->offset;
+        replay->lastStep = (IntCodeTraceStep){.event = STEP_EVENT};
+    }
+
+    while (replay->step < step) stepIntCodeReplay(replay);
+}
+
+#endif
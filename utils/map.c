@@ -1,4 +1,9 @@
+#ifndef map_c
+#define map_c
+
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -8,18 +13,6 @@ float TABLE_MAX_LOAD = .75;
  * Implementation heavily inspired by / copied from the Crafting Interpreters book.
  */
 
-typedef struct {
-    char* key;
-    char* value;
-} KeyValuePair;
-
-typedef struct {
-    KeyValuePair* entries;
-
-    int numKeys;
-    int capacity;
-} Map;
-
 /**
  * Returns the has of the given key using the FNV-1a hashing algorithm.
  *
@@ -38,169 +31,969 @@ static uint32_t hashString(const char* key, int length) {
     return hash;
 }
 
+/*
+KeyArena
+*/
+
+// The smallest chunk of memory a key arena allocates at a time.
+#define KEY_ARENA_CHUNK_SIZE 4096
+
+/**
+ * A bump allocator for map keys. Keys are copied back to back into chunks of memory, and are only ever
+ * freed all at once, along with the map.
+ *
+ * Deleted keys' copies stay in the arena, but are counted in `numDeadBytes` (out of `numBytes` copied in
+ * all), so a map can tell when it's worth moving it's live keys into a fresh arena.
+ */
+typedef struct KeyArenaChunk {
+    struct KeyArenaChunk* next;
+    size_t size;
+    size_t used;
+    char data[];
+} KeyArenaChunk;
+
+typedef struct {
+    KeyArenaChunk* chunks;
+    size_t numBytes;
+    size_t numDeadBytes;
+} KeyArena;
+
+void initKeyArena(KeyArena* arena) {
+    arena->chunks = NULL;
+    arena->numBytes = 0;
+    arena->numDeadBytes = 0;
+}
+
+void freeKeyArena(KeyArena* arena) {
+    while (arena->chunks != NULL) {
+        KeyArenaChunk* next = arena->chunks->next;
+        free(arena->chunks);
+        arena->chunks = next;
+    }
+
+    arena->numBytes = 0;
+    arena->numDeadBytes = 0;
+}
+
+/**
+ * Throws away every key in the arena, keeping the latest chunk around to be filled up again.
+ */
+void clearKeyArena(KeyArena* arena) {
+    if (arena->chunks == NULL) return;
+
+    KeyArenaChunk* chunk = arena->chunks;
+    arena->chunks = chunk->next;
+    freeKeyArena(arena);
+
+    chunk->next = NULL;
+    chunk->used = 0;
+    arena->chunks = chunk;
+}
+
+/**
+ * Copies the first `keyLength` characters of `key` into the arena, NULL terminated. Returns the copy.
+ */
+char* copyKeyArena(KeyArena* arena, const char* key, int keyLength) {
+    KeyArenaChunk* chunk = arena->chunks;
+    if (chunk == NULL || chunk->used + keyLength + 1 > chunk->size) {
+        size_t size = keyLength + 1 > KEY_ARENA_CHUNK_SIZE ? keyLength + 1 : KEY_ARENA_CHUNK_SIZE;
+        chunk = malloc(sizeof(KeyArenaChunk) + size);
+        chunk->next = arena->chunks;
+        chunk->size = size;
+        chunk->used = 0;
+        arena->chunks = chunk;
+    }
+
+    char* copy = chunk->data + chunk->used;
+    memcpy(copy, key, keyLength);
+    copy[keyLength] = '\0';
+    chunk->used += keyLength + 1;
+    arena->numBytes += keyLength + 1;
+
+    return copy;
+}
+
+/**
+ * Marks a `keyLength` long key copied into the arena as no longer used.
+ */
+void releaseKeyArena(KeyArena* arena, int keyLength) {
+    arena->numDeadBytes += keyLength + 1;
+}
+
+/**
+ * Returns if most of the arena is taken up by released keys, and there's at least a chunk's worth of them.
+ */
+bool isKeyArenaWasteful(KeyArena* arena) {
+    return arena->numDeadBytes >= KEY_ARENA_CHUNK_SIZE && arena->numDeadBytes * 2 > arena->numBytes;
+}
+
+/**
+ * Returns the number of bytes the arena has allocated, used or not.
+ */
+size_t sizeKeyArena(KeyArena* arena) {
+    size_t bytes = 0;
+    for (KeyArenaChunk* chunk = arena->chunks; chunk != NULL; chunk = chunk->next) bytes += sizeof(KeyArenaChunk) + chunk->size;
+    return bytes;
+}
+
+/*
+MapStats
+*/
+
+// Probe lengths of at least this many all share the last bucket of the histogram.
+#define MAP_STATS_HISTOGRAM_SIZE 16
+
+/**
+ * How full a map is, and how long it takes to find the keys in it.
+ *
+ * A key's probe length is the number of steps a lookup of it takes, 1 if it's right where it hashes to.
+ * For the linear probing maps, a step is a slot, for Swiss tables, a step is a group of slots.
+ *
+ * - bytesUsed: Everything the map has allocated, it's table(s) and key arena.
+ * - probeHistogram: The number of keys with each probe length, with the probe length 1 at index 0.
+ */
+typedef struct {
+    int numKeys;
+    int numTombstones;
+    int capacity;
+    double loadFactor;
+
+    double meanProbeLength;
+    int maxProbeLength;
+    int probeHistogram[MAP_STATS_HISTOGRAM_SIZE];
+
+    size_t bytesUsed;
+} MapStats;
+
+static void initMapStats(MapStats* stats, int numKeys, int numTombstones, int capacity, size_t bytesUsed) {
+    stats->numKeys = numKeys;
+    stats->numTombstones = numTombstones;
+    stats->capacity = capacity;
+    stats->loadFactor = capacity > 0 ? (double)(numKeys + numTombstones) / capacity : 0;
+
+    stats->meanProbeLength = 0;
+    stats->maxProbeLength = 0;
+    memset(stats->probeHistogram, 0, sizeof(stats->probeHistogram));
+
+    stats->bytesUsed = bytesUsed;
+}
+
+static void addMapStatsProbe(MapStats* stats, int probeLength) {
+    // The mean is kept as a sum until `finishMapStats`.
+    stats->meanProbeLength += probeLength;
+    if (probeLength > stats->maxProbeLength) stats->maxProbeLength = probeLength;
+
+    int bucket = probeLength < MAP_STATS_HISTOGRAM_SIZE ? probeLength - 1 : MAP_STATS_HISTOGRAM_SIZE - 1;
+    stats->probeHistogram[bucket] += 1;
+}
+
+static void finishMapStats(MapStats* stats) {
+    if (stats->numKeys > 0) stats->meanProbeLength /= stats->numKeys;
+}
+
+/**
+ * Prints the stats, and a histogram of the probe lengths if `printHistogram` is set.
+ */
+void printMapStats(MapStats* stats, bool printHistogram) {
+    printf("%d keys (+%d tombstones) in %d slots, %.1f%% full, probe length %.2f mean, %d max, %zu bytes\n", stats->numKeys,
+           stats->numTombstones, stats->capacity, stats->loadFactor * 100, stats->meanProbeLength, stats->maxProbeLength, stats->bytesUsed);
+    if (!printHistogram) return;
+
+    int maxCount = 1;
+    for (int bucket = 0; bucket < MAP_STATS_HISTOGRAM_SIZE; bucket += 1) {
+        if (stats->probeHistogram[bucket] > maxCount) maxCount = stats->probeHistogram[bucket];
+    }
+
+    for (int bucket = 0; bucket < MAP_STATS_HISTOGRAM_SIZE; bucket += 1) {
+        if (stats->probeHistogram[bucket] == 0) continue;
+
+        printf("  %2d%s %9d ", bucket + 1, bucket == MAP_STATS_HISTOGRAM_SIZE - 1 ? "+" : " ", stats->probeHistogram[bucket]);
+        for (int bar = 0; bar < stats->probeHistogram[bucket] * 50 / maxCount; bar += 1) printf("#");
+        printf("\n");
+    }
+}
+
+#ifdef SWISS_MAP
+
+/*
+Map and LLongMap, backed by Swiss tables (see swiss_map.c).
+*/
+
+#include "swiss_map.c"
+
+typedef SwissMap Map;
+typedef SwissLLongMap LLongMap;
+
+void initMap(Map* map) {
+    initSwissMap(map);
+}
+
+void freeMap(Map* map) {
+    freeSwissMap(map);
+}
+
+void clearMap(Map* map) {
+    clearSwissMap(map);
+}
+
+bool setMapWithLength(Map* map, const char* key, int keyLength, char* value) {
+    return setSwissMapWithLength(map, key, keyLength, value);
+}
+
+bool setMap(Map* map, const char* key, char* value) {
+    return setSwissMap(map, key, value);
+}
+
+bool getMapWithLength(Map* map, const char* key, int keyLength, char** value) {
+    return getSwissMapWithLength(map, key, keyLength, value);
+}
+
+bool getMap(Map* map, const char* key, char** value) {
+    return getSwissMap(map, key, value);
+}
+
+bool deleteMapWithLength(Map* map, const char* key, int keyLength) {
+    return deleteSwissMapWithLength(map, key, keyLength);
+}
+
+bool deleteMap(Map* map, const char* key) {
+    return deleteSwissMap(map, key);
+}
+
+int countMap(Map* map) {
+    return countSwissMap(map);
+}
+
+bool nextMapWithLength(Map* map, int* cursor, char** key, int* keyLength, char** value) {
+    return nextSwissMapWithLength(map, cursor, key, keyLength, value);
+}
+
+bool nextMap(Map* map, int* cursor, char** key, char** value) {
+    return nextSwissMap(map, cursor, key, value);
+}
+
+void getMapStats(Map* map, MapStats* stats) {
+    getSwissMapStats(map, stats);
+}
+
+
+void initLLongMap(LLongMap* map) {
+    initSwissLLongMap(map);
+}
+
+void freeLLongMap(LLongMap* map) {
+    freeSwissLLongMap(map);
+}
+
+void clearLLongMap(LLongMap* map) {
+    clearSwissLLongMap(map);
+}
+
+bool setLLongMapWithLength(LLongMap* map, const char* key, int keyLength, long long value) {
+    return setSwissLLongMapWithLength(map, key, keyLength, value);
+}
+
+bool setLLongMap(LLongMap* map, const char* key, long long value) {
+    return setSwissLLongMap(map, key, value);
+}
+
+bool getLLongMapWithLength(LLongMap* map, const char* key, int keyLength, long long* value) {
+    return getSwissLLongMapWithLength(map, key, keyLength, value);
+}
+
+bool getLLongMap(LLongMap* map, const char* key, long long* value) {
+    return getSwissLLongMap(map, key, value);
+}
+
+bool deleteLLongMapWithLength(LLongMap* map, const char* key, int keyLength) {
+    return deleteSwissLLongMapWithLength(map, key, keyLength);
+}
+
+bool deleteLLongMap(LLongMap* map, const char* key) {
+    return deleteSwissLLongMap(map, key);
+}
+
+int countLLongMap(LLongMap* map) {
+    return countSwissLLongMap(map);
+}
+
+bool nextLLongMapWithLength(LLongMap* map, int* cursor, char** key, int* keyLength, long long* value) {
+    return nextSwissLLongMapWithLength(map, cursor, key, keyLength, value);
+}
+
+bool nextLLongMap(LLongMap* map, int* cursor, char** key, long long* value) {
+    return nextSwissLLongMap(map, cursor, key, value);
+}
+
+void getLLongMapStats(LLongMap* map, MapStats* stats) {
+    getSwissLLongMapStats(map, stats);
+}
+
+
+#else
+
+/*
+Map
+*/
+
+// The `keyLength` of an entry whose key was deleted. Tombstones have a NULL key like empty entries, so
+// they're skipped by anything looking for keys, but probing carries on past them.
+#define TOMBSTONE_KEY_LENGTH -1
+
+/**
+ * Entries keep the hash and length of their key, so probing only compares keys with a matching hash,
+ * and growing the map never has to hash a key again.
+ */
+typedef struct {
+    char* key;
+    int keyLength;
+    uint32_t hash;
+    char* value;
+} KeyValuePair;
+
+/**
+ * A map of strings to strings. The map makes it's own (NULL terminated) copy of every key in it's `keys`
+ * arena, so callers can pass in keys that are only temporary, like a buffer on the stack, or a piece of a
+ * bigger string. The values are still owned by the caller.
+ */
+typedef struct {
+    KeyValuePair* entries;
+    KeyArena keys;
+
+    int numKeys;
+    int numTombstones;
+    int capacity;
+} Map;
+
+/**
+ * Returns the capacity a map should grow to, to fit another key. Maps full of tombstones are just rebuilt
+ * at the same capacity, which clears out the tombstones.
+ */
+static int growCapacity(int capacity, int numKeys) {
+    if (capacity < 8) return 8;
+    if (numKeys + 1 <= capacity * TABLE_MAX_LOAD / 2) return capacity;
+    return capacity * 2;
+}
+
 void initMap(Map* map) {
     map->entries = NULL;
+    initKeyArena(&map->keys);
 
     map->numKeys = 0;
+    map->numTombstones = 0;
     map->capacity = 0;
 }
 
 void freeMap(Map* map) {
     free(map->entries);
+    freeKeyArena(&map->keys);
     initMap(map);
 }
 
-static KeyValuePair* findEntry(KeyValuePair* entries, int capacity, char* key) {
-    uint32_t index = hashString(key, strlen(key)) % capacity;
+/**
+ * Removes every key from the map, keeping it's capacity so it can be filled again without re-growing.
+ */
+void clearMap(Map* map) {
+    if (map->capacity > 0) memset(map->entries, 0, map->capacity * sizeof(KeyValuePair));
+    clearKeyArena(&map->keys);
+
+    map->numKeys = 0;
+    map->numTombstones = 0;
+}
+
+static KeyValuePair* findEntry(KeyValuePair* entries, int capacity, const char* key, int keyLength, uint32_t hash) {
+    uint32_t index = hash % capacity;
+    KeyValuePair* tombstone = NULL;
 
     while (true) {
         KeyValuePair* entry = &entries[index];
-        // NOTE: strcmp is probably the bottleneck of this whole implementation, it's pretty slow.
-        if (entry->key == NULL || strcmp(entry->key, key) == 0) return entry;
+        if (entry->key == NULL) {
+            // A missing key goes in the first tombstone passed, if any, to reuse it.
+            if (entry->keyLength != TOMBSTONE_KEY_LENGTH) return tombstone != NULL ? tombstone : entry;
+            if (tombstone == NULL) tombstone = entry;
+        } else if (entry->hash == hash && entry->keyLength == keyLength && memcmp(entry->key, key, keyLength) == 0) {
+            // Only compare the keys themselves once the hashes match, which is almost always a hit.
+            return entry;
+        }
 
         index = (index + 1) % capacity;
     }
 }
 
-static void growMap(Map* map) {
-    int newCapacity = map->capacity < 8 ? 8 : map->capacity * 2;
-
-    KeyValuePair* newEntries = malloc(newCapacity * sizeof(KeyValuePair));
+/**
+ * Rebuilds the map at the new capacity (which can be the same as the old one), without it's tombstones.
+ * If any keys have been deleted, the live keys are moved into a fresh arena, leaving the deleted ones behind.
+ */
+static void growMap(Map* map, int newCapacity) {
+    bool compactKeys = map->keys.numDeadBytes > 0;
+    KeyArena newKeys;
+    initKeyArena(&newKeys);
 
-    for (int idx = 0; idx < newCapacity; idx += 1) {
-        newEntries[idx].key = NULL;
-        newEntries[idx].value = NULL;
-    }
+    KeyValuePair* newEntries = calloc(newCapacity, sizeof(KeyValuePair));
 
     // Copy over the old values
     for (int idx = 0; idx < map->capacity; idx += 1) {
         KeyValuePair* source = &map->entries[idx];
         if (source->key == NULL) continue;
 
-        KeyValuePair* dest = findEntry(newEntries, newCapacity, source->key);
-        dest->key = source->key;
-        dest->value = source->value;
+        // Keys in the old entries are all unique, so there's no need to compare them, just find an empty slot.
+        uint32_t index = source->hash % newCapacity;
+        while (newEntries[index].key != NULL) index = (index + 1) % newCapacity;
+        newEntries[index] = *source;
+        if (compactKeys) newEntries[index].key = copyKeyArena(&newKeys, source->key, source->keyLength);
     }
 
     free(map->entries);
+    if (compactKeys) {
+        freeKeyArena(&map->keys);
+        map->keys = newKeys;
+    }
 
     map->entries = newEntries;
     map->capacity = newCapacity;
+    map->numTombstones = 0;
 }
 
-bool setMap(Map* map, char* key, char* value) {
-    // Grow the map if need be.
-    if (map->numKeys + 1 > map->capacity * TABLE_MAX_LOAD) {
-        growMap(map);
+/**
+ * Sets the first `keyLength` characters of `key` (which doesn't have to be NULL terminated) to `value`.
+ *
+ * Returns if the key is new to the map.
+ */
+bool setMapWithLength(Map* map, const char* key, int keyLength, char* value) {
+    uint32_t hash = hashString(key, keyLength);
+    KeyValuePair* entry = map->capacity > 0 ? findEntry(map->entries, map->capacity, key, keyLength, hash) : NULL;
+    bool isNewKey = entry == NULL || entry->key == NULL;
+    if (isNewKey) {
+        // Grow the map if need be. This only happens when adding a key, so updating a key never moves the
+        // entries or keys around (`key` could even be one of the map's own keys).
+        if (map->numKeys + map->numTombstones + 1 > map->capacity * TABLE_MAX_LOAD) {
+            growMap(map, growCapacity(map->capacity, map->numKeys));
+            entry = findEntry(map->entries, map->capacity, key, keyLength, hash);
+        } else if (isKeyArenaWasteful(&map->keys)) {
+            // Mostly deleted keys in the arena, rebuild to leave them behind.
+            growMap(map, map->capacity);
+            entry = findEntry(map->entries, map->capacity, key, keyLength, hash);
+        }
+
+        if (entry->keyLength == TOMBSTONE_KEY_LENGTH) map->numTombstones -= 1;
+        map->numKeys += 1;
+
+        entry->key = copyKeyArena(&map->keys, key, keyLength);
+        entry->keyLength = keyLength;
+        entry->hash = hash;
     }
 
-    KeyValuePair* entry = findEntry(map->entries, map->capacity, key);
-    bool isNewKey = entry->key == NULL;
-    if (isNewKey) map->numKeys += 1;
-
-    entry->key = key;
     entry->value = value;
 
     return isNewKey;
 }
 
-bool getMap(Map* map, char* key, char** value) {
+bool setMap(Map* map, const char* key, char* value) {
+    return setMapWithLength(map, key, strlen(key), value);
+}
+
+/**
+ * Gets the value of the first `keyLength` characters of `key`, which doesn't have to be NULL terminated.
+ */
+bool getMapWithLength(Map* map, const char* key, int keyLength, char** value) {
     if (map->numKeys == 0) return false;
 
-    KeyValuePair* entry = findEntry(map->entries, map->capacity, key);
+    KeyValuePair* entry = findEntry(map->entries, map->capacity, key, keyLength, hashString(key, keyLength));
     if (entry->key == NULL) return false;
 
     *value = entry->value;
     return true;
 }
 
+bool getMap(Map* map, const char* key, char** value) {
+    return getMapWithLength(map, key, strlen(key), value);
+}
+
+/**
+ * Deletes the key from the map, leaving a tombstone in it's place. Returns if the key was in the map.
+ *
+ * The key's copy stays in the arena until the map is next rebuilt, which happens early once deleted keys
+ * take up most of the arena.
+ */
+bool deleteMapWithLength(Map* map, const char* key, int keyLength) {
+    if (map->numKeys == 0) return false;
+
+    KeyValuePair* entry = findEntry(map->entries, map->capacity, key, keyLength, hashString(key, keyLength));
+    if (entry->key == NULL) return false;
+
+    releaseKeyArena(&map->keys, entry->keyLength);
+    entry->key = NULL;
+    entry->keyLength = TOMBSTONE_KEY_LENGTH;
+    entry->value = NULL;
+    map->numKeys -= 1;
+    map->numTombstones += 1;
+
+    return true;
+}
+
+bool deleteMap(Map* map, const char* key) {
+    return deleteMapWithLength(map, key, strlen(key));
+}
+
+/**
+ * Returns the number of keys in the map.
+ */
+int countMap(Map* map) {
+    return map->numKeys;
+}
+
+/**
+ * Gets the next key (and it's length) and value in the map, starting from the entry `cursor` is at (start it
+ * at 0), and moves the cursor past it. Returns false once there are no keys left.
+ *
+ * The map shouldn't be changed while it's being iterated over, other than updating existing keys, which never
+ * moves the entries (or keys) around, since maps only grow when a key is added.
+ */
+bool nextMapWithLength(Map* map, int* cursor, char** key, int* keyLength, char** value) {
+    while (*cursor < map->capacity) {
+        KeyValuePair* entry = &map->entries[*cursor];
+        *cursor += 1;
+
+        if (entry->key == NULL) continue;
+
+        *key = entry->key;
+        *keyLength = entry->keyLength;
+        *value = entry->value;
+        return true;
+    }
+
+    return false;
+}
+
+bool nextMap(Map* map, int* cursor, char** key, char** value) {
+    int keyLength;
+    return nextMapWithLength(map, cursor, key, &keyLength, value);
+}
+
+/**
+ * Fills in `stats` with how full the map is, and how far each key is from where it hashes to.
+ */
+void getMapStats(Map* map, MapStats* stats) {
+    initMapStats(stats, map->numKeys, map->numTombstones, map->capacity, map->capacity * sizeof(KeyValuePair) + sizeKeyArena(&map->keys));
+
+    for (int idx = 0; idx < map->capacity; idx += 1) {
+        KeyValuePair* entry = &map->entries[idx];
+        if (entry->key == NULL) continue;
+
+        int home = entry->hash % map->capacity;
+        addMapStatsProbe(stats, (idx - home + map->capacity) % map->capacity + 1);
+    }
+
+    finishMapStats(stats);
+}
+
 /*
 LLongMap
 */
 
 typedef struct {
     char* key;
+    int keyLength;
+    uint32_t hash;
     long long value;
 } LLongKeyValuePair;
 
+/**
+ * A map of strings to long longs, which owns it's keys just like `Map`.
+ */
 typedef struct {
     LLongKeyValuePair* entries;
+    KeyArena keys;
 
     int numKeys;
+    int numTombstones;
     int capacity;
 } LLongMap;
 
 void initLLongMap(LLongMap* map) {
     map->entries = NULL;
+    initKeyArena(&map->keys);
 
     map->numKeys = 0;
+    map->numTombstones = 0;
     map->capacity = 0;
 }
 
 void freeLLongMap(LLongMap* map) {
     free(map->entries);
+    freeKeyArena(&map->keys);
     initLLongMap(map);
 }
 
-static LLongKeyValuePair* findLLongEntry(LLongKeyValuePair* entries, int capacity, char* key) {
-    uint32_t index = hashString(key, strlen(key)) % capacity;
+/**
+ * Removes every key from the map, keeping it's capacity so it can be filled again without re-growing.
+ */
+void clearLLongMap(LLongMap* map) {
+    if (map->capacity > 0) memset(map->entries, 0, map->capacity * sizeof(LLongKeyValuePair));
+    clearKeyArena(&map->keys);
+
+    map->numKeys = 0;
+    map->numTombstones = 0;
+}
+
+static LLongKeyValuePair* findLLongEntry(LLongKeyValuePair* entries, int capacity, const char* key, int keyLength, uint32_t hash) {
+    uint32_t index = hash % capacity;
+    LLongKeyValuePair* tombstone = NULL;
 
     while (true) {
         LLongKeyValuePair* entry = &entries[index];
-        // NOTE: strcmp is probably the bottleneck of this whole implementation, it's pretty slow.
-        if (entry->key == NULL || strcmp(entry->key, key) == 0) return entry;
+        if (entry->key == NULL) {
+            if (entry->keyLength != TOMBSTONE_KEY_LENGTH) return tombstone != NULL ? tombstone : entry;
+            if (tombstone == NULL) tombstone = entry;
+        } else if (entry->hash == hash && entry->keyLength == keyLength && memcmp(entry->key, key, keyLength) == 0) {
+            return entry;
+        }
 
         index = (index + 1) % capacity;
     }
 }
 
-static void growLLongMap(LLongMap* map) {
-    int newCapacity = map->capacity < 8 ? 8 : map->capacity * 2;
-
-    LLongKeyValuePair* newEntries = malloc(newCapacity * sizeof(LLongKeyValuePair));
+/**
+ * Rebuilds the map at the new capacity, see `growMap`.
+ */
+static void growLLongMap(LLongMap* map, int newCapacity) {
+    bool compactKeys = map->keys.numDeadBytes > 0;
+    KeyArena newKeys;
+    initKeyArena(&newKeys);
 
-    for (int idx = 0; idx < newCapacity; idx += 1) {
-        newEntries[idx].key = NULL;
-    }
+    LLongKeyValuePair* newEntries = calloc(newCapacity, sizeof(LLongKeyValuePair));
 
     // Copy over the old values
     for (int idx = 0; idx < map->capacity; idx += 1) {
         LLongKeyValuePair* source = &map->entries[idx];
         if (source->key == NULL) continue;
 
-        LLongKeyValuePair* dest = findLLongEntry(newEntries, newCapacity, source->key);
-        dest->key = source->key;
-        dest->value = source->value;
+        uint32_t index = source->hash % newCapacity;
+        while (newEntries[index].key != NULL) index = (index + 1) % newCapacity;
+        newEntries[index] = *source;
+        if (compactKeys) newEntries[index].key = copyKeyArena(&newKeys, source->key, source->keyLength);
     }
 
     free(map->entries);
+    if (compactKeys) {
+        freeKeyArena(&map->keys);
+        map->keys = newKeys;
+    }
 
     map->entries = newEntries;
     map->capacity = newCapacity;
+    map->numTombstones = 0;
+}
+
+/**
+ * Sets the first `keyLength` characters of `key` to `value`, see `setMapWithLength`.
+ */
+bool setLLongMapWithLength(LLongMap* map, const char* key, int keyLength, long long value) {
+    uint32_t hash = hashString(key, keyLength);
+    LLongKeyValuePair* entry = map->capacity > 0 ? findLLongEntry(map->entries, map->capacity, key, keyLength, hash) : NULL;
+    bool isNewKey = entry == NULL || entry->key == NULL;
+    if (isNewKey) {
+        // Grow the map if need be. This only happens when adding a key, so updating a key never moves the
+        // entries or keys around (`key` could even be one of the map's own keys).
+        if (map->numKeys + map->numTombstones + 1 > map->capacity * TABLE_MAX_LOAD) {
+            growLLongMap(map, growCapacity(map->capacity, map->numKeys));
+            entry = findLLongEntry(map->entries, map->capacity, key, keyLength, hash);
+        } else if (isKeyArenaWasteful(&map->keys)) {
+            // Mostly deleted keys in the arena, rebuild to leave them behind.
+            growLLongMap(map, map->capacity);
+            entry = findLLongEntry(map->entries, map->capacity, key, keyLength, hash);
+        }
+
+        if (entry->keyLength == TOMBSTONE_KEY_LENGTH) map->numTombstones -= 1;
+        map->numKeys += 1;
+
+        entry->key = copyKeyArena(&map->keys, key, keyLength);
+        entry->keyLength = keyLength;
+        entry->hash = hash;
+    }
+
+    entry->value = value;
+
+    return isNewKey;
+}
+
+bool setLLongMap(LLongMap* map, const char* key, long long value) {
+    return setLLongMapWithLength(map, key, strlen(key), value);
+}
+
+bool getLLongMapWithLength(LLongMap* map, const char* key, int keyLength, long long* value) {
+    if (map->numKeys == 0) return false;
+
+    LLongKeyValuePair* entry = findLLongEntry(map->entries, map->capacity, key, keyLength, hashString(key, keyLength));
+    if (entry->key == NULL) return false;
+
+    *value = entry->value;
+    return true;
+}
+
+bool getLLongMap(LLongMap* map, const char* key, long long* value) {
+    return getLLongMapWithLength(map, key, strlen(key), value);
+}
+
+/**
+ * Deletes the key from the map, see `deleteMapWithLength`.
+ */
+bool deleteLLongMapWithLength(LLongMap* map, const char* key, int keyLength) {
+    if (map->numKeys == 0) return false;
+
+    LLongKeyValuePair* entry = findLLongEntry(map->entries, map->capacity, key, keyLength, hashString(key, keyLength));
+    if (entry->key == NULL) return false;
+
+    releaseKeyArena(&map->keys, entry->keyLength);
+    entry->key = NULL;
+    entry->keyLength = TOMBSTONE_KEY_LENGTH;
+    entry->value = 0;
+    map->numKeys -= 1;
+    map->numTombstones += 1;
+
+    return true;
+}
+
+bool deleteLLongMap(LLongMap* map, const char* key) {
+    return deleteLLongMapWithLength(map, key, strlen(key));
+}
+
+int countLLongMap(LLongMap* map) {
+    return map->numKeys;
+}
+
+/**
+ * Gets the next key (and it's length) and value in the map, see `nextMapWithLength`.
+ */
+bool nextLLongMapWithLength(LLongMap* map, int* cursor, char** key, int* keyLength, long long* value) {
+    while (*cursor < map->capacity) {
+        LLongKeyValuePair* entry = &map->entries[*cursor];
+        *cursor += 1;
+
+        if (entry->key == NULL) continue;
+
+        *key = entry->key;
+        *keyLength = entry->keyLength;
+        *value = entry->value;
+        return true;
+    }
+
+    return false;
+}
+
+bool nextLLongMap(LLongMap* map, int* cursor, char** key, long long* value) {
+    int keyLength;
+    return nextLLongMapWithLength(map, cursor, key, &keyLength, value);
+}
+
+/**
+ * Fills in `stats` for the map, see `getMapStats`.
+ */
+void getLLongMapStats(LLongMap* map, MapStats* stats) {
+    initMapStats(stats, map->numKeys, map->numTombstones, map->capacity, map->capacity * sizeof(LLongKeyValuePair) + sizeKeyArena(&map->keys));
+
+    for (int idx = 0; idx < map->capacity; idx += 1) {
+        LLongKeyValuePair* entry = &map->entries[idx];
+        if (entry->key == NULL) continue;
+
+        int home = entry->hash % map->capacity;
+        addMapStatsProbe(stats, (idx - home + map->capacity) % map->capacity + 1);
+    }
+
+    finishMapStats(stats);
+}
+
+#endif
+
+/*
+Int64Map
+*/
+
+/**
+ * A map of integers to integers, for caches that would otherwise have to format their keys into strings.
+ *
+ * Keys are stored inline (there's nothing to allocate or free per key), hashed with a fast integer mix, and
+ * looked up with linear probing in a power-of-two sized table, so finding a slot is a mask instead of a
+ * modulo. Since any integer is a valid key, each entry has an `occupied` flag instead of a NULL key.
+ *
+ * To go through every key and value:
+ *
+ * int cursor = 0;
+ * int64_t key, value;
+ * while (nextInt64Map(&map, &cursor, &key, &value)) { ... }
+ */
+
+typedef struct {
+    int64_t key;
+    int64_t value;
+    bool occupied;
+} Int64KeyValuePair;
+
+typedef struct {
+    Int64KeyValuePair* entries;
+
+    int numKeys;
+    int capacity;
+} Int64Map;
+
+/**
+ * Returns the hash of the given key, the finalizer from SplitMix64, which spreads every bit of the key
+ * across the whole hash. Keys that are close together (i.e. packed coordinates) end up far apart.
+ */
+static uint64_t hashInt64(int64_t key) {
+    uint64_t hash = (uint64_t)key;
+
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebull;
+    hash ^= hash >> 31;
+
+    return hash;
+}
+
+void initInt64Map(Int64Map* map) {
+    map->entries = NULL;
+
+    map->numKeys = 0;
+    map->capacity = 0;
+}
+
+void freeInt64Map(Int64Map* map) {
+    free(map->entries);
+    initInt64Map(map);
+}
+
+/**
+ * Removes every key from the map, keeping the table so it can be filled again without re-growing.
+ */
+void clearInt64Map(Int64Map* map) {
+    for (int idx = 0; idx < map->capacity; idx += 1) map->entries[idx].occupied = false;
+    map->numKeys = 0;
+}
+
+static Int64KeyValuePair* findInt64Entry(Int64KeyValuePair* entries, int capacity, int64_t key) {
+    // The capacity is always a power of two.
+    uint64_t mask = capacity - 1;
+    uint64_t index = hashInt64(key) & mask;
+
+    while (true) {
+        Int64KeyValuePair* entry = &entries[index];
+        if (!entry->occupied || entry->key == key) return entry;
+
+        index = (index + 1) & mask;
+    }
 }
 
-bool setLLongMap(LLongMap* map, char* key, long long value) {
-    // Grow the map if need be.
-    if (map->numKeys + 1 > map->capacity * TABLE_MAX_LOAD) {
-        growLLongMap(map);
+static void growInt64Map(Int64Map* map) {
+    int newCapacity = map->capacity < 8 ? 8 : map->capacity * 2;
+
+    Int64KeyValuePair* newEntries = calloc(newCapacity, sizeof(Int64KeyValuePair));
+
+    // Copy over the old values
+    for (int idx = 0; idx < map->capacity; idx += 1) {
+        Int64KeyValuePair* source = &map->entries[idx];
+        if (!source->occupied) continue;
+
+        *findInt64Entry(newEntries, newCapacity, source->key) = *source;
     }
 
-    LLongKeyValuePair* entry = findLLongEntry(map->entries, map->capacity, key);
-    bool isNewKey = entry->key == NULL;
-    if (isNewKey) map->numKeys += 1;
+    free(map->entries);
+
+    map->entries = newEntries;
+    map->capacity = newCapacity;
+}
+
+bool setInt64Map(Int64Map* map, int64_t key, int64_t value) {
+    Int64KeyValuePair* entry = map->capacity > 0 ? findInt64Entry(map->entries, map->capacity, key) : NULL;
+    bool isNewKey = entry == NULL || !entry->occupied;
+    if (isNewKey) {
+        // Grow the map if need be, only when adding a key, so updating a key never moves the entries around.
+        if (map->numKeys + 1 > map->capacity * TABLE_MAX_LOAD) {
+            growInt64Map(map);
+            entry = findInt64Entry(map->entries, map->capacity, key);
+        }
+
+        map->numKeys += 1;
+    }
 
     entry->key = key;
     entry->value = value;
+    entry->occupied = true;
 
     return isNewKey;
 }
 
-bool getLLongMap(LLongMap* map, char* key, long long* value) {
+bool getInt64Map(Int64Map* map, int64_t key, int64_t* value) {
     if (map->numKeys == 0) return false;
 
-    LLongKeyValuePair* entry = findLLongEntry(map->entries, map->capacity, key);
-    if (entry->key == NULL) return false;
+    Int64KeyValuePair* entry = findInt64Entry(map->entries, map->capacity, key);
+    if (!entry->occupied) return false;
 
     *value = entry->value;
     return true;
 }
+
+/**
+ * Adds `amount` to the key's value, treating a missing key as 0, in a single lookup. Returns the new value.
+ */
+int64_t addInt64Map(Int64Map* map, int64_t key, int64_t amount) {
+    Int64KeyValuePair* entry = map->capacity > 0 ? findInt64Entry(map->entries, map->capacity, key) : NULL;
+    if (entry == NULL || !entry->occupied) {
+        // Grow the map if need be, see `setInt64Map`.
+        if (map->numKeys + 1 > map->capacity * TABLE_MAX_LOAD) {
+            growInt64Map(map);
+            entry = findInt64Entry(map->entries, map->capacity, key);
+        }
+
+        map->numKeys += 1;
+        entry->key = key;
+        entry->value = 0;
+        entry->occupied = true;
+    }
+
+    entry->value += amount;
+    return entry->value;
+}
+
+/**
+ * Gets the next key and value in the map, starting from the entry `cursor` is at (start it at 0), and moves
+ * the cursor past it. Returns false once there are no keys left.
+ *
+ * The map shouldn't be changed while it's being iterated over, other than updating existing keys (or adding to
+ * them with `addInt64Map`), see `nextMapWithLength`.
+ */
+bool nextInt64Map(Int64Map* map, int* cursor, int64_t* key, int64_t* value) {
+    while (*cursor < map->capacity) {
+        Int64KeyValuePair* entry = &map->entries[*cursor];
+        *cursor += 1;
+
+        if (!entry->occupied) continue;
+
+        *key = entry->key;
+        *value = entry->value;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Fills in `stats` for the map, see `getMapStats`. Int64Maps never have tombstones, and keep no keys outside
+ * the table.
+ */
+void getInt64MapStats(Int64Map* map, MapStats* stats) {
+    initMapStats(stats, map->numKeys, 0, map->capacity, map->capacity * sizeof(Int64KeyValuePair));
+
+    for (int idx = 0; idx < map->capacity; idx += 1) {
+        Int64KeyValuePair* entry = &map->entries[idx];
+        if (!entry->occupied) continue;
+
+        int home = hashInt64(entry->key) & (map->capacity - 1);
+        addMapStatsProbe(stats, ((idx - home) & (map->capacity - 1)) + 1);
+    }
+
+    finishMapStats(stats);
+}
+
+#endif
@@ -0,0 +1,466 @@
+/*
+A Swiss table (group probing) backend for `Map` and `LLongMap`.
+
+Each slot has a control byte, kept in it's own array apart from the slots: EMPTY, DELETED, or (for a full
+slot) the low 7 bits of the key's hash. Slots are grouped 16 at a time, and a lookup compares the hash
+fragment against the control bytes of a whole group at once (a single SSE2 compare, where available), so it
+only ever looks at a slot, let alone it's key, when the fragment matches. Groups are probed in triangular
+order until one has an EMPTY slot in it.
+
+The slots hold the key's full hash, length and pointer, and the value, while the keys themselves are copied
+into the map's `KeyArena`. A probe only reads the control bytes, plus a single slot (and key) per match.
+
+To switch a day over, define SWISS_MAP before including map.c, which makes `Map` and `LLongMap` (and all
+of their functions) use this backend:
+
+#define SWISS_MAP
+#include "../../utils/map.c"
+
+Both backends can also be used side by side by including this file after map.c and using the `SwissMap`
+and `SwissLLongMap` functions directly.
+*/
+
+#ifndef swiss_map_c
+#define swiss_map_c
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "map.c"
+
+// ================================ Constants ================================
+
+#define SWISS_GROUP_SIZE 16
+
+#define SWISS_EMPTY 0x80
+#define SWISS_DELETED 0xfe
+
+// Swiss tables can fill up more than linear probing ones, since a probe looks at a whole group at a time.
+#define SWISS_MAX_LOAD_NUMERATOR 7
+#define SWISS_MAX_LOAD_DENOMINATOR 8
+
+// ================================ Structs ================================
+
+/*
+A full slot. The key lives in the table's `keys` arena, the value is whichever kind the map holds.
+*/
+typedef struct {
+    char* key;
+    int keyLength;
+    uint32_t hash;
+
+    union {
+        char* string;
+        long long llong;
+    } value;
+} SwissSlot;
+
+/*
+A Swiss table, the same for `SwissMap` and `SwissLLongMap`, which only differ in their values.
+
+- control: A control byte per slot, `capacity` of them (always a multiple of SWISS_GROUP_SIZE, and a power
+  of 2).
+- numTombstones: The number of DELETED slots, which count towards the load until the table grows.
+*/
+typedef struct {
+    uint8_t* control;
+    SwissSlot* slots;
+    KeyArena keys;
+
+    int numKeys;
+    int numTombstones;
+    int capacity;
+} SwissTable;
+
+typedef struct {
+    SwissTable table;
+} SwissMap;
+
+typedef struct {
+    SwissTable table;
+} SwissLLongMap;
+
+// ================================ Groups ================================
+
+uint32_t matchSwissGroup(uint8_t* group, uint8_t fragment) {
+    /*
+    Returns a bit mask of the slots in the group whose control byte is `fragment`.
+    */
+#if defined(__SSE2__)
+    __m128i control = _mm_loadu_si128((__m128i*)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8((char)fragment)));
+#else
+    uint32_t mask = 0;
+    for (int idx = 0; idx < SWISS_GROUP_SIZE; idx += 1) {
+        if (group[idx] == fragment) mask |= 1u << idx;
+    }
+    return mask;
+#endif
+}
+
+uint32_t matchSwissGroupAvailable(uint8_t* group) {
+    /*
+    Returns a bit mask of the slots in the group that are EMPTY or DELETED, which are the only control bytes
+    with their high bit set.
+    */
+#if defined(__SSE2__)
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((__m128i*)group));
+#else
+    uint32_t mask = 0;
+    for (int idx = 0; idx < SWISS_GROUP_SIZE; idx += 1) {
+        if (group[idx] & 0x80) mask |= 1u << idx;
+    }
+    return mask;
+#endif
+}
+
+// ================================ Tables ================================
+
+void initSwissTable(SwissTable* table) {
+    table->control = NULL;
+    table->slots = NULL;
+    initKeyArena(&table->keys);
+
+    table->numKeys = 0;
+    table->numTombstones = 0;
+    table->capacity = 0;
+}
+
+void freeSwissTable(SwissTable* table) {
+    free(table->control);
+    free(table->slots);
+    freeKeyArena(&table->keys);
+    initSwissTable(table);
+}
+
+void clearSwissTable(SwissTable* table) {
+    /*
+    Empties the table, keeping it's capacity.
+    */
+    if (table->capacity > 0) memset(table->control, SWISS_EMPTY, table->capacity);
+    clearKeyArena(&table->keys);
+
+    table->numKeys = 0;
+    table->numTombstones = 0;
+}
+
+int findSwissSlot(SwissTable* table, const char* key, int keyLength, uint32_t hash) {
+    /*
+    Returns the index of the slot holding the key, or -1 if it's not in the table.
+    */
+    if (table->numKeys == 0) return -1;
+
+    uint8_t fragment = hash & 0x7f;
+    size_t groupMask = table->capacity / SWISS_GROUP_SIZE - 1;
+    size_t groupIdx = (hash >> 7) & groupMask;
+
+    for (size_t probe = 1;; probe += 1) {
+        uint8_t* group = table->control + groupIdx * SWISS_GROUP_SIZE;
+
+        for (uint32_t matches = matchSwissGroup(group, fragment); matches != 0; matches &= matches - 1) {
+            int slotIdx = groupIdx * SWISS_GROUP_SIZE + __builtin_ctz(matches);
+            SwissSlot* slot = &table->slots[slotIdx];
+            if (slot->hash == hash && slot->keyLength == keyLength && memcmp(slot->key, key, keyLength) == 0) return slotIdx;
+        }
+
+        // An EMPTY slot means the key would have been put in this group, if it was in the table.
+        if (matchSwissGroup(group, SWISS_EMPTY) != 0) return -1;
+
+        groupIdx = (groupIdx + probe) & groupMask;
+    }
+}
+
+int findSwissAvailableSlot(uint8_t* control, int capacity, uint32_t hash) {
+    /*
+    Returns the index of the first EMPTY or DELETED slot along the hash's probe sequence.
+    */
+    size_t groupMask = capacity / SWISS_GROUP_SIZE - 1;
+    size_t groupIdx = (hash >> 7) & groupMask;
+
+    for (size_t probe = 1;; probe += 1) {
+        uint32_t available = matchSwissGroupAvailable(control + groupIdx * SWISS_GROUP_SIZE);
+        if (available != 0) return groupIdx * SWISS_GROUP_SIZE + __builtin_ctz(available);
+
+        groupIdx = (groupIdx + probe) & groupMask;
+    }
+}
+
+void rebuildSwissTable(SwissTable* table, int newCapacity) {
+    /*
+    Moves every slot into a table of the new capacity, leaving the tombstones behind. The stored hashes are
+    reused, and keys are never compared, since they're all unique. If any keys have been deleted, the live
+    keys are moved into a fresh arena too, leaving the deleted ones behind.
+    */
+    bool compactKeys = table->keys.numDeadBytes > 0;
+    KeyArena newKeys;
+    initKeyArena(&newKeys);
+
+    uint8_t* control = malloc(newCapacity);
+    memset(control, SWISS_EMPTY, newCapacity);
+    SwissSlot* slots = malloc(newCapacity * sizeof(SwissSlot));
+
+    for (int slotIdx = 0; slotIdx < table->capacity; slotIdx += 1) {
+        if (table->control[slotIdx] & 0x80) continue;
+
+        uint32_t hash = table->slots[slotIdx].hash;
+        int newSlotIdx = findSwissAvailableSlot(control, newCapacity, hash);
+        control[newSlotIdx] = hash & 0x7f;
+        slots[newSlotIdx] = table->slots[slotIdx];
+        if (compactKeys) slots[newSlotIdx].key = copyKeyArena(&newKeys, slots[newSlotIdx].key, slots[newSlotIdx].keyLength);
+    }
+
+    free(table->control);
+    free(table->slots);
+    if (compactKeys) {
+        freeKeyArena(&table->keys);
+        table->keys = newKeys;
+    }
+
+    table->control = control;
+    table->slots = slots;
+    table->capacity = newCapacity;
+    table->numTombstones = 0;
+}
+
+void growSwissTable(SwissTable* table) {
+    /*
+    Rebuilds the table at twice the size, or the same size if the table's mostly tombstones.
+    */
+    int newCapacity = table->capacity == 0 ? SWISS_GROUP_SIZE : table->capacity * 2;
+    if (table->capacity > 0 && (table->numKeys + 1) * 2 * SWISS_MAX_LOAD_DENOMINATOR <= table->capacity * SWISS_MAX_LOAD_NUMERATOR) {
+        newCapacity = table->capacity;
+    }
+
+    rebuildSwissTable(table, newCapacity);
+}
+
+SwissSlot* insertSwissSlot(SwissTable* table, const char* key, int keyLength, bool* isNewKey) {
+    /*
+    Returns the slot holding the key, adding it (with a copy of the key) if it's not already in the table, in
+    which case `isNewKey` is set and the slot's value is left for the caller to set.
+    */
+    uint32_t hash = hashString(key, keyLength);
+    int slotIdx = findSwissSlot(table, key, keyLength, hash);
+    *isNewKey = slotIdx == -1;
+    if (slotIdx != -1) return &table->slots[slotIdx];
+
+    // Grow the table if need be.
+    if ((table->numKeys + table->numTombstones + 1) * SWISS_MAX_LOAD_DENOMINATOR > table->capacity * SWISS_MAX_LOAD_NUMERATOR) {
+        growSwissTable(table);
+    } else if (isKeyArenaWasteful(&table->keys)) {
+        // Mostly deleted keys in the arena, rebuild to leave them behind.
+        rebuildSwissTable(table, table->capacity);
+    }
+
+    slotIdx = findSwissAvailableSlot(table->control, table->capacity, hash);
+    if (table->control[slotIdx] == SWISS_DELETED) table->numTombstones -= 1;
+    table->control[slotIdx] = hash & 0x7f;
+
+    SwissSlot* slot = &table->slots[slotIdx];
+    slot->key = copyKeyArena(&table->keys, key, keyLength);
+    slot->keyLength = keyLength;
+    slot->hash = hash;
+
+    table->numKeys += 1;
+    return slot;
+}
+
+bool deleteSwissSlot(SwissTable* table, const char* key, int keyLength) {
+    /*
+    Marks the key's slot as DELETED, returning if the key was in the table.
+    */
+    int slotIdx = findSwissSlot(table, key, keyLength, hashString(key, keyLength));
+    if (slotIdx == -1) return false;
+
+    releaseKeyArena(&table->keys, table->slots[slotIdx].keyLength);
+    table->control[slotIdx] = SWISS_DELETED;
+    table->slots[slotIdx].key = NULL;
+    table->numKeys -= 1;
+    table->numTombstones += 1;
+    return true;
+}
+
+bool nextSwissSlot(SwissTable* table, int* cursor, SwissSlot** slot) {
+    /*
+    Finds the next full slot, starting from the slot `cursor` is at, and moves the cursor past it. Returns
+    false once there are no full slots left.
+    */
+    while (*cursor < table->capacity) {
+        int slotIdx = *cursor;
+        *cursor += 1;
+
+        if (table->control[slotIdx] & 0x80) continue;
+
+        *slot = &table->slots[slotIdx];
+        return true;
+    }
+
+    return false;
+}
+
+void getSwissTableStats(SwissTable* table, MapStats* stats) {
+    /*
+    Gets the table's stats, where a key's probe length is the number of groups a lookup of it goes through.
+    */
+    initMapStats(stats, table->numKeys, table->numTombstones, table->capacity,
+                 table->capacity * (1 + sizeof(SwissSlot)) + sizeKeyArena(&table->keys));
+
+    size_t groupMask = table->capacity / SWISS_GROUP_SIZE - 1;
+    for (int slotIdx = 0; slotIdx < table->capacity; slotIdx += 1) {
+        if (table->control[slotIdx] & 0x80) continue;
+
+        // Follow the probe sequence from where the key hashes to, until it gets to the key's group.
+        size_t groupIdx = (table->slots[slotIdx].hash >> 7) & groupMask;
+        int probeLength = 1;
+        while (groupIdx != (size_t)(slotIdx / SWISS_GROUP_SIZE)) {
+            groupIdx = (groupIdx + probeLength) & groupMask;
+            probeLength += 1;
+        }
+
+        addMapStatsProbe(stats, probeLength);
+    }
+
+    finishMapStats(stats);
+}
+
+// ================================ SwissMap ================================
+
+void initSwissMap(SwissMap* map) {
+    initSwissTable(&map->table);
+}
+
+void freeSwissMap(SwissMap* map) {
+    freeSwissTable(&map->table);
+}
+
+void clearSwissMap(SwissMap* map) {
+    clearSwissTable(&map->table);
+}
+
+bool setSwissMapWithLength(SwissMap* map, const char* key, int keyLength, char* value) {
+    bool isNewKey;
+    insertSwissSlot(&map->table, key, keyLength, &isNewKey)->value.string = value;
+    return isNewKey;
+}
+
+bool setSwissMap(SwissMap* map, const char* key, char* value) {
+    return setSwissMapWithLength(map, key, strlen(key), value);
+}
+
+bool getSwissMapWithLength(SwissMap* map, const char* key, int keyLength, char** value) {
+    int slotIdx = findSwissSlot(&map->table, key, keyLength, hashString(key, keyLength));
+    if (slotIdx == -1) return false;
+
+    *value = map->table.slots[slotIdx].value.string;
+    return true;
+}
+
+bool getSwissMap(SwissMap* map, const char* key, char** value) {
+    return getSwissMapWithLength(map, key, strlen(key), value);
+}
+
+bool deleteSwissMapWithLength(SwissMap* map, const char* key, int keyLength) {
+    return deleteSwissSlot(&map->table, key, keyLength);
+}
+
+bool deleteSwissMap(SwissMap* map, const char* key) {
+    return deleteSwissSlot(&map->table, key, strlen(key));
+}
+
+int countSwissMap(SwissMap* map) {
+    return map->table.numKeys;
+}
+
+bool nextSwissMapWithLength(SwissMap* map, int* cursor, char** key, int* keyLength, char** value) {
+    SwissSlot* slot;
+    if (!nextSwissSlot(&map->table, cursor, &slot)) return false;
+
+    *key = slot->key;
+    *keyLength = slot->keyLength;
+    *value = slot->value.string;
+    return true;
+}
+
+bool nextSwissMap(SwissMap* map, int* cursor, char** key, char** value) {
+    int keyLength;
+    return nextSwissMapWithLength(map, cursor, key, &keyLength, value);
+}
+
+void getSwissMapStats(SwissMap* map, MapStats* stats) {
+    getSwissTableStats(&map->table, stats);
+}
+
+// ================================ SwissLLongMap ================================
+
+void initSwissLLongMap(SwissLLongMap* map) {
+    initSwissTable(&map->table);
+}
+
+void freeSwissLLongMap(SwissLLongMap* map) {
+    freeSwissTable(&map->table);
+}
+
+void clearSwissLLongMap(SwissLLongMap* map) {
+    clearSwissTable(&map->table);
+}
+
+bool setSwissLLongMapWithLength(SwissLLongMap* map, const char* key, int keyLength, long long value) {
+    bool isNewKey;
+    insertSwissSlot(&map->table, key, keyLength, &isNewKey)->value.llong = value;
+    return isNewKey;
+}
+
+bool setSwissLLongMap(SwissLLongMap* map, const char* key, long long value) {
+    return setSwissLLongMapWithLength(map, key, strlen(key), value);
+}
+
+bool getSwissLLongMapWithLength(SwissLLongMap* map, const char* key, int keyLength, long long* value) {
+    int slotIdx = findSwissSlot(&map->table, key, keyLength, hashString(key, keyLength));
+    if (slotIdx == -1) return false;
+
+    *value = map->table.slots[slotIdx].value.llong;
+    return true;
+}
+
+bool getSwissLLongMap(SwissLLongMap* map, const char* key, long long* value) {
+    return getSwissLLongMapWithLength(map, key, strlen(key), value);
+}
+
+bool deleteSwissLLongMapWithLength(SwissLLongMap* map, const char* key, int keyLength) {
+    return deleteSwissSlot(&map->table, key, keyLength);
+}
+
+bool deleteSwissLLongMap(SwissLLongMap* map, const char* key) {
+    return deleteSwissSlot(&map->table, key, strlen(key));
+}
+
+int countSwissLLongMap(SwissLLongMap* map) {
+    return map->table.numKeys;
+}
+
+bool nextSwissLLongMapWithLength(SwissLLongMap* map, int* cursor, char** key, int* keyLength, long long* value) {
+    SwissSlot* slot;
+    if (!nextSwissSlot(&map->table, cursor, &slot)) return false;
+
+    *key = slot->key;
+    *keyLength = slot->keyLength;
+    *value = slot->value.llong;
+    return true;
+}
+
+bool nextSwissLLongMap(SwissLLongMap* map, int* cursor, char** key, long long* value) {
+    int keyLength;
+    return nextSwissLLongMapWithLength(map, cursor, key, &keyLength, value);
+}
+
+void getSwissLLongMapStats(SwissLLongMap* map, MapStats* stats) {
+    getSwissTableStats(&map->table, stats);
+}
+
+#endif